@@ -0,0 +1,40 @@
+/* ntrace.h 
+ *     Data structures defining the Nachos page reference trace format,
+ *     written by the kernel (nachos -pt) and read by pagesim. 页面访问
+ *     轨迹文件格式：由内核写出，由pagesim读入回放。
+ *
+ *     The file is a header, then a sequence of records of two words
+ *     each, in the byte order of the host that wrote it.  A record is
+ *     either a reference -- virtual page, read or write, and the tick
+ *     of the last of a run of such references -- or an event that
+ *     tells whose references follow:
+ *
+ *	reference	(vpn << 1) | write
+ *	event		TraceEventBit | (kind << TraceKindShift) | spaceId
+ *
+ *     Consecutive references by a process to the same page, the same
+ *     way, are recorded once, with the tick of the last of them.  None
+ *     of FIFO, LRU, clock, WSClock or OPT can tell the difference.
+ */
+
+#define NTRACEMAGIC	0x4e505472	/* "NPTr", in the header */
+
+#define TraceEventBit	0x80000000	/* an event, not a reference */
+#define TraceKindShift	24
+#define TraceSpaceMask	0x00ffffff
+#define TraceWriteBit	0x1
+
+#define TraceSwitch	0	/* the references that follow are by
+				 * space "spaceId" */
+#define TraceCreate	1	/* a new process got space "spaceId" */
+#define TraceExit	2	/* space "spaceId" is gone, with its pages */
+
+typedef struct traceHeader {
+   int magic;			/* should be NTRACEMAGIC */
+   int pageSize;		/* bytes in a page, when the trace was made */
+} TraceHeader;
+
+typedef struct traceRecord {
+   unsigned int word;		/* a reference, or an event */
+   unsigned int tick;		/* stats->totalTicks, when it happened */
+} TraceRecord;
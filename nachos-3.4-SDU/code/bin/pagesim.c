@@ -0,0 +1,399 @@
+/*
+ Copyright (c) 1992 The Regents of the University of California.
+ All rights reserved.  See copyright.h for copyright notice and limitation
+ of liability and disclaimer of warranty provisions.
+ */
+
+/* This program replays a page reference trace, recorded by running
+ * nachos with -pt, against page replacement policies -- FIFO, LRU,
+ * clock, WSClock and OPT -- for a range of memory sizes, and prints
+ * the faults each one takes as CSV, one line per policy and number
+ * of frames: 离线回放页面访问轨迹，比较各置换算法在不同物理页数下的缺页率。
+ *
+ *	policy,frames,references,faults,fault_rate,writebacks
+ *
+ * As in the kernel, all processes share one pool of frames (global
+ * replacement), and a process's frames are freed when it exits.
+ * "writebacks" counts dirty pages written to swap: on eviction, or
+ * when WSClock cleans an old page ahead of time.
+ *
+ * Usage: pagesim [-p policy] [-f first last step] [-t tau] traceFile
+ *
+ *	-p	replay only this policy (fifo, lru, clock, wsclock or opt)
+ *	-f	the numbers of frames to try (default 4 to 64, by 4)
+ *	-t	WSClock's working set window, in ticks (default 10000)
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ntrace.h"
+
+#define NumPolicies	5
+#define Unused		(-1)
+#define Never		0x7fffffff	/* OPT: the page is not used again */
+
+static char *policyNames[NumPolicies] = { "fifo", "lru", "clock", "wsclock", "opt" };
+
+/* A step of the replay: a reference to a page, or the exit of a
+ * process, whose pages are then freed. */
+typedef struct op {
+   int page;			/* page number, dense from 0; or, for an
+				 * exit, -1 - the process's number */
+   int write;			/* a store? */
+   unsigned int tick;		/* when */
+   int next;			/* OPT: the step of the next reference to
+				 * the same page, or Never */
+} Op;
+
+typedef struct frame {
+   int page;			/* Unused, if the frame is free */
+   int loaded;			/* FIFO: when the page was brought in */
+   int lastUse;			/* LRU: the step of its last reference */
+   unsigned int lastTick;	/* WSClock: the tick of its last reference */
+   int use, dirty;		/* the bits the MMU would set */
+   int next;			/* OPT: the step it is next used at */
+} Frame;
+
+static Op *ops;			/* the trace, in order */
+static int numOps, numRefs;
+static int numPages;		/* distinct pages in the trace */
+static int *pageProcess;	/* for each page, its process's number */
+
+/* Hash table of the (process, virtual page) pairs seen so far, to give
+ * each one a dense page number.  Open addressing; grows as needed. */
+static unsigned int *hashProcess, *hashVpn;
+static int *hashPage;
+static int hashSize;
+
+static void *
+Allocate(int bytes)
+{
+    void *p = malloc(bytes);
+
+    if (p == NULL) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+static void *
+Reallocate(void *old, int bytes)
+{
+    void *p = realloc(old, bytes);
+
+    if (p == NULL) {
+	fprintf(stderr, "Out of memory\n");
+	exit(1);
+    }
+    return p;
+}
+
+static unsigned int
+Hash(unsigned int process, unsigned int vpn)
+{
+    return (process * 2654435761u) ^ (vpn * 40503u);
+}
+
+static void
+GrowHash()
+{
+    unsigned int *oldProcess = hashProcess, *oldVpn = hashVpn;
+    int *oldPage = hashPage;
+    int oldSize = hashSize, i, h;
+
+    hashSize = (oldSize == 0) ? 1024 : 2 * oldSize;
+    hashProcess = (unsigned int *) Allocate(hashSize * sizeof(unsigned int));
+    hashVpn = (unsigned int *) Allocate(hashSize * sizeof(unsigned int));
+    hashPage = (int *) Allocate(hashSize * sizeof(int));
+    for (i = 0; i < hashSize; i++)
+	hashPage[i] = Unused;
+    for (i = 0; i < oldSize; i++)
+	if (oldPage[i] != Unused) {
+	    for (h = Hash(oldProcess[i], oldVpn[i]) & (hashSize - 1);
+		 hashPage[h] != Unused; h = (h + 1) & (hashSize - 1))
+		;
+	    hashProcess[h] = oldProcess[i];
+	    hashVpn[h] = oldVpn[i];
+	    hashPage[h] = oldPage[i];
+	}
+    if (oldSize > 0) {
+	free(oldProcess);
+	free(oldVpn);
+	free(oldPage);
+    }
+}
+
+/* The dense page number of page "vpn" of process "process", given a
+ * new one the first time round. */
+static int
+PageNumber(unsigned int process, unsigned int vpn)
+{
+    int h;
+
+    if (2 * (numPages + 1) > hashSize)
+	GrowHash();
+    for (h = Hash(process, vpn) & (hashSize - 1); hashPage[h] != Unused;
+	 h = (h + 1) & (hashSize - 1))
+	if ((hashProcess[h] == process) && (hashVpn[h] == vpn))
+	    return hashPage[h];
+    hashProcess[h] = process;
+    hashVpn[h] = vpn;
+    hashPage[h] = numPages;
+    return numPages++;
+}
+
+/* Read the trace in "name" into "ops".  Space numbers are reused by
+ * the kernel, so each process -- from its creation, or its first
+ * reference, to its exit -- gets a number of its own. */
+static void
+ReadTrace(char *name)
+{
+    FILE *f;
+    TraceHeader header;
+    TraceRecord record;
+    int maxOps = 4096, maxPages = 0, numProcesses = 0, running = -1;
+    int *process = NULL, maxSpaces = 0;	/* space -> process number */
+    unsigned int space;
+    int i, kind, *lastRef;
+
+    if ((f = fopen(name, "rb")) == NULL) {
+	fprintf(stderr, "Unable to open trace file %s\n", name);
+	exit(1);
+    }
+    if ((fread(&header, sizeof(header), 1, f) != 1) ||
+	(header.magic != NTRACEMAGIC)) {
+	fprintf(stderr, "%s is not a Nachos page trace\n", name);
+	exit(1);
+    }
+    ops = (Op *) Allocate(maxOps * sizeof(Op));
+    pageProcess = NULL;
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+	if (record.word & TraceEventBit) {
+	    kind = (record.word & ~TraceEventBit) >> TraceKindShift;
+	    space = record.word & TraceSpaceMask;
+	    if (space >= maxSpaces) {
+		int newMax = space + 128;
+
+		process = (int *) Reallocate(process, newMax * sizeof(int));
+		for (i = maxSpaces; i < newMax; i++)
+		    process[i] = Unused;
+		maxSpaces = newMax;
+	    }
+	    if (kind == TraceSwitch)
+		running = space;
+	    else if (kind == TraceCreate)
+		process[space] = numProcesses++;
+	    if (kind != TraceExit)
+		continue;
+	    if (process[space] == Unused)
+		continue;		/* never ran */
+	    if (numOps == maxOps)
+		ops = (Op *) Reallocate(ops, (maxOps *= 2) * sizeof(Op));
+	    ops[numOps].page = -1 - process[space];
+	    ops[numOps].tick = record.tick;
+	    numOps++;
+	    process[space] = Unused;
+	    continue;
+	}
+	if (running < 0) {		/* a trace of one program: -x */
+	    running = 0;
+	    if (maxSpaces == 0) {
+		process = (int *) Allocate(128 * sizeof(int));
+		for (i = 0; i < 128; i++)
+		    process[i] = Unused;
+		maxSpaces = 128;
+	    }
+	}
+	if (process[running] == Unused)
+	    process[running] = numProcesses++;
+	if (numOps == maxOps)
+	    ops = (Op *) Reallocate(ops, (maxOps *= 2) * sizeof(Op));
+	ops[numOps].page = PageNumber(process[running], record.word >> 1);
+	ops[numOps].write = record.word & TraceWriteBit;
+	ops[numOps].tick = record.tick;
+	if (ops[numOps].page >= maxPages) {
+	    maxPages = 2 * maxPages + 1024;
+	    pageProcess = (int *) Reallocate(pageProcess, maxPages * sizeof(int));
+	}
+	pageProcess[ops[numOps].page] = process[running];
+	numOps++;
+	numRefs++;
+    }
+    fclose(f);
+
+    /* for OPT: when is each page next used? */
+    lastRef = (int *) Allocate((numPages + 1) * sizeof(int));
+    for (i = 0; i < numPages; i++)
+	lastRef[i] = Never;
+    for (i = numOps - 1; i >= 0; i--)
+	if (ops[i].page >= 0) {
+	    ops[i].next = lastRef[ops[i].page];
+	    lastRef[ops[i].page] = i;
+	}
+    free(lastRef);
+    fprintf(stderr, "%s: %d references to %d pages of %d processes\n",
+	    name, numRefs, numPages, numProcesses);
+}
+
+/* Choose the frame to take, when none is free. */
+static int
+Victim(int policy, Frame *frames, int numFrames, int *hand,
+       unsigned int now, unsigned int tau, int *writebacks)
+{
+    int i, f, best = 0;
+
+    switch (policy) {
+      case 0:			/* FIFO: the page loaded first */
+	for (f = 1; f < numFrames; f++)
+	    if (frames[f].loaded < frames[best].loaded)
+		best = f;
+	return best;
+      case 1:			/* LRU: the page used longest ago */
+	for (f = 1; f < numFrames; f++)
+	    if (frames[f].lastUse < frames[best].lastUse)
+		best = f;
+	return best;
+      case 2:			/* clock: the first page not used since the
+				 * hand last passed it */
+	for (;;) {
+	    f = *hand;
+	    *hand = (*hand + 1) % numFrames;
+	    if (!frames[f].use)
+		return f;
+	    frames[f].use = 0;
+	}
+      case 3:			/* WSClock: the first clean page out of the
+				 * working set; dirty ones are cleaned on
+				 * the way */
+	for (i = 0; i < 2 * numFrames; i++) {
+	    f = *hand;
+	    *hand = (*hand + 1) % numFrames;
+	    if (frames[f].use)
+		frames[f].use = 0;
+	    else if (now - frames[f].lastTick > tau) {
+		if (!frames[f].dirty)
+		    return f;
+		frames[f].dirty = 0;	/* written out in the background */
+		(*writebacks)++;
+	    }
+	}
+	for (f = 1; f < numFrames; f++)	/* all in the working set */
+	    if (frames[f].lastTick < frames[best].lastTick)
+		best = f;
+	return best;
+      default:			/* OPT: the page used again furthest on */
+	for (f = 1; f < numFrames; f++)
+	    if (frames[f].next > frames[best].next)
+		best = f;
+	return best;
+    }
+}
+
+/* Replay the trace with "numFrames" frames, and print the result. */
+static void
+Simulate(int policy, int numFrames, unsigned int tau)
+{
+    Frame *frames = (Frame *) Allocate(numFrames * sizeof(Frame));
+    int *frameOf = (int *) Allocate((numPages + 1) * sizeof(int));
+    int *freeFrames = (int *) Allocate(numFrames * sizeof(int));
+    int numFree = 0, hand = 0, loads = 0, faults = 0, writebacks = 0;
+    int i, f, page;
+    Op *op;
+
+    for (i = 0; i < numPages; i++)
+	frameOf[i] = Unused;
+    for (f = numFrames - 1; f >= 0; f--) {
+	frames[f].page = Unused;
+	freeFrames[numFree++] = f;
+    }
+    for (i = 0; i < numOps; i++) {
+	op = &ops[i];
+	if (op->page < 0) {		/* a process exited */
+	    for (f = 0; f < numFrames; f++)
+		if ((frames[f].page != Unused) &&
+		    (pageProcess[frames[f].page] == -1 - op->page)) {
+		    frameOf[frames[f].page] = Unused;
+		    frames[f].page = Unused;
+		    freeFrames[numFree++] = f;
+		}
+	    continue;
+	}
+	page = op->page;
+	if ((f = frameOf[page]) == Unused) {
+	    faults++;
+	    if (numFree > 0)
+		f = freeFrames[--numFree];
+	    else {
+		f = Victim(policy, frames, numFrames, &hand, op->tick, tau,
+			   &writebacks);
+		if (frames[f].dirty)
+		    writebacks++;
+		frameOf[frames[f].page] = Unused;
+	    }
+	    frames[f].page = page;
+	    frames[f].loaded = loads++;
+	    frames[f].dirty = 0;
+	    frameOf[page] = f;
+	}
+	frames[f].use = 1;
+	frames[f].lastUse = i;
+	frames[f].lastTick = op->tick;
+	frames[f].next = op->next;
+	if (op->write)
+	    frames[f].dirty = 1;
+    }
+    printf("%s,%d,%d,%d,%.4f,%d\n", policyNames[policy], numFrames, numRefs,
+	   faults, (numRefs > 0) ? (double) faults / numRefs : 0.0,
+	   writebacks);
+    free(frames);
+    free(frameOf);
+    free(freeFrames);
+}
+
+int
+main(int argc, char **argv)
+{
+    int policy = -1, first = 4, last = 64, step = 4;
+    unsigned int tau = 10000;
+    int p, n;
+
+    for (argc--, argv++; (argc > 1) && (argv[0][0] == '-'); argc--, argv++) {
+	if (!strcmp(*argv, "-p")) {
+	    for (policy = 0; policy < NumPolicies; policy++)
+		if (!strcmp(argv[1], policyNames[policy]))
+		    break;
+	    if (policy == NumPolicies)
+		break;			/* unknown: usage */
+	    argc--, argv++;
+	} else if (!strcmp(*argv, "-f") && (argc > 4)) {
+	    first = atoi(argv[1]);
+	    last = atoi(argv[2]);
+	    step = atoi(argv[3]);
+	    argc -= 3, argv += 3;
+	} else if (!strcmp(*argv, "-t")) {
+	    tau = atoi(argv[1]);
+	    argc--, argv++;
+	} else
+	    break;
+    }
+    if ((argc != 1) || (policy == NumPolicies) || (first < 1) || (step < 1)) {
+	fprintf(stderr, "Usage: pagesim [-p fifo|lru|clock|wsclock|opt] "
+		"[-f first last step] [-t tau] traceFile\n");
+	exit(1);
+    }
+    ReadTrace(argv[0]);
+
+    printf("policy,frames,references,faults,fault_rate,writebacks\n");
+    for (p = 0; p < NumPolicies; p++)
+	if ((policy < 0) || (p == policy))
+	    for (n = first; n <= last; n += step)
+		Simulate(p, n, tau);
+    return 0;
+}
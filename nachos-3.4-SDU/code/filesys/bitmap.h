@@ -45,6 +45,10 @@ public:
   int Find();            // Return the # of a clear bit, and as a side
       // effect, set the bit.
       // If no bits are clear, return -1. 返回一个清晰的位，作为副作用，设置该位。如果没有位是清除的，则返回-1。
+  int FindRun(int from, int wanted, int *length);
+      // Find and set a run of up to "wanted"
+      // clear bits, looking from "from" on;
+      // return its first bit, -1 if none 查找并分配一段连续的空闲位
   int NumClear(); // Return the number of clear bits
 
   void Print(); // Print contents of bitmap 打印位图内容
@@ -53,6 +57,9 @@ public:
   // write the bitmap to a file 直到文件系统需要将位图读写到文件中时，才需要这些
   void FetchFrom(OpenFile *file); // fetch contents from disk 从磁盘获取内容
   void WriteBack(OpenFile *file); // write contents to disk
+  void WriteBackDirty(OpenFile *file); // write only the words changed
+      // since the last fetch or write back 只写回上次读写后改动过的字
+  bool IsDirty() { return numDirty > 0; }
 
 private:
   int numBits;       // number of bits in the bitmap 位图中的位数
@@ -61,6 +68,11 @@ private:
                      //  multiple of the number of bits in
                      //  a word) （如果numBits不是单词位数的倍数，则向上舍入）
   unsigned int *map; // bit storage 位存储
+  bool *dirty;       // dirty[i]: map[i] changed since last written
+  int numDirty;      // number of dirty words
+
+  void Changed(int word); // note that map[word] was modified
+  void MarkClean();       // the file now matches the map
 };
 
 #endif // BITMAP_H
@@ -0,0 +1,200 @@
+// dcache.cc
+//	Routines to manage the path lookup (dentry) cache.
+//
+//	Entries are found through a hash table on <directory sector,
+//	name>, and kept on a doubly linked LRU list; when the cache is
+//	full, the least recently used entry is recycled.  Names are
+//	compared the way Directory::Find compares them, on the first
+//	FileNameMaxLen characters. 按<目录扇区, 文件名>散列查找，满时淘汰最久未使用的条目。
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty cache with room for "size" names.
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    int hashSize;
+
+    ASSERT(size > 0);
+    numEntries = size;
+    for (hashSize = 1; hashSize < numEntries; hashSize *= 2)
+        ;
+    hashMask = hashSize - 1;
+    hashTable = new Dentry *[hashSize];
+    for (int i = 0; i < hashSize; i++)
+        hashTable[i] = NULL;
+
+    entries = new Dentry[numEntries];
+    lruList.lruNext = lruList.lruPrev = &lruList;
+    for (int i = 0; i < numEntries; i++)
+    {
+        entries[i].valid = FALSE;
+        entries[i].hashNext = NULL;
+        entries[i].lruPrev = &lruList; // put it at the front
+        entries[i].lruNext = lruList.lruNext;
+        lruList.lruNext->lruPrev = &entries[i];
+        lruList.lruNext = &entries[i];
+    }
+    hits = misses = 0;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	De-allocate the cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    delete[] entries;
+    delete[] hashTable;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	Look "name" up in the directory whose header is at "dirSector",
+//	without going to disk.
+//
+//	Returns TRUE if the answer is cached; then "*sector" is the file's
+//	header sector (-1 if the directory has no such file), and "*type"
+//	its type.
+//----------------------------------------------------------------------
+
+bool DentryCache::Lookup(int dirSector, char *name, int *sector, int *type)
+{
+    Dentry *entry = Find(dirSector, name);
+
+    if (entry == NULL)
+    {
+        misses++;
+        return FALSE;
+    }
+    hits++;
+    *sector = entry->sector;
+    *type = entry->type;
+    Touch(entry);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Enter
+// 	Remember that "name" in directory "dirSector" has its header at
+//	"sector" (-1: there is no such name), replacing whatever was
+//	cached for it.  Called after a lookup on disk, and whenever the
+//	file system adds a name to, or removes one from, a directory.
+//----------------------------------------------------------------------
+
+void DentryCache::Enter(int dirSector, char *name, int sector, int type)
+{
+    Dentry *entry = Find(dirSector, name);
+    int bucket;
+
+    if (entry == NULL)
+    { // recycle the least recently used entry
+        entry = lruList.lruPrev;
+        if (entry->valid)
+            Unhash(entry);
+        entry->dirSector = dirSector;
+        strncpy(entry->name, name, FileNameMaxLen);
+        entry->name[FileNameMaxLen] = '\0';
+        entry->valid = TRUE;
+        bucket = Hash(dirSector, name);
+        entry->hashNext = hashTable[bucket];
+        hashTable[bucket] = entry;
+    }
+    entry->sector = sector;
+    entry->type = (sector == -1) ? -1 : type;
+    Touch(entry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::InvalidateDir
+// 	Forget every name cached for the directory at "dirSector".  Its
+//	header sector may soon belong to a different directory.
+//----------------------------------------------------------------------
+
+void DentryCache::InvalidateDir(int dirSector)
+{
+    for (int i = 0; i < numEntries; i++)
+        if (entries[i].valid && (entries[i].dirSector == dirSector))
+        {
+            Unhash(&entries[i]);
+            entries[i].valid = FALSE;
+            entries[i].lruPrev->lruNext = entries[i].lruNext; // recycle
+            entries[i].lruNext->lruPrev = entries[i].lruPrev; // it first
+            entries[i].lruNext = &lruList;
+            entries[i].lruPrev = lruList.lruPrev;
+            lruList.lruPrev->lruNext = &entries[i];
+            lruList.lruPrev = &entries[i];
+        }
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Hash
+// 	Which hash chain does <dirSector, name> belong on?
+//----------------------------------------------------------------------
+
+int DentryCache::Hash(int dirSector, char *name)
+{
+    unsigned int h = dirSector;
+
+    for (int i = 0; (i < FileNameMaxLen) && (name[i] != '\0'); i++)
+        h = h * 31 + (unsigned char)name[i];
+    return h & hashMask;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+// 	Return the entry for <dirSector, name>, or NULL if there is none.
+//----------------------------------------------------------------------
+
+Dentry *
+DentryCache::Find(int dirSector, char *name)
+{
+    Dentry *entry;
+
+    for (entry = hashTable[Hash(dirSector, name)]; entry != NULL;
+         entry = entry->hashNext)
+        if ((entry->dirSector == dirSector) &&
+            !strncmp(entry->name, name, FileNameMaxLen))
+            return entry;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Unhash
+// 	Take an entry off its hash chain.
+//----------------------------------------------------------------------
+
+void DentryCache::Unhash(Dentry *entry)
+{
+    Dentry **link;
+
+    for (link = &hashTable[Hash(entry->dirSector, entry->name)];
+         *link != entry; link = &(*link)->hashNext)
+        ;
+    *link = entry->hashNext;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Touch
+// 	Move an entry to the front of the LRU list.
+//----------------------------------------------------------------------
+
+void DentryCache::Touch(Dentry *entry)
+{
+    entry->lruPrev->lruNext = entry->lruNext; // unlink
+    entry->lruNext->lruPrev = entry->lruPrev;
+    entry->lruPrev = &lruList; // and put it at the front
+    entry->lruNext = lruList.lruNext;
+    lruList.lruNext->lruPrev = entry;
+    lruList.lruNext = entry;
+}
@@ -0,0 +1,79 @@
+// dcache.h
+//	Data structures for the path lookup (dentry) cache.
+//
+//	Looking a name up in a directory means opening the directory file
+//	and reading all of it.  The dentry cache remembers the answers:
+//	for a <directory sector, name> pair, the sector of the named file's
+//	header and its type -- or that there is no such name, which is just
+//	as worth remembering. 路径查找缓存：记录<目录扇区, 文件名>到<文件头扇区, 类型>的映射，也缓存“不存在”的结果。
+//
+//	The file system must keep the cache up to date whenever it changes
+//	a directory.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "directory.h"
+
+#define DentryCacheSize 64 // number of names remembered
+
+// One cached name.  An entry with sector == -1 is a negative entry:
+// the directory has no file of that name.
+
+class Dentry
+{
+public:
+  int dirSector;                 // header sector of the directory
+  char name[FileNameMaxLen + 1]; // name looked up in it
+  int sector;                    // header sector of the file, or -1
+  int type;                      // DirType or FileType
+  bool valid;                    // is the entry in use?
+  Dentry *hashNext;              // next entry on the same hash chain
+  Dentry *lruPrev;               // neighbours on the LRU list
+  Dentry *lruNext;
+};
+
+// The following class defines the cache: a hash table of entries,
+// with the least recently used one recycled when a new name comes in.
+
+class DentryCache
+{
+public:
+  DentryCache(int size); // Initialize an empty cache of "size" names
+  ~DentryCache();        // De-allocate it
+
+  bool Lookup(int dirSector, char *name, int *sector, int *type);
+  // Is the name cached?  If so, return
+  // its sector (-1 if it does not
+  // exist) and type
+  void Enter(int dirSector, char *name, int sector, int type);
+  // Remember the result of a lookup,
+  // or a change to the directory
+  void InvalidateDir(int dirSector); // Forget every name in a directory
+                                     // (it is being removed)
+
+  int NumHits() { return hits; }
+  int NumMisses() { return misses; }
+
+private:
+  Dentry *entries;     // all the entries
+  int numEntries;      // how many there are
+  Dentry **hashTable;  // chains of entries, by <dirSector, name>
+  int hashMask;        // hash table size - 1 (a power of two)
+  Dentry lruList;      // dummy head of the LRU list: lruNext is
+                       // the most, lruPrev the least recently used
+  int hits, misses;    // lookups answered, and not
+
+  int Hash(int dirSector, char *name);
+  Dentry *Find(int dirSector, char *name); // NULL if not cached
+  void Unhash(Dentry *entry);              // take it off its chain
+  void Touch(Dentry *entry);               // make it most recently used
+};
+
+#endif // DCACHE_H
@@ -7,14 +7,17 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names. 目录是一个固定长度的条目表；每个条目代表一个文件，包含文件名和文件头在磁盘上的位置。每个目录项的固定大小意味着我们对文件名有固定的最大大小限制。
 //
+//	The table is a hash table, kept on disk a bucket per sector
+//	(see directory.h), so that finding, adding or removing a name
+//	only reads and writes the one or two sectors involved, however
+//	big the directory is. 目录是按扇区分桶的散列表，查找、添加、删除只读写相关的一两个扇区。
+//
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk. 构造函数初始化一个特定大小的空目录；我们使用ReadFrom/write back从磁盘获取目录的内容，并将任何修改写回磁盘。
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment. 此外，此实现具有目录大小无法扩展的限制。换句话说，一旦使用了目录中的所有条目，就不能再创建文件了。解决这一问题是分配的一部分。
+//	When a directory gets 3/4 full, the table doubles in size, so a
+//	directory grows for as long as its file can.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -26,6 +29,22 @@
 #include "directory.h"
 #include "system.h"
 
+// Hash a file name, on the characters Directory::Find compares.
+// (FNV-1a.)
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; (i < FileNameMaxLen) && (name[i] != '\0'); i++)
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    return h;
+}
+
+#define Fingerprint(h) ((unsigned short)((h) >> 16))
+#define OverflowSet(b) (header.overflow[(b) / BitsInByte] & (1 << ((b) % BitsInByte)))
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -38,10 +57,17 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-        table[i].inUse = FALSE;
+    int numBuckets;
+
+    for (numBuckets = 1; numBuckets * EntriesPerBucket < size; numBuckets *= 2)
+        ;
+    table = NULL;
+    loaded = dirty = NULL;
+    file = NULL;
+    SetSize(numBuckets);
+    header.magic = DirMagic;
+    header.numEntries = 0;
+    rewrite = TRUE; // nothing of it is on disk yet
 }
 
 //----------------------------------------------------------------------
@@ -52,30 +78,161 @@ Directory::Directory(int size)
 Directory::~Directory()
 {
     delete[] table;
+    delete[] loaded;
+    delete[] dirty;
+}
+
+//----------------------------------------------------------------------
+// Directory::FileSize
+// 	Return how many bytes of disk a directory made with
+//	Directory(size) takes: the header, plus a sector per bucket.
+//----------------------------------------------------------------------
+
+int Directory::FileSize(int size)
+{
+    int numBuckets;
+
+    for (numBuckets = 1; numBuckets * EntriesPerBucket < size; numBuckets *= 2)
+        ;
+    return (1 + numBuckets) * SectorSize;
+}
+
+//----------------------------------------------------------------------
+// Directory::SetSize
+// 	Make the in-memory table an empty one of "numBuckets" buckets,
+//	all of them loaded.  The header's entry count is left alone.
+//----------------------------------------------------------------------
+
+void Directory::SetSize(int numBuckets)
+{
+    delete[] table;
+    delete[] loaded;
+    delete[] dirty;
+
+    header.numBuckets = numBuckets;
+    bzero(header.overflow, sizeof(header.overflow));
+    tableSize = numBuckets * EntriesPerBucket;
+    table = new DirectoryEntry[tableSize];
+    for (int i = 0; i < tableSize; i++)
+        table[i].inUse = FALSE;
+    loaded = new char[numBuckets];
+    dirty = new char[numBuckets];
+    for (int b = 0; b < numBuckets; b++)
+        loaded[b] = dirty[b] = TRUE;
+    headerDirty = TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the header of the directory from disk.  The buckets are
+//	read later, as they are needed.
 //
-//	"file" -- file containing the directory contents
+//	"dirFile" -- file containing the directory contents
 //----------------------------------------------------------------------
 
-void Directory::FetchFrom(OpenFile *file)
+void Directory::FetchFrom(OpenFile *dirFile)
 {
-    (void)file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int numBuckets;
+
+    (void)dirFile->ReadAt((char *)&header, sizeof(DirectoryHeader), 0);
+    ASSERT(header.magic == DirMagic); // disk formatted with hashed directories?
+    numBuckets = header.numBuckets;
+    delete[] table;
+    delete[] loaded;
+    delete[] dirty;
+    tableSize = numBuckets * EntriesPerBucket;
+    table = new DirectoryEntry[tableSize];
+    loaded = new char[numBuckets];
+    dirty = new char[numBuckets];
+    for (int b = 0; b < numBuckets; b++)
+        loaded[b] = dirty[b] = FALSE;
+    headerDirty = FALSE;
+    rewrite = FALSE;
+    this->file = dirFile;
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk: the header
+//	and the buckets that changed, or everything if the table is new
+//	or has just been rebuilt (the file grows as needed).
+//
+//	Return FALSE, having written nothing, if the file cannot grow to
+//	hold the whole table (the disk is full).
 //
-//	"file" -- file to contain the new directory contents
+//	"dirFile" -- file to contain the new directory contents
+//----------------------------------------------------------------------
+
+bool Directory::WriteBack(OpenFile *dirFile)
+{
+    if (rewrite || (dirFile != this->file))
+    {
+        int size = (1 + header.numBuckets) * SectorSize;
+        char *buf = new char[size];
+
+        LoadAll();
+        bzero(buf, size);
+        bcopy((char *)&header, buf, sizeof(DirectoryHeader));
+        for (int b = 0; b < header.numBuckets; b++)
+            bcopy((char *)&table[b * EntriesPerBucket],
+                  &buf[(1 + b) * SectorSize],
+                  EntriesPerBucket * sizeof(DirectoryEntry));
+        if (dirFile->WriteAt(buf, size, 0) != size)
+        { // WriteAt writes nothing if it can't grow the file
+            delete[] buf;
+            return FALSE;
+        }
+        dirFile->WriteBack(); // the file may have grown
+        delete[] buf;
+    }
+    else
+    {
+        if (headerDirty)
+            (void)dirFile->WriteAt((char *)&header, sizeof(DirectoryHeader), 0);
+        for (int b = 0; b < header.numBuckets; b++)
+            if (dirty[b])
+                (void)dirFile->WriteAt((char *)&table[b * EntriesPerBucket],
+                                       EntriesPerBucket * sizeof(DirectoryEntry),
+                                       (1 + b) * SectorSize);
+    }
+    for (int b = 0; b < header.numBuckets; b++)
+        dirty[b] = FALSE;
+    headerDirty = FALSE;
+    rewrite = FALSE;
+    this->file = dirFile;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::LoadBucket
+// 	Make sure bucket "bucket" is in memory.  A bucket past the end of
+//	the file (which should not happen) is taken to be empty.
+//----------------------------------------------------------------------
+
+void Directory::LoadBucket(int bucket)
+{
+    int size = EntriesPerBucket * sizeof(DirectoryEntry);
+
+    if (loaded[bucket])
+        return;
+    ASSERT(file != NULL);
+    if (file->ReadAt((char *)&table[bucket * EntriesPerBucket], size,
+                     (1 + bucket) * SectorSize) != size)
+        for (int i = 0; i < EntriesPerBucket; i++)
+            table[bucket * EntriesPerBucket + i].inUse = FALSE;
+    loaded[bucket] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::LoadAll
+// 	Read in every bucket not yet in memory, for the operations that
+//	look at the whole directory.
 //----------------------------------------------------------------------
 
-void Directory::WriteBack(OpenFile *file)
+void Directory::LoadAll()
 {
-    (void)file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    for (int b = 0; b < header.numBuckets; b++)
+        LoadBucket(b);
 }
 
 //----------------------------------------------------------------------
@@ -83,14 +240,30 @@ void Directory::WriteBack(OpenFile *file)
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory. 在目录中查找文件名，并返回其在目录项表中的位置。如果名称不在目录中，则返回-1。
 //
+//	Start at the bucket the name hashes to, and move on to the next
+//	only while the one searched has overflowed.
+//
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
 int Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-            return i;
+    unsigned int h = HashName(name);
+    unsigned short fingerprint = Fingerprint(h);
+    int mask = header.numBuckets - 1;
+    int b = h & mask;
+
+    for (int probes = 0; probes < header.numBuckets; probes++)
+    {
+        LoadBucket(b);
+        for (int i = b * EntriesPerBucket; i < (b + 1) * EntriesPerBucket; i++)
+            if (table[i].inUse && (table[i].hash == fingerprint) &&
+                !strncmp(table[i].name, name, FileNameMaxLen))
+                return i;
+        if (!OverflowSet(b))
+            break;
+        b = (b + 1) & mask;
+    }
     return -1; // name not in directory
 }
 
@@ -112,6 +285,90 @@ int Directory::Find(char *name)
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::Insert
+// 	Find a free slot for a name with hash "h": the first one in the
+//	bucket it hashes to or after, flagging each full bucket passed
+//	over as overflowed.  Returns the slot's index, or -1 if the table
+//	is full.
+//----------------------------------------------------------------------
+
+int Directory::Insert(char *name, unsigned int h)
+{
+    int mask = header.numBuckets - 1;
+    int b = h & mask;
+
+    for (int probes = 0; probes < header.numBuckets; probes++)
+    {
+        LoadBucket(b);
+        for (int i = b * EntriesPerBucket; i < (b + 1) * EntriesPerBucket; i++)
+            if (!table[i].inUse)
+                return i;
+        if (!OverflowSet(b))
+        {
+            header.overflow[b / BitsInByte] |= 1 << (b % BitsInByte);
+            headerDirty = TRUE;
+        }
+        b = (b + 1) & mask;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Double the hash table, and put every name back in, at its place
+//	in the bigger table.  If the directory is on disk, the whole of it
+//	is written back at once, so that the file is known to have grown;
+//	if it can't, the old table is put back, and FALSE returned.
+//----------------------------------------------------------------------
+
+bool Directory::Grow()
+{
+    DirectoryHeader oldHeader = header;
+    DirectoryEntry *old;
+    char *oldDirty;
+    int oldSize = tableSize;
+    bool oldHeaderDirty = headerDirty, oldRewrite = rewrite;
+    int i, j;
+
+    LoadAll();
+    old = table;
+    oldDirty = dirty;
+    table = NULL; // keep SetSize from deleting them
+    dirty = NULL;
+    SetSize(header.numBuckets * 2);
+    for (i = 0; i < oldSize; i++)
+        if (old[i].inUse)
+        {
+            j = Insert(old[i].name, HashName(old[i].name));
+            ASSERT(j != -1);
+            table[j] = old[i];
+        }
+    rewrite = TRUE;
+    if ((file != NULL) && !WriteBack(file))
+    { // no room for the bigger file: undo
+        delete[] table;
+        delete[] loaded;
+        delete[] dirty;
+        header = oldHeader;
+        tableSize = oldSize;
+        table = old;
+        dirty = oldDirty;
+        loaded = new char[header.numBuckets];
+        for (int b = 0; b < header.numBuckets; b++)
+            loaded[b] = TRUE; // by LoadAll
+        headerDirty = oldHeaderDirty;
+        rewrite = oldRewrite;
+        DEBUG('f', "Directory can't grow past %d buckets\n",
+              header.numBuckets);
+        return FALSE;
+    }
+    delete[] old;
+    delete[] oldDirty;
+    DEBUG('f', "Directory grown to %d buckets\n", header.numBuckets);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
@@ -119,24 +376,42 @@ int Directory::Find(char *name)
 //	the directory is completely full, and has no more space for
 //	additional file names. 将文件添加到目录中。如果成功，则返回TRUE；如果文件名已在目录中，或者目录已满，并且没有更多的空间容纳其他文件名，则返回FALSE。
 //
+//	The table is doubled first if it is 3/4 full, as long as the
+//	bigger directory still fits in a file.  If the disk has no room
+//	for it, the table stays as it was, and the add fails.
+//
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"type" -- DirType or FileType
 //----------------------------------------------------------------------
 
-bool Directory::Add(char *name, int newSector)
+bool Directory::Add(char *name, int newSector, int type)
 {
+    unsigned int h;
+    int i;
+
     if (FindIndex(name) != -1)
         return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse)
-        {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen);
-            table[i].sector = newSector;
-            return TRUE;
-        }
-    return FALSE; // no space.  Fix when we have extensible files.
+    ASSERT(newSector >= 0);
+    if ((4 * (header.numEntries + 1) > 3 * tableSize) &&
+        (header.numBuckets < MaxDirBuckets) &&
+        (FileSize(2 * tableSize) <= MaxFileSize) && !Grow())
+        return FALSE; // the disk has no room for a bigger table
+
+    h = HashName(name);
+    if ((i = Insert(name, h)) == -1)
+        return FALSE; // no space.
+    table[i].inUse = TRUE;
+    table[i].hash = Fingerprint(h);
+    table[i].type = type;
+    table[i].sector = newSector;
+    strncpy(table[i].name, name, FileNameMaxLen);
+    table[i].name[FileNameMaxLen] = '\0';
+    dirty[i / EntriesPerBucket] = TRUE;
+    header.numEntries++;
+    headerDirty = TRUE;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -144,6 +419,9 @@ bool Directory::Add(char *name, int newSector)
 // 	Remove a file name from the directory.  Return TRUE if successful;
 //	return FALSE if the file isn't in the directory. 从目录中删除文件名。如果成功，则返回TRUE；如果文件不在目录中，则返回FALSE。
 //
+//	Overflow flags are left set; they are cleared when the table
+//	is next rebuilt.
+//
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
@@ -154,6 +432,9 @@ bool Directory::Remove(char *name)
     if (i == -1)
         return FALSE; // name not in directory
     table[i].inUse = FALSE;
+    dirty[i / EntriesPerBucket] = TRUE;
+    header.numEntries--;
+    headerDirty = TRUE;
     return TRUE;
 }
 
@@ -164,6 +445,7 @@ bool Directory::Remove(char *name)
 
 void Directory::List()
 {
+    LoadAll();
     for (int i = 0; i < tableSize; i++)
         if (table[i].inUse)
             printf("%s\n", table[i].name);
@@ -179,11 +461,13 @@ void Directory::Print()
 {
     FileHeader *hdr = new FileHeader;
 
-    printf("\nDirectory contents:\n");
+    LoadAll();
+    printf("\nDirectory contents: %d entries, %d buckets\n",
+           header.numEntries, header.numBuckets);
     for (int i = 0; i < tableSize; i++)
         if (table[i].inUse)
         {
-            printf("Name: %s, Path: %s, Sector: %d, Type: %s\n", table[i].name, table[i].path, table[i].sector, table[i].type ? "File" : "Directory");
+            printf("Name: %s, Sector: %d, Type: %s\n", table[i].name, table[i].sector, table[i].type ? "File" : "Directory");
             hdr->FetchFrom(table[i].sector);
             hdr->Print();
         }
@@ -201,45 +485,26 @@ int Directory::getType(char *name)
 
 bool Directory::isEmpty()
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse)
-            return false;
-    return true;
-}
-
-bool Directory::AddTest(char *name, char *path, int newSector, int type)
-{
-    if (FindIndex(name) != -1)
-        return FALSE;
-
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse)
-        {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen + 1);
-            strncpy(table[i].path, path, FilePathMaxLen + 1);
-            table[i].sector = newSector;
-            table[i].type = type;
-            return TRUE;
-        }
-    return FALSE; // no space.  Fix when we have extensible files.
+    return header.numEntries == 0;
 }
 
 void Directory::getTable(int &tableSize, DirectoryEntry *&table)
 {
+    LoadAll();
     tableSize = this->tableSize;
     table = this->table;
 }
 
 bool Directory::cat(char *name)
 {
-    FileHeader *hdr = new FileHeader;
+    FileHeader *hdr;
 
     int i = FindIndex(name);
     if (i == -1)
         return false;
+    hdr = new FileHeader;
     printf("File contents:\n");
-    printf("Name: %s, Path: %s, Sector: %d, Type: %s\n", table[i].name, table[i].path, table[i].sector, table[i].type ? "File" : "Directory");
+    printf("Name: %s, Sector: %d, Type: %s\n", table[i].name, table[i].sector, table[i].type ? "File" : "Directory");
     hdr->FetchFrom(table[i].sector);
     hdr->Print();
     printf("\n");
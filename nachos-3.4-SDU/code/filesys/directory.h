@@ -18,6 +18,7 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "disk.h"
 
 #define FileNameMaxLen 9 // for simplicity, we assume \
                          // file names are <= 9 characters long 为了简单起见，我们假设文件名长度<=9个字符
@@ -29,9 +30,34 @@
 
 #define FileType 1
 
+// A directory is stored as a hash table.  The first sector of the
+// directory file is a DirectoryHeader; after it come the buckets, one
+// sector each, each holding EntriesPerBucket entries.  A name lives in
+// the bucket its hash selects, or if that is full, in one of the
+// buckets after it (the full bucket is then flagged as having
+// overflowed, so that lookups know to keep looking).  The table
+// doubles when it is 3/4 full. 目录以散列表形式存储：首扇区为目录头，其后每个扇区是一个桶；桶满时顺延到下一个桶，并标记溢出。
+
+#define DirMagic 0x44697249 // "DirI", marks a hashed directory
+                            //   with int header sectors
+#define MaxDirBuckets 512   // fits the overflow flags in the header
+
+class DirectoryHeader
+{
+public:
+  int magic;      // DirMagic
+  int numBuckets; // size of the hash table (a power of two)
+  int numEntries; // number of names in it
+  unsigned char overflow[SectorSize - 3 * sizeof(int)];
+  // bit per bucket: some name that hashed
+  // here is stored in a later bucket
+};
+
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
-// the file's header is to be found on disk. 下列类别定义directory entry，表示目录中的文件。每个条目都给出了文件名，以及文件头在磁盘上的位置。
+// the file's header is to be found on disk.  The entry also keeps 16
+// bits of the name's hash, so that most non-matching names are skipped
+// without comparing strings. 目录项保存文件名、文件头扇区、类型，以及文件名散列值的16位指纹。
 //
 // Internal data structures kept public so that Directory operations can
 // access them directly. 内部数据结构保持公共，以便目录操作可以直接访问它们。
@@ -39,16 +65,17 @@
 class DirectoryEntry
 {
 public:
-  int inUse;                    // Is this directory entry in use? 这个directory entry正在使用吗？
   int sector;                    // Location on disk to find the
                                  //   FileHeader for this file 磁盘上查找此文件的文件头的位置
+  unsigned short hash;           // fingerprint of the name
+  char inUse;                    // Is this directory entry in use? 这个directory entry正在使用吗？
+  char type;                     // DirType or FileType
   char name[FileNameMaxLen + 1]; // Text name for file, with +1 for
                                  // the trailing '\0' 文件的文本名称，后面的“\0”带有+1
-
-  int type;
-  char path[FilePathMaxLen + 1];
 };
 
+#define EntriesPerBucket ((int)(SectorSize / sizeof(DirectoryEntry)))
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk. 下面的类定义了一个类似UNIX的“目录”。目录中的每个条目描述一个文件，以及在磁盘上的位置。
 //
@@ -57,7 +84,9 @@ public:
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 构造函数初始化内存中的目录结构；FetchFrom/WriteBack操作将目录信息从/洗牌到磁盘。
+// from/to disk.  FetchFrom only reads the header: a bucket is read
+// the first time it is needed, and WriteBack only writes the buckets
+// that changed. 构造函数初始化内存中的目录结构；FetchFrom只读目录头，桶在首次使用时才读入，WriteBack只写回修改过的桶。
 
 class Directory
 {
@@ -66,14 +95,19 @@ public:
                        // with space for "size" files
   ~Directory();        // De-allocate the directory
 
+  static int FileSize(int size); // Bytes of disk a new Directory(size)
+                                 // takes, when written back
+
   void FetchFrom(OpenFile *file); // Init directory contents from disk
-  void WriteBack(OpenFile *file); // Write modifications to
-                                  // directory contents back to disk
+  bool WriteBack(OpenFile *file); // Write modifications to
+                                  // directory contents back to disk;
+                                  // FALSE if the file can't grow
 
   int Find(char *name); // Find the sector number of the
                         // FileHeader for file: "name"
 
-  bool Add(char *name, int newSector); // Add a file name into the directory
+  bool Add(char *name, int newSector, int type = FileType);
+  // Add a file name into the directory
 
   bool Remove(char *name); // Remove a file from the directory
 
@@ -86,17 +120,30 @@ public:
 
   bool isEmpty();
 
-  bool AddTest(char *name, char *path, int newSector, int type);
-
   void getTable(int &tableSize, DirectoryEntry *&table);
+  // All the entries (check inUse)
 
   bool cat(char *name);
 
 private:
-  int tableSize;         // Number of directory entries
-  DirectoryEntry *table; // Table of pairs:
-                         // <file name, file header location>
-
+  DirectoryHeader header; // size of the table, and overflow flags
+  int tableSize;          // Number of directory entries
+  DirectoryEntry *table;  // Table of pairs:
+                          // <file name, file header location>
+  char *loaded;           // loaded[b]: bucket b has been read in
+  char *dirty;            // dirty[b]: bucket b needs writing back
+  bool headerDirty;       // the header needs writing back
+  bool rewrite;           // write back the whole table (new or grown)
+  OpenFile *file;         // where to read buckets from; NULL if
+                          // the directory is not on disk yet
+
+  void SetSize(int numBuckets);   // (re)allocate an empty table
+  void LoadBucket(int bucket);    // read a bucket in, if need be
+  void LoadAll();                 // read in every bucket
+  bool Grow();                    // double the table, and rehash;
+                                  // FALSE if the disk is too full
+  int Insert(char *name, unsigned int h); // index of a free slot
+                                          // for the name, or -1
   int FindIndex(char *name); // Find the index into the directory
                              //  table corresponding to "name"
 };
@@ -3,12 +3,12 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector,
+//	file's data is stored.  We implement this as a list of extents
+//	-- runs of consecutive sectors -- in file order.  The first few
+//	are kept in the header sector itself, the next ones in a single
+//	indirect block, and the rest in the blocks listed by a double
+//	indirect block.  文件头用 extent 列表描述数据位置，前若干个存放在
+//	文件头扇区中，其余存放在一级/二级间接块中。
 //
 //      Unlike in a real system, we do not keep track of file permissions,
 //	ownership, last modification date, etc., in the file header.
@@ -27,6 +27,66 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize the header of an empty file, with no data sectors.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = 0;   //文件大小
+    numSectors = 0; //文件扇区数
+    numExtents = 0;
+    maxExtents = 0;
+    extents = NULL;
+    firstSector = NULL;
+    lastExtent = 0;
+    singleIndirect = -1;
+    doubleIndirect = -1;
+    for (int i = 0; i < PointersPerBlock; i++)
+        indirect[i] = -1;
+    extentsChanged = FALSE;
+    MakeRoom(NumDirectExtents);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory extent list.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    delete[] extents;
+    delete[] firstSector;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::MakeRoom
+// 	Make the in-memory extent arrays big enough for "count" extents.
+//----------------------------------------------------------------------
+
+void FileHeader::MakeRoom(int count)
+{
+    Extent *newExtents;
+    int *newFirst;
+
+    if (count <= maxExtents)
+        return;
+    count = min(max(count, 2 * maxExtents), MaxExtents);
+    newExtents = new Extent[count];
+    newFirst = new int[count];
+    for (int i = 0; i < numExtents; i++)
+    {
+        newExtents[i] = extents[i];
+        newFirst[i] = firstSector[i];
+    }
+    delete[] extents;
+    delete[] firstSector;
+    extents = newExtents;
+    firstSector = newFirst;
+    maxExtents = count;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -35,103 +95,289 @@
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the file
 //----------------------------------------------------------------------
 
-FileHeader::FileHeader()
+bool FileHeader::Allocate(BitMap *freeMap, int fileSize)
 {
-    numBytes = 0;                       //文件大小
-    numSectors = 0;                     //文件扇区数
-    for (int i = 0; i < NumDirect; i++) // NumDirector=30：文件最多拥有的扇区数
-        dataSectors[i] = 0;
+    ASSERT(numSectors == 0);
+    if (!AddSectors(freeMap, divRoundUp(fileSize, SectorSize)))
+        return FALSE; // not enough space
+    numBytes = fileSize;
+    return TRUE;
 }
 
-bool FileHeader::Allocate(BitMap *freeMap, int fileSize)
+//----------------------------------------------------------------------
+// FileHeader::Allocate
+// 	Make a file longer, allocating the data blocks the extra bytes
+//	need, if any.  Return FALSE (and leave the file as it was) if
+//	there are not enough free blocks.  在文件末尾追加 incrementBytes 字节。
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"fileSize" is the current length of the file
+//	"incrementBytes" is how many bytes it grows by
+//----------------------------------------------------------------------
+
+bool FileHeader::Allocate(BitMap *freeMap, int fileSize, int incrementBytes)
 {
-    numBytes = fileSize;
-    numSectors = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-        return FALSE; // not enough space
+    int moreSectors;
 
-    for (int i = 0; i < numSectors; i++)
-        dataSectors[i] = freeMap->Find();
+    ASSERT((fileSize == numBytes) && (incrementBytes >= 0));
+    //最后一个扇区的剩余空间不足以容纳要写入的数据，分配新的磁盘块
+    moreSectors = divRoundUp(fileSize + incrementBytes, SectorSize) - numSectors;
+    if ((moreSectors > 0) && !AddSectors(freeMap, moreSectors))
+        return FALSE; //磁盘无足够的空闲块
+    numBytes = fileSize + incrementBytes; //更新文件大小
     return TRUE;
 }
 
-bool FileHeader::Allocate(BitMap *freeMap, int fileSize, int incrementBytes)
+//----------------------------------------------------------------------
+// FileHeader::AddSectors
+// 	Add "count" data sectors to the end of the file.  Each run of free
+//	sectors is searched for starting just after the file's last
+//	sector, so the last extent is extended in place whenever it can
+//	be.  On failure, whatever was allocated is given back.
+//----------------------------------------------------------------------
+
+bool FileHeader::AddSectors(BitMap *freeMap, int count)
 {
-    if (numSectors > 30) //限定每个文件最多可分配 30 个扇区
-        return false;    //超出限定的文件大小
-    if ((fileSize == 0) && (incrementBytes > 0))
-    {                                //在一个空文件后追加数据
-        if (freeMap->NumClear() < 1) //至少需要一个扇区块
-            return false;            //磁盘已满，无空闲扇区可分配
-        //为添加数据先分配一个空闲磁盘块，并更新文件头信息
-        dataSectors[0] = freeMap->Find();
-        numSectors = 1;
-        numBytes = 0;
+    int oldSectors = numSectors;
+    int start, length, next;
+
+    if (freeMap->NumClear() < count)
+        return FALSE; // not enough space
+    while (count > 0)
+    {
+        next = 0;
+        if (numExtents > 0)
+            next = extents[numExtents - 1].start + extents[numExtents - 1].length;
+        start = freeMap->FindRun(next, count, &length);
+        if (start == -1)
+            break;
+        if ((numExtents > 0) && (start == next))
+            extents[numExtents - 1].length += length; // still contiguous
+        else
+        {
+            if (numExtents == MaxExtents)
+            { // too fragmented to describe
+                for (int i = 0; i < length; i++)
+                    freeMap->Clear(start + i);
+                break;
+            }
+            MakeRoom(numExtents + 1);
+            extents[numExtents].start = start;
+            extents[numExtents].length = length;
+            firstSector[numExtents] = numSectors;
+            numExtents++;
+        }
+        numSectors += length;
+        count -= length;
     }
-    numBytes = fileSize;
-    int offset = numBytes % SectorSize; //原文件最后一个扇区块数据偏移量
-    int newSectorBytes = incrementBytes - (SectorSize - (offset + 1));
-    //最后一个扇区块剩余空间足以容纳追加数据, 不需分配新的扇区块
-    if (newSectorBytes <= 0)
+    extentsChanged = TRUE;
+    if ((count > 0) || !MapIndirect(freeMap))
     {
-        numBytes = numBytes + incrementBytes; //更新文件头中的文件大小
-        return TRUE;
+        Truncate(freeMap, oldSectors);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Truncate
+// 	Give back every data sector after the first "sectors", along with
+//	any indirect blocks no longer needed.
+//----------------------------------------------------------------------
+
+void FileHeader::Truncate(BitMap *freeMap, int sectors)
+{
+    Extent *last;
+    int drop;
+
+    while (numSectors > sectors)
+    {
+        last = &extents[numExtents - 1];
+        drop = min(last->length, numSectors - sectors);
+        for (int i = last->length - drop; i < last->length; i++)
+        {
+            ASSERT(freeMap->Test(last->start + i)); // ought to be marked!
+            freeMap->Clear(last->start + i);
+        }
+        last->length -= drop;
+        numSectors -= drop;
+        if (last->length == 0)
+            numExtents--;
+    }
+    lastExtent = 0;
+    extentsChanged = TRUE;
+    (void)MapIndirect(freeMap); // only frees blocks, can't fail
+}
+
+//----------------------------------------------------------------------
+// FileHeader::MapIndirect
+// 	Allocate the indirect blocks numExtents extents need, and free the
+//	ones they don't.  Return FALSE if the disk is full; the caller
+//	then truncates the file, which frees what was allocated here.
+//----------------------------------------------------------------------
+
+bool FileHeader::MapIndirect(BitMap *freeMap)
+{
+    int beyond = numExtents - NumDirectExtents - ExtentsPerBlock;
+    int children = (beyond > 0) ? divRoundUp(beyond, ExtentsPerBlock) : 0;
+    bool needSingle = (bool)(numExtents > NumDirectExtents);
+    int i;
+
+    if (needSingle && (singleIndirect == -1) &&
+        ((singleIndirect = freeMap->Find()) == -1))
+        return FALSE;
+    if ((children > 0) && (doubleIndirect == -1) &&
+        ((doubleIndirect = freeMap->Find()) == -1))
+        return FALSE;
+    for (i = 0; i < children; i++)
+        if ((indirect[i] == -1) && ((indirect[i] = freeMap->Find()) == -1))
+            return FALSE;
+
+    for (i = children; i < PointersPerBlock; i++)
+        if (indirect[i] != -1)
+        {
+            freeMap->Clear(indirect[i]);
+            indirect[i] = -1;
+        }
+    if ((children == 0) && (doubleIndirect != -1))
+    {
+        freeMap->Clear(doubleIndirect);
+        doubleIndirect = -1;
+    }
+    if (!needSingle && (singleIndirect != -1))
+    {
+        freeMap->Clear(singleIndirect);
+        singleIndirect = -1;
     }
-    //最后一个扇区的剩余空间不足以容纳要写入的数据，分配新的磁盘块
-    int moreSectors = divRoundUp(newSectorBytes, SectorSize); //新加扇区块数
-    if (numSectors + moreSectors > 30)
-        return FALSE;                      //文件过大，超出 30 个磁盘块
-    if (freeMap->NumClear() < moreSectors) //磁盘无足够的空闲块
-        return false;
-    //没有超出文件大小的限制，并且磁盘有足够的空闲块
-    for (int i = numSectors; i < numSectors + moreSectors; i++)
-        dataSectors[i] = freeMap->Find();
-    numBytes = numBytes + incrementBytes; //更新文件大小
-    numSectors = numSectors + moreSectors; //更新文件扇区块数
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and its indirect blocks.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
 
 void FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++)
-    {
-        ASSERT(freeMap->Test((int)dataSectors[i])); // ought to be marked!
-        freeMap->Clear((int)dataSectors[i]);
-    }
+    Truncate(freeMap, 0);
+    numBytes = 0;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk.
+// 	Fetch contents of file header from disk, along with its indirect
+//	blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
 
 void FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    int buf[SectorSize / sizeof(int)];
+    DiskFileHeader *disk = (DiskFileHeader *)buf;
+    int i, n, sectors;
+
+    synchDisk->ReadSector(sector, (char *)buf);
+    numBytes = disk->numBytes;
+    numSectors = disk->numSectors;
+    numExtents = disk->numExtents;
+    singleIndirect = disk->singleIndirect;
+    doubleIndirect = disk->doubleIndirect;
+    ASSERT((numExtents >= 0) && (numExtents <= MaxExtents));
+    MakeRoom(numExtents);
+
+    n = min(numExtents, NumDirectExtents);
+    for (i = 0; i < n; i++)
+        extents[i] = disk->direct[i];
+    if (singleIndirect != -1)
+    {
+        synchDisk->ReadSector(singleIndirect, (char *)buf);
+        n = min(numExtents - NumDirectExtents, ExtentsPerBlock);
+        bcopy((char *)buf, (char *)&extents[NumDirectExtents],
+              n * sizeof(Extent));
+    }
+    for (i = 0; i < PointersPerBlock; i++)
+        indirect[i] = -1;
+    if (doubleIndirect != -1)
+    {
+        synchDisk->ReadSector(doubleIndirect, (char *)indirect);
+        for (i = 0; i < PointersPerBlock; i++)
+        {
+            int first = NumDirectExtents + (i + 1) * ExtentsPerBlock;
+
+            if (first >= numExtents)
+                break;
+            synchDisk->ReadSector(indirect[i], (char *)buf);
+            n = min(numExtents - first, ExtentsPerBlock);
+            bcopy((char *)buf, (char *)&extents[first], n * sizeof(Extent));
+        }
+    }
+
+    for (i = sectors = 0; i < numExtents; i++)
+    {
+        firstSector[i] = sectors;
+        sectors += extents[i].length;
+    }
+    ASSERT(sectors == numSectors);
+    lastExtent = 0;
+    extentsChanged = FALSE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk.
+// 	Write the modified contents of the file header back to disk.  The
+//	indirect blocks are only written if the extents changed.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
 
 void FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this);
+    int buf[SectorSize / sizeof(int)];
+    DiskFileHeader *disk = (DiskFileHeader *)buf;
+    int i, n;
+
+    bzero((char *)buf, SectorSize);
+    disk->numBytes = numBytes;
+    disk->numSectors = numSectors;
+    disk->numExtents = numExtents;
+    disk->singleIndirect = singleIndirect;
+    disk->doubleIndirect = doubleIndirect;
+    n = min(numExtents, NumDirectExtents);
+    for (i = 0; i < n; i++)
+        disk->direct[i] = extents[i];
+    synchDisk->WriteSector(sector, (char *)buf);
+
+    if (!extentsChanged)
+        return;
+    if (singleIndirect != -1)
+    {
+        bzero((char *)buf, SectorSize);
+        n = min(numExtents - NumDirectExtents, ExtentsPerBlock);
+        bcopy((char *)&extents[NumDirectExtents], (char *)buf,
+              n * sizeof(Extent));
+        synchDisk->WriteSector(singleIndirect, (char *)buf);
+    }
+    if (doubleIndirect != -1)
+    {
+        synchDisk->WriteSector(doubleIndirect, (char *)indirect);
+        for (i = 0; (i < PointersPerBlock) && (indirect[i] != -1); i++)
+        {
+            int first = NumDirectExtents + (i + 1) * ExtentsPerBlock;
+
+            bzero((char *)buf, SectorSize);
+            n = min(numExtents - first, ExtentsPerBlock);
+            bcopy((char *)&extents[first], (char *)buf, n * sizeof(Extent));
+            synchDisk->WriteSector(indirect[i], (char *)buf);
+        }
+    }
+    extentsChanged = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -141,12 +387,41 @@ void FileHeader::WriteBack(int sector)
 //	offset in the file) to a physical address (the sector where the
 //	data at the offset is stored).
 //
+//	Sequential access stays in one extent, or moves on to the next
+//	one, so those are checked first; otherwise the extent is found by
+//	binary search.  顺序访问先检查上次命中的 extent，否则二分查找。
+//
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
 int FileHeader::ByteToSector(int offset)
 {
-    return (dataSectors[offset / SectorSize]);
+    int sector = offset / SectorSize;
+    int i = lastExtent, low, high;
+
+    ASSERT((sector >= 0) && (sector < numSectors));
+    if ((i < numExtents) && (sector >= firstSector[i]) &&
+        (sector - firstSector[i] < extents[i].length))
+        ; // same extent as last time
+    else if ((i + 1 < numExtents) && (sector >= firstSector[i + 1]) &&
+             (sector - firstSector[i + 1] < extents[i + 1].length))
+        i++; // the next one
+    else
+    {
+        low = 0;
+        high = numExtents - 1;
+        while (low < high)
+        { // last extent beginning at or before "sector"
+            i = (low + high + 1) / 2;
+            if (firstSector[i] <= sector)
+                low = i;
+            else
+                high = i - 1;
+        }
+        i = low;
+    }
+    lastExtent = i;
+    return extents[i].start + (sector - firstSector[i]);
 }
 
 //----------------------------------------------------------------------
@@ -170,13 +445,18 @@ void FileHeader::Print()
     int i, j, k;
     char *data = new char[SectorSize];
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-        printf("%d ", dataSectors[i]);
+    printf("FileHeader contents.  File size: %d.  File extents:\n", numBytes);
+    for (i = 0; i < numExtents; i++)
+        printf("%d-%d ", extents[i].start,
+               extents[i].start + extents[i].length - 1);
+    if (singleIndirect != -1)
+        printf("\nIndirect block: %d", singleIndirect);
+    if (doubleIndirect != -1)
+        printf("\nDouble indirect block: %d", doubleIndirect);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++)
     {
-        synchDisk->ReadSector(dataSectors[i], data);
+        synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++)
         {
             if ('\040' <= data[j] && data[j] <= '\176') // isprint(data[j])
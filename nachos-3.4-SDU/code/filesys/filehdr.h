@@ -17,19 +17,55 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect ((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize (NumDirect * SectorSize)
+// A run of "length" consecutive disk sectors, beginning at "start",
+// holding consecutive sectors of a file. 一个extent：从 start 开始的 length 个连续扇区。
+
+class Extent
+{
+public:
+  int start;  // first disk sector of the run
+  int length; // number of sectors in the run
+};
+
+// The file header sector holds a few extents directly.  More are kept
+// in an indirect block (a sector full of extents), and after that in
+// the indirect blocks listed by a double indirect block (a sector
+// full of sector numbers).
+#define NumDirectExtents ((int)((SectorSize - 5 * sizeof(int)) / sizeof(Extent)))
+#define ExtentsPerBlock ((int)(SectorSize / sizeof(Extent)))
+#define PointersPerBlock ((int)(SectorSize / sizeof(int)))
+#define MaxExtents (NumDirectExtents + ExtentsPerBlock + \
+                    PointersPerBlock * ExtentsPerBlock)
+#define MaxFileSize (NumSectors * SectorSize) // the disk runs out first
+
+// The file header as it is laid out in its disk sector. 文件头在磁盘上的格式。
+
+class DiskFileHeader
+{
+public:
+  int numBytes;                      // Number of bytes in the file
+  int numSectors;                    // Number of data sectors in the file
+  int numExtents;                    // Number of extents, in all
+  int singleIndirect;                // Indirect extent block, -1 if none
+  int doubleIndirect;                // Double indirect block, -1 if none
+  Extent direct[NumDirectExtents];   // The first extents of the file
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks.
+// The file header is organized as a list of extents: runs of
+// consecutive data sectors.  Growing a file extends its last extent in
+// place when the sectors after it are free, and otherwise asks the
+// free map for as long a run as it can get, so that a file usually
+// lies in a few runs and can be read sequentially.
 //
 // The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// On disk, it is a single sector (DiskFileHeader), plus an indirect
+// block and a double indirect block once the file has more extents
+// than fit in that sector.  In memory, all of the extents are kept in
+// one array, along with where in the file each one begins, so that
+// ByteToSector is a binary search (or, for sequential access, a
+// check of the extent used last).
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -39,12 +75,15 @@ class FileHeader
 {
 public:
   FileHeader();
+  ~FileHeader();
 
   bool Allocate(BitMap *bitMap, int fileSize); // Initialize a file header,
                                                //  including allocating space
                                                //  on disk for the file data
 
   bool Allocate(BitMap *freeMap, int fileSize, int incrementBytes);
+                                   // Grow a file of "fileSize" bytes
+                                   //  by "incrementBytes"
   void Deallocate(BitMap *bitMap); // De-allocate this file's
                                    //  data blocks
 
@@ -62,10 +101,25 @@ public:
   void Print(); // Print the contents of the file.
 
 private:
-  int numBytes;               // Number of bytes in the file
-  int numSectors;             // Number of data sectors in the file
-  int dataSectors[NumDirect]; // Disk sector numbers for each data
-                              // block in the file
+  int numBytes;         // Number of bytes in the file
+  int numSectors;       // Number of data sectors in the file
+  int numExtents;       // Number of extents in use
+  int maxExtents;       // Size of the arrays below
+  Extent *extents;      // Where the data is, in file order
+  int *firstSector;     // firstSector[i]: the sector of the file
+                        // extents[i] begins with
+  int lastExtent;       // Extent ByteToSector found last time
+  int singleIndirect;   // Indirect extent block, -1 if none
+  int doubleIndirect;   // Double indirect block, -1 if none
+  int indirect[PointersPerBlock]; // Blocks listed by doubleIndirect
+  bool extentsChanged;  // Indirect blocks need writing back
+
+  bool AddSectors(BitMap *freeMap, int count); // Grow by "count" sectors
+  void Truncate(BitMap *freeMap, int sectors); // Free all but the first
+                                               // "sectors" sectors
+  bool MapIndirect(BitMap *freeMap); // Allocate or free indirect
+                                     // blocks to fit numExtents
+  void MakeRoom(int count);          // Make the arrays hold "count"
 };
 
 #endif // FILEHDR_H
@@ -22,11 +22,22 @@
 //	kept "open" continuously while Nachos is running.
 //
 //	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	directory, if the operation succeeds, the changes are written
+//	immediately back to disk (the files are kept open during all this
+//	time).  If the operation fails, and we have modified part of the
+//	directory, we simply discard the changed version, without writing
+//	it back to disk.
+//
+//	The bitmap is different: one copy of it stays in memory, and is
+//	the authoritative one.  Operations that fail must undo their
+//	changes to it.  Only the words of it that changed are written back,
+//	every FreeMapFlushOps operations and on Sync(). 空闲扇区位图常驻内存，只在每FreeMapFlushOps次操作后或Sync()时写回改动过的部分。
+//
+//	The part of each operation that writes to the disk is a journal
+//	transaction (see journal.h), so that a crash leaves either all of
+//	its metadata updates or none.  With the journal on, the free map
+//	is written back by every operation that changes it, in the same
+//	transaction. 每个操作的写盘部分是一个日志事务；日志开启时空闲位图随每个操作写回。
 //
 // 	Our implementation at this point has the following restrictions:
 //
@@ -45,11 +56,14 @@
 
 #include "copyright.h"
 
+#include "system.h"
 #include "disk.h"
 #include "bitmap.h"
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "dcache.h"
+#include "journal.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known
@@ -61,12 +75,17 @@
 // Initial file sizes for the bitmap and directory; until the file system
 // supports extensible files, the directory size sets the maximum number
 // of files that can be loaded onto the disk.
-#define FreeMapFileSize (NumSectors / BitsInByte)
+#define FreeMapFileSize (divRoundUp(NumSectors, BitsInWord) * sizeof(unsigned int))
+                        // the map is kept a word at a time
 #define NumDirEntries 10
-#define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize (Directory::FileSize(NumDirEntries))
 
 #define CurDirFileSize (sizeof(CurDir))
 
+// How many changes to the free map may pile up in memory before the
+// changed part of it is written back.
+#define FreeMapFlushOps 16
+
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
@@ -180,46 +199,56 @@
 
 bool FileSystem::Create(char *name, int initialSize)
 {
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
     int sector;
     bool success;
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
+    // open the root afresh: CreateTest may have grown it behind
+    // directoryFile's back 目录可能已被扩展，重新打开以读取最新的文件头
+    dirFile = new OpenFile(DirectorySector);
     directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    directory->FetchFrom(dirFile);
 
     if (directory->Find(name) != -1)
         success = FALSE; // file is already in directory
     else
     {
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
         sector = freeMap->Find(); // find a sector to hold the file header
         if (sector == -1)
             success = FALSE; // no free block for file header
         else if (!directory->Add(name, sector))
+        {
+            freeMap->Clear(sector);
             success = FALSE; // no space in directory
+        }
         else
         {
             hdr = new FileHeader;
             if (!hdr->Allocate(freeMap, initialSize))
+            {
+                freeMap->Clear(sector);
                 success = FALSE; // no space on disk for data
+            }
             else
             {
                 success = TRUE;
                 // everthing worked, flush all changes back to disk
+                journal->Begin();
                 hdr->WriteBack(sector);
-                directory->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
+                directory->WriteBack(dirFile);
+                dentryCache->Enter(DirectorySector, name, sector, FileType);
+                FreeMapChanged();
+                journal->End();
             }
             delete hdr;
         }
-        delete freeMap;
     }
     delete directory;
+    delete dirFile;
     return success;
 }
 
@@ -237,15 +266,17 @@ OpenFile *
 FileSystem::Open(char *name)
 {
     Directory *directory = new Directory(NumDirEntries);
+    OpenFile *dirFile = new OpenFile(DirectorySector);
     OpenFile *openFile = NULL;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
+    directory->FetchFrom(dirFile);
     sector = directory->Find(name);
     if (sector >= 0)
         openFile = new OpenFile(sector); // name was found in directory
     delete directory;
+    delete dirFile;
     return openFile; // return NULL if not found
 }
 
@@ -257,6 +288,9 @@ FileSystem::Open(char *name)
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
+//	If the file is open, the space is deleted when it is last closed
+//	(see inode.h); until then the OpenFiles on it still work.
+//
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
 //	in the file system.
 //
@@ -265,34 +299,34 @@ FileSystem::Open(char *name)
 
 bool FileSystem::Remove(char *name)
 {
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
-    FileHeader *fileHdr;
+    Inode *inode;
     int sector;
 
+    dirFile = new OpenFile(DirectorySector);
     directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    directory->FetchFrom(dirFile);
     sector = directory->Find(name);
     if (sector == -1)
     {
         delete directory;
+        delete dirFile;
         return FALSE; // file not found
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
-
-    fileHdr->Deallocate(freeMap); // remove data blocks
-    freeMap->Clear(sector);       // remove header block
+    journal->Begin();
+    inode = inodeTable->Get(sector);
+    inodeTable->Remove(inode);
+    inodeTable->Put(inode); // frees the header and data blocks, unless
+                            // the file is still open somewhere
     directory->Remove(name);
 
-    freeMap->WriteBack(freeMapFile);     // flush to disk
-    directory->WriteBack(directoryFile); // flush to disk
-    delete fileHdr;
+    FreeMapChanged();
+    directory->WriteBack(dirFile); // flush to disk
+    journal->End();
+    dentryCache->Enter(DirectorySector, name, -1, -1);
     delete directory;
-    delete freeMap;
+    delete dirFile;
     return TRUE;
 }
 
@@ -304,10 +338,12 @@ bool FileSystem::Remove(char *name)
 void FileSystem::List()
 {
     Directory *directory = new Directory(NumDirEntries);
+    OpenFile *dirFile = new OpenFile(DirectorySector);
 
-    directory->FetchFrom(directoryFile);
+    directory->FetchFrom(dirFile);
     directory->List();
     delete directory;
+    delete dirFile;
 }
 
 //----------------------------------------------------------------------
@@ -324,7 +360,6 @@ void FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
     Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:");
@@ -335,96 +370,105 @@ void FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
+    OpenFile *dirFile = new OpenFile(DirectorySector);
+    directory->FetchFrom(dirFile);
     directory->Print();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
     delete directory;
+    delete dirFile;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::getBitMap
+// 	Return the free sector map.  There is only one, kept in memory;
+//	the caller must not delete it, and must call setBitMap after
+//	changing it.
+//----------------------------------------------------------------------
+
 BitMap *FileSystem::getBitMap()
 {
-    //NumSectors: DISK 上总扇区数（共有 32*32=1024 个扇区）
-    BitMap *freeBitMap = new BitMap(NumSectors);
-    freeBitMap->FetchFrom(freeMapFile);
-    return freeBitMap;
+    //NumSectors: DISK 上总扇区数（默认 32*32=1024 个扇区，可用 -dg 指定）
+    return freeMap;
 }
 
-int FileSystem::FindDir(char *name)
+//----------------------------------------------------------------------
+// FileSystem::LookupEntry
+// 	Look "name" up in the directory whose header is at "dirSector".
+//	The dentry cache is asked first; only if it does not know the
+//	answer is the directory read from disk, and the answer (found or
+//	not) is then remembered. 先查路径缓存，未命中才从磁盘读目录，并把结果（包括不存在）记入缓存。
+//
+//	Returns the sector of the file's header, or -1 if there is no such
+//	file; "*type" is set to its type.
+//----------------------------------------------------------------------
+
+int FileSystem::LookupEntry(int dirSector, char *name, int *type)
 {
-    int sector;
     OpenFile *openFile;
     Directory *directory;
+    int sector;
+
+    if (dentryCache->Lookup(dirSector, name, &sector, type))
+        return sector;
+
+    openFile = new OpenFile(dirSector);
+    directory = new Directory(NumDirEntries);
+    directory->FetchFrom(openFile);
+    sector = directory->Find(name);
+    *type = directory->getType(name);
+    dentryCache->Enter(dirSector, name, sector, *type);
+    delete directory;
+    delete openFile;
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindDir
+// 	Find the directory that "name" is (or would be) in: walk every
+//	path component but the last, from the root if the path starts
+//	with '/', otherwise from the current directory.  Each component
+//	must be a directory.
+//
+//	Returns the sector of that directory's header, or -1.
+//----------------------------------------------------------------------
+
+int FileSystem::FindDir(char *name)
+{
+    int sector, type;
+    int str_pos = 0;
+    int sub_str_pos = 0;
+    char sub_str[FileNameMaxLen + 1];
+
     if (name[0] == '/')
     {
         sector = DirectorySector;
-        directory = new Directory(NumDirEntries);
-        directory->FetchFrom(directoryFile);
-        int str_pos = 1;
-        int sub_str_pos = 0;
-        char sub_str[10];
-        while (str_pos < strlen(name))
-        {
-            sub_str[sub_str_pos++] = name[str_pos++];
-            if (name[str_pos] == '/')
-            {
-                sub_str[sub_str_pos] = '\0';
-                if ((sector = directory->Find(sub_str)) == -1 || directory->getType(sub_str))
-                {
-                    DEBUG('f', "FindDir\n");
-                    delete directory;
-                    return -1;
-                }
-
-                openFile = new OpenFile(sector);
-                directory->FetchFrom(openFile);
-                delete openFile;
-                str_pos++;
-                sub_str_pos = 0;
-            }
-        }
-        delete directory;
+        str_pos = 1;
     }
     else
-    {
-        CurDir *curDir = new CurDir;
-        curDir->FetchFrom(curDirFile);
-        sector = curDir->sector;
-        delete curDir;
+        sector = curDirSector;
 
-        directory = new Directory(NumDirEntries);
-        directory->FetchFrom(curDirectoryFile);
-        int str_pos = 0;
-        int sub_str_pos = 0;
-        char sub_str[10];
-        while (str_pos < strlen(name))
+    while (name[str_pos] != '\0')
+    {
+        if (sub_str_pos < FileNameMaxLen) // longer names only match
+            sub_str[sub_str_pos++] = name[str_pos]; // on this much
+        str_pos++;
+        if (name[str_pos] == '/')
         {
-            sub_str[sub_str_pos++] = name[str_pos++];
-            if (name[str_pos] == '/')
+            sub_str[sub_str_pos] = '\0';
+            if ((sector = LookupEntry(sector, sub_str, &type)) == -1 || type != DirType)
             {
-                sub_str[sub_str_pos] = '\0';
-                if ((sector = directory->Find(sub_str)) == -1 || directory->getType(sub_str))
-                {
-                    DEBUG('f', "FindDir\n");
-                    delete directory;
-                    return -1;
-                }
-
-                openFile = new OpenFile(sector);
-                directory->FetchFrom(openFile);
-                delete openFile;
-                str_pos++;
-                sub_str_pos = 0;
+                DEBUG('f', "FindDir\n");
+                return -1;
             }
+            str_pos++;
+            sub_str_pos = 0;
         }
-        DEBUG('f', "%d\n", sector);
-        delete directory;
     }
+    DEBUG('f', "%d\n", sector);
     return sector;
 }
 
@@ -449,16 +493,59 @@ bool FileSystem::FindName(char *name, char *fileName)
     return true;
 }
 
-void FileSystem::setBitMap(BitMap *freeMap)
+//----------------------------------------------------------------------
+// FileSystem::setBitMap
+// 	Somebody outside (OpenFile::WriteAt) changed the free sector map
+//	it got from getBitMap.
+//----------------------------------------------------------------------
+
+void FileSystem::setBitMap(BitMap *map)
+{
+    ASSERT(map == freeMap);
+    FreeMapChanged();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FreeMapChanged
+// 	Count one more operation that changed the free map, and write
+//	back the changed part of it once there have been enough -- or at
+//	once, if the operation is journaled.
+//----------------------------------------------------------------------
+
+void FileSystem::FreeMapChanged()
 {
-    freeMap->WriteBack(freeMapFile);
+    if ((++freeMapChanges >= FreeMapFlushOps) || journal->Enabled())
+    {
+        freeMap->WriteBackDirty(freeMapFile);
+        freeMapChanges = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Bring the disk up to date: write back the headers of open files
+//	that changed, the changed part of the free map, then commit what
+//	the journal holds, write every dirty sector in the disk's buffer
+//	cache, and empty the journal.
+//----------------------------------------------------------------------
+
+void FileSystem::Sync()
+{
+    inodeTable->Sync();
+    journal->Begin();
+    if (freeMap->IsDirty())
+        freeMap->WriteBackDirty(freeMapFile);
+    journal->End();
+    freeMapChanges = 0;
+    journal->Commit();
+    synchDisk->Sync();
+    journal->Checkpoint();
 }
 
 bool FileSystem::CreateTest(char *name, int initialSize)
 {
     OpenFile *openFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
 
     int sector;
@@ -489,48 +576,23 @@ bool FileSystem::CreateTest(char *name, int initialSize)
         delete directory;
         return false; // file is already in directory
     }
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
     sector = freeMap->Find(); // find a sector to hold the file header
     if (sector == -1)
     {
         DEBUG('f', "CreateTest freeMap->Find() fail\n");
         delete openFile;
         delete directory;
-        delete freeMap;
         return false; // no free block for file header
     }
 
-    //处理相对地址字符
-    if (name[0] != '/')
-    {
-        DEBUG('f', "CreateTest name[0] != '/'\n");
-        char tmp_file_name[FileNameMaxLen + 1];
-        CurDir *curDir = new CurDir;
-        curDir->FetchFrom(curDirFile);
-        strcpy(tmp_file_name, curDir->path);
-        if (!strcmp(tmp_file_name, "/"))
-        {
-            strcat(tmp_file_name, name);
-            strcpy(name, tmp_file_name);
-        }
-        else
-        {
-            strcat(tmp_file_name, "/");
-            strcat(tmp_file_name, name);
-            strcpy(name, tmp_file_name);
-        }
-        delete curDir;
-    }
-
     if (initialSize == -1)
     {
-        if (!directory->AddTest(file_name, name, sector, DirType))
+        if (!directory->Add(file_name, sector, DirType))
         {
-            DEBUG('f', "CreateTest AddTest fail\n");
+            DEBUG('f', "CreateTest Add fail\n");
+            freeMap->Clear(sector);
             delete openFile;
             delete directory;
-            delete freeMap;
             return false;
         }
         hdr = new FileHeader;
@@ -538,12 +600,13 @@ bool FileSystem::CreateTest(char *name, int initialSize)
         if (!hdr->Allocate(freeMap, initialSize))
         {
             DEBUG('f', "CreateTest hdr->Allocate fail\n");
+            freeMap->Clear(sector);
             delete openFile;
             delete directory;
-            delete freeMap;
             delete hdr;
             return false;
         }
+        journal->Begin();
         hdr->WriteBack(sector);
         OpenFile *tmpOpenFile = new OpenFile(sector);
         Directory *tmpDirectory = new Directory(NumDirEntries);
@@ -552,33 +615,38 @@ bool FileSystem::CreateTest(char *name, int initialSize)
         delete tmpDirectory;
 
         directory->WriteBack(openFile);
-        freeMap->WriteBack(freeMapFile);
+        dentryCache->InvalidateDir(sector); // new, empty directory
+        dentryCache->Enter(dir_sector, file_name, sector, DirType);
+        FreeMapChanged();
+        journal->End();
     }
     else
     {
-        if (!directory->AddTest(file_name, name, sector, FileType))
+        if (!directory->Add(file_name, sector, FileType))
         {
-            DEBUG('f', "CreateTest AddTest fail\n");
+            DEBUG('f', "CreateTest Add fail\n");
+            freeMap->Clear(sector);
             delete openFile;
             delete directory;
-            delete freeMap;
             return false;
         }
         hdr = new FileHeader;
         if (!hdr->Allocate(freeMap, initialSize))
         {
             DEBUG('f', "CreateTest hdr->Allocate fail\n");
+            freeMap->Clear(sector);
             delete openFile;
             delete directory;
-            delete freeMap;
             delete hdr;
             return false;
         }
+        journal->Begin();
         hdr->WriteBack(sector);
         directory->WriteBack(openFile);
-        freeMap->WriteBack(freeMapFile);
+        dentryCache->Enter(dir_sector, file_name, sector, FileType);
+        FreeMapChanged();
+        journal->End();
     }
-    delete freeMap;
     delete hdr;
 
     delete openFile;
@@ -588,10 +656,8 @@ bool FileSystem::CreateTest(char *name, int initialSize)
 
 OpenFile *FileSystem::OpenTest(char *name)
 {
-    Directory *directory;
     OpenFile *resFile = NULL;
-    OpenFile *openFile;
-    int sector;
+    int sector, type;
     int dir_sector;
     char file_name[FileNameMaxLen + 1];
 
@@ -603,22 +669,15 @@ OpenFile *FileSystem::OpenTest(char *name)
         return resFile;
     }
 
-    openFile = new OpenFile(dir_sector);
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(openFile);
-
-    if ((sector = directory->Find(file_name)) != -1)
+    if ((sector = LookupEntry(dir_sector, file_name, &type)) != -1)
         resFile = new OpenFile(sector); // name was found in directory
-    delete openFile;
-    delete directory;
     return resFile; // return NULL if not found
 }
 
 bool FileSystem::RemoveTest(char *name, int cascade)
 {
     Directory *directory;
-    BitMap *freeMap;
-    FileHeader *fileHdr;
+    Inode *inode;
     OpenFile *openFile;
     int sector;
     int dir_sector;
@@ -658,44 +717,50 @@ bool FileSystem::RemoveTest(char *name, int cascade)
             }
             int tableSize;
             DirectoryEntry *table;
+            char *childPath = new char[strlen(name) + FileNameMaxLen + 2];
             removeDirectory->getTable(tableSize, table);
             for (int i = 0; i < tableSize; i++)
-                if (table[i].inUse && !RemoveTest(table[i].path, 1))
+            {
+                if (!table[i].inUse)
+                    continue;
+                sprintf(childPath, "%s/%s", name, table[i].name);
+                if (!RemoveTest(childPath, 1))
                 {
                     DEBUG('f', "RemoveTest %s -r fasle\n", name);
+                    delete[] childPath;
                     delete openFile;
                     delete directory;
                     delete removeFile;
                     delete removeDirectory;
                     return false;
                 }
+            }
+            delete[] childPath;
         }
         delete removeFile;
         delete removeDirectory;
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
-
-    fileHdr->Deallocate(freeMap); // remove data blocks
-    freeMap->Clear(sector);       // remove header block
+    journal->Begin();
+    inode = inodeTable->Get(sector);
+    inodeTable->Remove(inode);
+    inodeTable->Put(inode); // frees the header and data blocks, unless
+                            // the file is still open somewhere
+    if (directory->getType(file_name) == DirType)
+        dentryCache->InvalidateDir(sector);
     directory->Remove(file_name);
 
-    freeMap->WriteBack(freeMapFile); // flush to disk
+    FreeMapChanged();
     directory->WriteBack(openFile);  // flush to disk
-    delete fileHdr;
+    journal->End();
+    dentryCache->Enter(dir_sector, file_name, -1, -1);
     delete directory;
-    delete freeMap;
+    delete openFile;
     return true;
 }
 
 bool FileSystem::cd(char *name)
 {
-    OpenFile *openFile;
-    Directory *directory;
-    int sector;
+    int sector, type;
     int dir_sector;
     char file_name[FileNameMaxLen + 1];
 
@@ -710,10 +775,13 @@ bool FileSystem::cd(char *name)
         CurDir *curDir = new CurDir;
         curDir->sector = sector;
         strcpy(curDir->path, name);
+        journal->Begin();
         curDir->WriteBack(curDirFile);
+        journal->End();
         delete curDir;
         delete curDirectoryFile;
         curDirectoryFile = new OpenFile(sector);
+        curDirSector = sector;
         return true;
     }
 
@@ -722,14 +790,9 @@ bool FileSystem::cd(char *name)
         DEBUG('f', "cd %s FindDir fasle\n", name);
         return false;
     }
-    openFile = new OpenFile(dir_sector);
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(openFile);
-    if ((sector = directory->Find(file_name)) == -1 || directory->getType(file_name))
+    if ((sector = LookupEntry(dir_sector, file_name, &type)) == -1 || type != DirType)
     {
         DEBUG('f', "cd %s Find fasle\n", name);
-        delete openFile;
-        delete directory;
         return false;
     }
 
@@ -758,13 +821,13 @@ bool FileSystem::cd(char *name)
     CurDir *curDir = new CurDir;
     curDir->sector = sector;
     strcpy(curDir->path, name);
+    journal->Begin();
     curDir->WriteBack(curDirFile);
+    journal->End();
     delete curDir;
     delete curDirectoryFile;
     curDirectoryFile = new OpenFile(sector);
-
-    delete openFile;
-    delete directory;
+    curDirSector = sector;
     return true;
 }
 
@@ -778,18 +841,22 @@ void FileSystem::pwd()
 void FileSystem::ListTest()
 {
     Directory *directory = new Directory(NumDirEntries);
+    OpenFile *dirFile = new OpenFile(curDirSector);
 
-    directory->FetchFrom(curDirectoryFile);
+    directory->FetchFrom(dirFile);
     directory->List();
     delete directory;
+    delete dirFile;
 }
 
 FileSystem::FileSystem(bool format)
 {
     DEBUG('f', "Initializing the file system.\n");
+    freeMapChanges = 0;
+    dentryCache = new DentryCache(DentryCacheSize);
     if (format)
     {
-        BitMap *freeMap = new BitMap(NumSectors);
+        freeMap = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
         CurDir *curDir = new CurDir;
         FileHeader *mapHdr = new FileHeader;
@@ -803,6 +870,7 @@ FileSystem::FileSystem(bool format)
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
         freeMap->Mark(CurDirSector);
+        journal->Format(freeMap); // the last track is the journal
 
         // Second, allocate space for the data blocks containing the contents
         // of the directory and bitmap files.  There better be enough space!
@@ -843,13 +911,13 @@ FileSystem::FileSystem(bool format)
         strcpy(curDir->path, "/");
         curDir->WriteBack(curDirFile);
         curDirectoryFile = new OpenFile(curDir->sector);
+        curDirSector = curDir->sector;
 
         if (DebugIsEnabled('f'))
         {
             freeMap->Print();
             directory->Print();
         }
-        delete freeMap;
         delete directory;
         delete curDir;
         delete mapHdr;
@@ -860,23 +928,45 @@ FileSystem::FileSystem(bool format)
     {
         // if we are not formatting the disk, just open the files representing
         // the bitmap and directory; these are left open while Nachos is running
+        // -- once the journal has redone anything a crash left half done
+        journal->Replay();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
         curDirFile = new OpenFile(CurDirSector);
 
+        freeMap = new BitMap(NumSectors); // from now on, kept in memory
+        freeMap->FetchFrom(freeMapFile);
+
         CurDir *curDir = new CurDir;
         curDir->FetchFrom(curDirFile);
         curDirectoryFile = new OpenFile(curDir->sector);
+        curDirSector = curDir->sector;
 
         delete curDir;
     }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the files the file system keeps open, and free the in-memory
+//	free map.  Changes should have been written back with Sync.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    delete curDirectoryFile;
+    delete curDirFile;
+    delete directoryFile;
+    delete freeMapFile;
+    delete freeMap;
+    delete dentryCache;
+}
+
 bool FileSystem::cat(char *name)
 {
     Directory *directory;
     OpenFile *openFile;
-    int sector;
+    int sector, type;
     int dir_sector;
     char file_name[FileNameMaxLen + 1];
 
@@ -893,19 +983,15 @@ bool FileSystem::cat(char *name)
         DEBUG('f', "cat FindDir\n");
         return false;
     }
+    if ((sector = LookupEntry(dir_sector, file_name, &type)) == -1)
+        return false;
 
+    // the directory itself is needed for the printout
     openFile = new OpenFile(dir_sector);
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(openFile);
-
-    if ((sector = directory->Find(file_name)) == -1)
-    {
-        delete openFile;
-        delete directory;
-        return false;
-    }
     directory->cat(file_name);
-    if (!directory->getType(file_name))
+    if (type == DirType)
     {
         delete openFile;
         openFile = new OpenFile(sector);
@@ -72,6 +72,7 @@ public:
 #else // FILESYS
 
 class BitMap;
+class DentryCache;
 
 class FileSystem
 {
@@ -82,6 +83,8 @@ public:
 							 // If "format", there is nothing on
 							 // the disk, so initialize the directory
 							 // and the bitmap of free blocks.
+	~FileSystem();			 // Close the files kept open; Sync
+							 // first
 
 	bool Create(char *name, int initialSize);
 	// Create a file (UNIX creat)
@@ -94,9 +97,12 @@ public:
 
 	void Print(); // List all the files and their contents
 
-	BitMap *getBitMap();
+	BitMap *getBitMap(); // The free sector map.  It stays in
+						 // memory; don't delete it
+	void setBitMap(BitMap *map); // Tell us the map was changed
 
-	void setBitMap(BitMap *freeMap);
+	void Sync(); // Flush the free map, then the disk's
+				 // buffer cache 把空闲扇区位图和磁盘缓存刷回磁盘
 
 	int FindDir(char *name);
 	bool FindName(char *name, char *fileName);
@@ -116,6 +122,18 @@ private:
 
 	OpenFile *curDirFile;							 
 	OpenFile *curDirectoryFile;
+
+	BitMap *freeMap;	  // in-memory copy of the free map file,
+						  // the authoritative one 常驻内存的空闲扇区位图
+	int freeMapChanges;	  // operations that changed it since the
+						  // last flush
+	void FreeMapChanged(); // count one, and maybe flush
+
+	DentryCache *dentryCache; // names recently looked up 路径查找缓存
+	int curDirSector;		  // header sector of the current directory
+	int LookupEntry(int dirSector, char *name, int *type);
+	// find "name" in a directory, via
+	// the dentry cache
 };
 
 #endif // FILESYS
@@ -24,6 +24,8 @@
 #include "directory.h"
 
 #define TransferSize 10 // make it small, just to be difficult
+#define CopyChunkSize (SectorsPerTrack * SectorSize) // -cp copies a track
+                                                     // at a time
 
 //----------------------------------------------------------------------
 // Copy
@@ -380,6 +382,336 @@ void PerformanceTest()
     stats->Print();
 }
 
+//----------------------------------------------------------------------
+// DirectoryBenchmark
+// 	Create "n" empty files in a new directory, look every one of them
+//	up, then remove them all, and print how many disk reads and writes
+//	and how many ticks each phase took.  目录基准：在新目录中创建、查找、删除 n 个文件。
+//----------------------------------------------------------------------
+
+#define BenchDir "/dbench"
+
+static void
+BenchPhase(const char *phase, int n, int ticks, int reads, int writes,
+           int hits)
+{
+    printf("%-8s %6d files: %6d disk reads, %6d disk writes, "
+           "%6d cache hits, %9d ticks\n",
+           phase, n, stats->numDiskReads - reads,
+           stats->numDiskWrites - writes, stats->numCacheHits - hits,
+           stats->totalTicks - ticks);
+}
+
+// Put the path of benchmark file "i" in "path": FALSE if its name
+// would be longer than FileNameMaxLen.
+static bool
+BenchPath(char *path, int i)
+{
+    char name[16]; // "b" and any int
+
+    sprintf(name, "b%d", i);
+    if (strlen(name) > FileNameMaxLen)
+        return FALSE;
+    strcpy(path, BenchDir "/");
+    strcat(path, name);
+    return TRUE;
+}
+
+void DirectoryBenchmark(int n)
+{
+    char path[sizeof(BenchDir) + 1 + FileNameMaxLen]; // "dir/name" and a null
+    OpenFile *openFile;
+    int ticks, reads, writes, hits;
+    int i, done;
+
+    printf("Starting directory benchmark, %d files:\n", n);
+    strcpy(path, BenchDir);
+    if (!fileSystem->CreateTest(path, -1))
+    {
+        printf("Dir bench: can't create %s\n", BenchDir);
+        return;
+    }
+
+    ticks = stats->totalTicks;
+    reads = stats->numDiskReads;
+    writes = stats->numDiskWrites;
+    hits = stats->numCacheHits;
+    for (done = 0; done < n; done++)
+    {
+        if (!BenchPath(path, done))
+        {
+            printf("Dir bench: file names run out at %d\n", done);
+            break;
+        }
+        if (!fileSystem->CreateTest(path, 0))
+        {
+            printf("Dir bench: can't create %s\n", path);
+            break;
+        }
+    }
+    BenchPhase("create", done, ticks, reads, writes, hits);
+
+    ticks = stats->totalTicks;
+    reads = stats->numDiskReads;
+    writes = stats->numDiskWrites;
+    hits = stats->numCacheHits;
+    for (i = 0; i < done; i++)
+    {
+        BenchPath(path, i); // fitted when created
+        if ((openFile = fileSystem->OpenTest(path)) == NULL)
+            printf("Dir bench: can't find %s\n", path);
+        delete openFile;
+    }
+    BenchPhase("lookup", done, ticks, reads, writes, hits);
+
+    ticks = stats->totalTicks;
+    reads = stats->numDiskReads;
+    writes = stats->numDiskWrites;
+    hits = stats->numCacheHits;
+    for (i = 0; i < done; i++)
+    {
+        BenchPath(path, i); // fitted when created
+        if (!fileSystem->RemoveTest(path, 0))
+            printf("Dir bench: can't remove %s\n", path);
+    }
+    BenchPhase("remove", done, ticks, reads, writes, hits);
+
+    strcpy(path, BenchDir);
+    fileSystem->RemoveTest(path, 0);
+}
+
+//----------------------------------------------------------------------
+// DiskStressTest
+// 	Have StressThreads threads each make StressRequests random disk
+//	requests, one after the other, so that the disk queue is rarely
+//	empty; do that under every scheduling policy, and print the
+//	average and 99th percentile request latency, and how long the
+//	whole run took.  The requests go to a scratch disk with no buffer
+//	cache, so every one of them reaches the disk.
+//	磁盘调度压力测试：多个线程同时发出随机请求，比较各调度策略的平均与 p99 延迟。
+//----------------------------------------------------------------------
+
+#define StressThreads 8
+#define StressRequests 64 // per thread
+#define StressDisk "STRESSDISK"
+
+static SynchDisk *stressDisk;
+static Semaphore *stressDone;
+static int stressLatency[StressThreads * StressRequests];
+static int stressCount;
+
+static void
+StressThread(_int which)
+{
+    unsigned int seed = 1 + which; // same requests under every policy
+    char data[SectorSize];
+    int sector, start;
+
+    for (int i = 0; i < StressRequests; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        sector = (seed >> 8) % stressDisk->Sectors();
+        start = stats->totalTicks;
+        if (((seed >> 4) & 3) == 0)
+        { // one request in four is a write
+            bzero(data, SectorSize);
+            stressDisk->WriteSector(sector, data);
+        }
+        else
+            stressDisk->ReadSector(sector, data);
+        stressLatency[stressCount++] = stats->totalTicks - start;
+    }
+    stressDone->V();
+}
+
+void DiskStressTest()
+{
+    int i, j, key, policy, start;
+    double total;
+
+    printf("Disk stress test: %d threads, %d requests each\n",
+           StressThreads, StressRequests);
+    printf("policy\tavg latency\tp99 latency\ttotal ticks\n");
+    stressDone = new Semaphore("disk stress", 0);
+    for (policy = 0; policy < NumDiskPolicies; policy++)
+    {
+        stressDisk = new SynchDisk(StressDisk, 0, (DiskPolicy)policy);
+        stressCount = 0;
+        start = stats->totalTicks;
+        for (i = 0; i < StressThreads; i++)
+        {
+            Thread *t = new Thread("disk stress");
+            t->Fork(StressThread, i);
+        }
+        for (i = 0; i < StressThreads; i++)
+            stressDone->P();
+
+        for (i = 1; i < stressCount; i++)
+        { // insertion sort, for the percentile
+            key = stressLatency[i];
+            for (j = i - 1; (j >= 0) && (stressLatency[j] > key); j--)
+                stressLatency[j + 1] = stressLatency[j];
+            stressLatency[j + 1] = key;
+        }
+        for (i = 0, total = 0; i < stressCount; i++)
+            total += stressLatency[i];
+        printf("%s\t%.0f\t\t%d\t\t%d\n", SynchDisk::PolicyName(policy),
+               total / stressCount,
+               stressLatency[(99 * stressCount - 1) / 100],
+               stats->totalTicks - start);
+        delete stressDisk;
+    }
+    delete stressDone;
+    Unlink(StressDisk);
+}
+
+//----------------------------------------------------------------------
+// DiskGeometryTest
+// 	Make scratch disks from the default size up to a few hundred MB,
+//	and on each, time a seek across the whole disk, random one-sector
+//	reads, and formatting a file system.  The seek and the reads
+//	should cost about the same on every disk (a bigger one is denser,
+//	not slower), and formatting should only grow with the free map.
+//	On a disk bigger than a short can number, also make sure a file
+//	whose header is past sector 32767 can be found again.
+//	The file system's globals are pointed at each scratch disk in turn
+//	while it is formatted, and put back afterwards.
+//	磁盘几何测试：在不同大小的临时磁盘上比较全程寻道、随机读延迟和格式化时间。
+//----------------------------------------------------------------------
+
+#define GeometryDisk "GEODISK"
+#define GeometryReads 64
+
+static int geometries[][2] = {
+    // tracks, sectors per track
+    {DefaultNumTracks, DefaultSectorsPerTrack},
+    {128, 128},  // 2MB
+    {1024, 256}, // 32MB
+    {4096, 512}, // 256MB
+};
+
+// Create a file whose header lands past sector FarSector, by filling
+// the free map below it first; mount the file system again, so that
+// the directory entry is read back from the disk, and check the file.
+// Return its header sector, or -1 if it was lost.
+#define FarSector 0x8000 // one past what a short sector number holds
+
+static int
+FarFileCheck()
+{
+    static char name[] = "/far";
+    BitMap *freeMap = fileSystem->getBitMap();
+    BitMap *filled = new BitMap(FarSector);
+    char data[SectorSize], back[SectorSize];
+    OpenFile *openFile;
+    int i, sector = -1;
+    bool made;
+
+    for (i = 0; i < FarSector; i++)
+        if (!freeMap->Test(i))
+        {
+            freeMap->Mark(i);
+            filled->Mark(i);
+        }
+    fileSystem->setBitMap(freeMap);
+    made = fileSystem->CreateTest(name, SectorSize);
+    for (i = 0; i < FarSector; i++)
+        if (filled->Test(i))
+            freeMap->Clear(i);
+    fileSystem->setBitMap(freeMap);
+    delete filled;
+    if (!made || ((openFile = fileSystem->OpenTest(name)) == NULL))
+        return -1;
+    memset(data, 'f', SectorSize);
+    openFile->WriteAt(data, SectorSize, 0);
+    delete openFile;
+
+    fileSystem->Sync();
+    delete fileSystem;
+    fileSystem = new FileSystem(FALSE);
+    if ((openFile = fileSystem->OpenTest(name)) != NULL)
+    {
+        if ((openFile->ReadAt(back, SectorSize, 0) == SectorSize) &&
+            (memcmp(data, back, SectorSize) == 0))
+            sector = openFile->getHdrSector();
+        delete openFile;
+    }
+    fileSystem->RemoveTest(name, 0);
+    return sector;
+}
+
+void DiskGeometryTest()
+{
+    SynchDisk *savedDisk = synchDisk;
+    Journal *savedJournal = journal;
+    InodeTable *savedInodes = inodeTable;
+    FileSystem *savedFileSystem = fileSystem;
+    int savedTracks = diskNumTracks, savedTrackSize = diskSectorsPerTrack;
+    unsigned int seed = 1;
+    char data[SectorSize];
+    SynchDisk *disk;
+    int g, i, start, writes, fullSeek, formatTicks, far;
+    double total;
+
+    printf("Disk geometry test\n");
+    printf("tracks\tsectors\tsize KB\tfull seek\tavg read\t"
+           "format ticks\tformat writes\n");
+    for (g = 0; g < (int)(sizeof(geometries) / sizeof(geometries[0])); g++)
+    {
+        Unlink(GeometryDisk); // else it keeps the last one's geometry
+        disk = new SynchDisk(GeometryDisk, DefaultCacheSectors,
+                             DefaultDiskPolicy, DefaultDiskBackend,
+                             geometries[g][0], geometries[g][1]);
+
+        disk->ReadRaw(0, data, 1);
+        start = stats->totalTicks;
+        disk->ReadRaw(disk->Sectors() - 1, data, 1);
+        fullSeek = stats->totalTicks - start;
+        for (i = 0, total = 0; i < GeometryReads; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            start = stats->totalTicks;
+            disk->ReadRaw((seed >> 8) % disk->Sectors(), data, 1);
+            total += stats->totalTicks - start;
+        }
+
+        synchDisk = disk;
+        diskNumTracks = disk->Tracks();
+        diskSectorsPerTrack = disk->TrackSize();
+        journal = new Journal(disk);
+        disk->SetJournal(journal);
+        inodeTable = new InodeTable();
+        start = stats->totalTicks;
+        writes = stats->numDiskWrites;
+        fileSystem = new FileSystem(TRUE);
+        fileSystem->Sync();
+        formatTicks = stats->totalTicks - start;
+        writes = stats->numDiskWrites - writes;
+        far = (disk->Sectors() > 2 * FarSector) ? FarFileCheck() : 0;
+        delete fileSystem;
+        disk->SetJournal(NULL);
+        delete inodeTable;
+        delete journal;
+        delete disk;
+
+        printf("%d\t%d\t%d\t%d\t\t%.0f\t\t%d\t\t%d\n", geometries[g][0],
+               geometries[g][1],
+               geometries[g][0] * geometries[g][1] / (1024 / SectorSize),
+               fullSeek, total / GeometryReads, formatTicks, writes);
+        if (far < 0)
+            printf("Geometry: file past sector %d lost\n", FarSector);
+        else if (far > 0)
+            printf("\tfile header at sector %d read back\n", far);
+    }
+    Unlink(GeometryDisk);
+
+    synchDisk = savedDisk;
+    journal = savedJournal;
+    inodeTable = savedInodes;
+    fileSystem = savedFileSystem;
+    diskNumTracks = savedTracks;
+    diskSectorsPerTrack = savedTrackSize;
+}
 
 void CopyTest(char *from, char *to)
 {
@@ -412,9 +744,10 @@ void CopyTest(char *from, char *to)
     openFile = fileSystem->OpenTest(to);
     ASSERT(openFile != NULL);
 
-    // Copy the data in TransferSize chunks
-    buffer = new char[TransferSize];
-    while ((amountRead = fread(buffer, sizeof(char), TransferSize, fp)) > 0)
+    // Copy the data in whole tracks, so each chunk can go to the
+    // disk as one request 按整磁道复制，每块数据可作为一个磁盘请求写入
+    buffer = new char[CopyChunkSize];
+    while ((amountRead = fread(buffer, sizeof(char), CopyChunkSize, fp)) > 0)
         openFile->Write(buffer, amountRead);
     delete[] buffer;
 
@@ -0,0 +1,221 @@
+// inode.cc
+//	Routines to manage the system-wide table of in-memory file
+//	headers.
+//
+//	An inode is on its hash chain from the time its header is read in
+//	until the last reference to it is dropped, or the file is removed.
+//	A removed file's inode leaves the chain at once, but lives on,
+//	unreachable, until the OpenFiles still using it are closed; only
+//	then are the file's sectors (header included) freed. 文件被删除时
+//	inode立即离开散列链，直到仍在使用它的OpenFile关闭后才释放inode及其扇区。
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "inode.h"
+#include "journal.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// InodeTable::InodeTable
+// 	Initialize an empty table.
+//----------------------------------------------------------------------
+
+InodeTable::InodeTable()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+        hashTable[i] = NULL;
+    numInodes = 0;
+    lock = new Lock("inode table");
+}
+
+//----------------------------------------------------------------------
+// InodeTable::~InodeTable
+// 	De-allocate the table, and the inodes of files that were never
+//	closed (they should have been written back by Sync).
+//----------------------------------------------------------------------
+
+InodeTable::~InodeTable()
+{
+    Inode *inode;
+
+    for (int i = 0; i < InodeHashSize; i++)
+        while ((inode = hashTable[i]) != NULL)
+        {
+            hashTable[i] = inode->hashNext;
+            delete inode->hdr;
+            delete inode->lock;
+            delete inode;
+        }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Get
+// 	Return the inode for the file header at "sector", with one more
+//	reference to it.  If no one has the file open, read the header in.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Get(int sector)
+{
+    Inode *inode;
+
+    lock->Acquire();
+    for (inode = hashTable[sector & (InodeHashSize - 1)]; inode != NULL;
+         inode = inode->hashNext)
+        if (inode->sector == sector)
+            break;
+    if (inode == NULL)
+    { // the file's first opener: read the header in
+        inode = new Inode;
+        inode->sector = sector;
+        inode->hdr = new FileHeader;
+        inode->hdr->FetchFrom(sector);
+        inode->refCount = 0;
+        inode->dirty = FALSE;
+        inode->removed = FALSE;
+        inode->lock = new Lock("inode");
+        inode->hashNext = hashTable[sector & (InodeHashSize - 1)];
+        hashTable[sector & (InodeHashSize - 1)] = inode;
+        numInodes++;
+        DEBUG('f', "Inode for header %d read in\n", sector);
+    }
+    inode->refCount++;
+    lock->Release();
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Dup
+// 	Return "inode", which the caller already holds a reference to,
+//	with one more.  Unlike Get, this works for a removed file too.
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Dup(Inode *inode)
+{
+    lock->Acquire();
+    ASSERT(inode->refCount > 0);
+    inode->refCount++;
+    lock->Release();
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Put
+// 	Drop a reference to an inode.  When the last one goes, write the
+//	header back if it changed, and de-allocate the inode.  The table
+//	stays locked until the header is written, so that anyone opening
+//	the file again meanwhile reads the new one.  The write is a
+//	journal operation, begun before the table is locked (beginning
+//	one may have to wait for others to end).
+//
+//	If the file was removed, its data sectors -- as many as it has
+//	now, it may have grown since -- and its header sector are freed
+//	instead, in the same operation.
+//----------------------------------------------------------------------
+
+void InodeTable::Put(Inode *inode)
+{
+    Inode **link;
+
+    journal->Begin();
+    lock->Acquire();
+    ASSERT(inode->refCount > 0);
+    if (--inode->refCount > 0)
+    {
+        lock->Release();
+        journal->End();
+        return;
+    }
+    if (!inode->removed)
+    { // off the hash chain: no one else can find it now
+        for (link = &hashTable[inode->sector & (InodeHashSize - 1)];
+             *link != inode; link = &(*link)->hashNext)
+            ;
+        *link = inode->hashNext;
+        numInodes--;
+    }
+    WriteBack(inode);
+    lock->Release();
+    if (inode->removed)
+    { // nobody can reach the file any more: give its sectors back
+        BitMap *freeMap = fileSystem->getBitMap();
+
+        DEBUG('f', "Freeing removed file, header %d\n", inode->sector);
+        inode->hdr->Deallocate(freeMap);
+        freeMap->Clear(inode->sector);
+        fileSystem->setBitMap(freeMap);
+    }
+    journal->End();
+
+    delete inode->hdr;
+    delete inode->lock;
+    delete inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::WriteBack
+// 	Write an inode's header back to disk, if it has changed since it
+//	was read in or last written back.
+//----------------------------------------------------------------------
+
+void InodeTable::WriteBack(Inode *inode)
+{
+    journal->Begin();
+    inode->lock->Acquire();
+    if (inode->dirty && !inode->removed)
+    {
+        DEBUG('f', "Inode for header %d written back\n", inode->sector);
+        inode->hdr->WriteBack(inode->sector);
+    }
+    inode->dirty = FALSE;
+    inode->lock->Release();
+    journal->End();
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Sync
+// 	Write back every header in the table that has changed.
+//----------------------------------------------------------------------
+
+void InodeTable::Sync()
+{
+    Inode *inode;
+
+    journal->Begin();
+    lock->Acquire(); // nobody is put (and freed) meanwhile
+    for (int i = 0; i < InodeHashSize; i++)
+        for (inode = hashTable[i]; inode != NULL; inode = inode->hashNext)
+            WriteBack(inode);
+    lock->Release();
+    journal->End();
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Remove
+// 	The file whose inode this is is being deleted.  Take the inode off
+//	its hash chain, so that nobody opens it again, and never write the
+//	header back.  The caller still holds its reference, and must Put
+//	it; the last Put frees the file's sectors.
+//----------------------------------------------------------------------
+
+void InodeTable::Remove(Inode *inode)
+{
+    Inode **link;
+
+    lock->Acquire();
+    ASSERT(!inode->removed);
+    for (link = &hashTable[inode->sector & (InodeHashSize - 1)];
+         *link != inode; link = &(*link)->hashNext)
+        ;
+    *link = inode->hashNext;
+    numInodes--;
+    inode->removed = TRUE;
+    lock->Release();
+}
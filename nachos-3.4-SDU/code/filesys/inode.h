@@ -0,0 +1,78 @@
+// inode.h
+//	Data structures for the system-wide table of in-memory file
+//	headers (inodes).
+//
+//	Every OpenFile on the same file shares one copy of its header,
+//	so that what one of them changes (the file grew) the others see
+//	at once.  The header is read from disk when the file is first
+//	opened, and written back only if it changed: when the last
+//	OpenFile on it is closed, or on Sync. 系统级内存文件头（inode）表：同一文件的
+//	所有OpenFile共享一份文件头，只在最后一次关闭或Sync时写回被修改过的文件头。
+//
+//	A file removed while open (UNIX unlink) stays usable through the
+//	OpenFiles that have it; its sectors are freed when the last of
+//	them is closed. 打开期间被删除的文件仍可通过已有OpenFile访问，最后一次
+//	关闭时才释放其扇区。
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef INODE_H
+#define INODE_H
+
+#include "filehdr.h"
+#include "synch.h"
+
+#define InodeHashSize 64 // chains in the inode table; a power of two
+
+// The in-memory header of an open file.
+
+class Inode
+{
+public:
+  int sector;      // where the header lives on disk
+  FileHeader *hdr; // the header itself
+  int refCount;    // how many OpenFiles use it
+  bool dirty;      // changed since it was read or written back?
+  bool removed;    // the file was deleted while open: its sectors
+                   // are freed on the last Put, and the header
+                   // must never be written back
+  Lock *lock;      // held while the header is being changed or
+                   // written back
+  Inode *hashNext; // next inode on the same hash chain
+};
+
+// The following class defines the table: a hash table of the inodes
+// of the files that are open, by header sector.
+
+class InodeTable
+{
+public:
+  InodeTable();  // Initialize an empty table
+  ~InodeTable(); // De-allocate it, and any inode left
+
+  Inode *Get(int sector); // A reference to the inode for the
+                          // header at "sector", read in if need be
+  Inode *Dup(Inode *inode); // Another reference to an inode already
+                            // held (even if removed since)
+  void Put(Inode *inode); // Drop a reference; on the last one,
+                          // write the header back if dirty, or free
+                          // the file's sectors if it was removed
+  void WriteBack(Inode *inode); // Write the header back now, if dirty
+  void Sync();                  // Write back every dirty header
+  void Remove(Inode *inode);    // The file is being deleted: forget
+                                // its header, even if still open (its
+                                // sectors go with the last reference)
+  int NumOpen() { return numInodes; } // inodes in the table
+
+private:
+  Inode *hashTable[InodeHashSize];
+  int numInodes;
+  Lock *lock; // protects the table (not the headers); held
+              // while a header is read in
+};
+
+#endif // INODE_H
@@ -0,0 +1,591 @@
+// journal.cc
+//	Routines to journal file system metadata: transactions, group
+//	commit, checkpointing, and replay after a crash.
+//
+//	A thread brackets each file system operation with Begin and End.
+//	While it is inside, every sector it writes through the buffer
+//	cache is recorded (Log) in the running transaction and pinned in
+//	the cache.  When the last operation in the transaction ends, and
+//	enough sectors have gathered, the transaction is committed: a
+//	descriptor sector and a copy of each sector are appended to the
+//	log, then a commit sector, each with one disk request.  The
+//	copies are kept in memory until a checkpoint writes them home
+//	and frees their log space.  Between commits, the updates live
+//	only in the cache, as they would without a journal; Sync commits
+//	whatever is waiting. 文件系统操作用Begin/End括起，其间写的扇区记入当前事务并钉在缓存中；
+//	最后一个操作结束且积累足够扇区时整批提交：先写描述扇区和扇区副本，再写提交扇区。
+//
+//	There are no revoke records: a sector that is freed, and then
+//	written in place as file data, is forgotten by the checkpoint,
+//	but a replay after a crash would still put its logged copy back.
+//	The window is small, since Sync (on Halt, and when the last
+//	runnable process exits) checkpoints.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "synchdisk.h"
+#include "bitmap.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// CheckpointThread
+// 	Body of the background checkpoint thread; a C routine, for
+//	Thread::Fork.
+//----------------------------------------------------------------------
+
+static void CheckpointThread(_int arg)
+{
+    Journal *log = (Journal *)arg;
+
+    log->CheckpointLoop();
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal of a disk.  Journaling stays off until the
+//	disk is formatted (Format) or mounted (Replay).
+//
+//	"theDisk" -- the disk the journal lives on
+//----------------------------------------------------------------------
+
+Journal::Journal(SynchDisk *theDisk)
+{
+    disk = theDisk;
+    enabled = FALSE;
+    lock = new Lock("journal lock");
+    changed = new Condition("journal");
+    numHolders = 0;
+    numRunning = 0;
+    maxRunning = 0;
+    commitWanted = FALSE;
+    logBusy = FALSE;
+    head = tail = 0;
+    headSeq = tailSeq = 1;
+    numSaved = 0;
+    savedSector = new int[LogSize];
+    savedData = new char[LogSize * SectorSize];
+    checkpointWanted = new Semaphore("checkpoint", 0);
+    checkpointer = NULL;
+    stopping = FALSE;
+    checkpointDone = new Semaphore("checkpoint done", 0);
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.  Anything committed should have been
+//	checkpointed by Sync.  The checkpoint thread, if there is one, is
+//	stopped the way SynchDisk stops its read-ahead thread.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    if ((checkpointer != NULL) && (interrupt->getStatus() != IdleMode))
+    {
+        stopping = TRUE;
+        checkpointWanted->V();
+        checkpointDone->P();
+    }
+    delete[] savedSector;
+    delete[] savedData;
+    delete checkpointWanted;
+    delete checkpointDone;
+    delete changed;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	The disk is being formatted: keep the journal region out of the
+//	free map, clear the log (so that nothing left from an earlier
+//	file system looks like a transaction), and write an empty header.
+//	Journaling is on if the buffer cache is big enough to pin a
+//	transaction in.
+//
+//	"freeMap" -- the new file system's free sector map
+//----------------------------------------------------------------------
+
+void Journal::Format(BitMap *freeMap)
+{
+    char *zero = new char[LogSize * SectorSize];
+
+    for (int i = JournalStart; i < NumSectors; i++)
+        freeMap->Mark(i);
+    bzero(zero, LogSize * SectorSize);
+    disk->WriteRaw(JournalStart + 1, zero, LogSize);
+    delete[] zero;
+
+    head = tail = 0;
+    headSeq = tailSeq = 1;
+    numSaved = 0;
+    WriteHeader();
+    enabled = (disk->CacheSectors() >= MinJournalCache);
+    maxRunning = min(MaxTransaction, disk->CacheSectors() / 4);
+    DEBUG('f', "Journal of %d sectors at %d, %s\n", JournalSectors,
+          JournalStart, enabled ? "on" : "off (cache too small)");
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	The disk is being mounted.  Scan the log from its tail, and write
+//	every transaction whose commit sector made it to disk home; stop
+//	at the first one that didn't (the crash came while it was being
+//	written), or at anything that is not the next transaction.  Then
+//	start an empty log after the last one.
+//
+//	A disk formatted without a journal is left alone, with journaling
+//	off.
+//----------------------------------------------------------------------
+
+void Journal::Replay()
+{
+    char headerData[SectorSize], descData[SectorSize];
+    char commitData[SectorSize], data[SectorSize];
+    JournalHeader *header = (JournalHeader *)headerData;
+    int *desc = (int *)descData;
+    int *commit = (int *)commitData;
+    int pos, seq, n, scanned, replayed = 0;
+
+    disk->ReadRaw(JournalStart, headerData, 1);
+    if ((header->magic != JournalMagic) || (header->tail < 0) ||
+        (header->tail >= LogSize))
+    {
+        printf("The disk has no journal; format it (-f) to journal it.\n");
+        enabled = FALSE;
+        return;
+    }
+
+    pos = header->tail;
+    seq = header->tailSeq;
+    for (scanned = 0;; scanned += n + 2)
+    {
+        disk->ReadRaw(JournalStart + 1 + pos, descData, 1);
+        n = desc[2];
+        if ((desc[0] != DescriptorMagic) || (desc[1] != seq) || (n <= 0) ||
+            (n > MaxTransaction) || (scanned + n + 2 > LogSize - 1))
+            break;
+        disk->ReadRaw(JournalStart + 1 + (pos + n + 1) % LogSize,
+                      commitData, 1);
+        if ((commit[0] != CommitMagic) || (commit[1] != seq))
+            break; // never committed
+        for (int i = 0; i < n; i++)
+        {
+            disk->ReadRaw(JournalStart + 1 + (pos + 1 + i) % LogSize, data, 1);
+            disk->WriteRaw(desc[3 + i], data, 1);
+        }
+        DEBUG('f', "Journal replays transaction %d, %d sectors\n", seq, n);
+        pos = (pos + n + 2) % LogSize;
+        seq++;
+        replayed++;
+    }
+    if (replayed > 0)
+        printf("Journal: replayed %d committed transactions\n", replayed);
+
+    head = tail = pos;
+    headSeq = tailSeq = seq;
+    numSaved = 0;
+    WriteHeader();
+    enabled = (disk->CacheSectors() >= MinJournalCache);
+    maxRunning = min(MaxTransaction, disk->CacheSectors() / 4);
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	The current thread starts a file system operation, which joins
+//	the running transaction.  If it already is in one, this one is
+//	just part of it.
+//
+//	A transaction that has grown big enough takes no new operations:
+//	they wait until it has been committed, so that it cannot outgrow
+//	the cache or the log.  The caller must not hold any file system
+//	lock, since an operation under way may need it to finish.
+//----------------------------------------------------------------------
+
+void Journal::Begin()
+{
+    int h;
+
+    if (!enabled)
+        return;
+    lock->Acquire();
+    if ((h = Holder()) >= 0)
+    { // nested
+        depth[h]++;
+        lock->Release();
+        return;
+    }
+    for (;;)
+    {
+        if ((numHolders == 0) && (numRunning >= GroupCommitSectors))
+            DoCommit(); // a commit was put off
+        else if ((numHolders == MaxJournalThreads) ||
+                 ((numHolders > 0) && (numRunning >= GroupCommitSectors)))
+            changed->Wait(lock);
+        else
+            break;
+    }
+    holders[numHolders] = currentThread;
+    depth[numHolders++] = 1;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	The current thread is done with an operation.  When the last
+//	operation in the transaction ends, commit it if it is big enough,
+//	or if a commit has been asked for; otherwise it waits for more
+//	(group commit).
+//----------------------------------------------------------------------
+
+void Journal::End()
+{
+    int h;
+
+    if (!enabled)
+        return;
+    lock->Acquire();
+    h = Holder();
+    ASSERT(h >= 0);
+    if (--depth[h] == 0)
+    {
+        holders[h] = holders[--numHolders];
+        depth[h] = depth[numHolders];
+        if ((numHolders == 0) &&
+            ((numRunning >= GroupCommitSectors) || commitWanted))
+            DoCommit();
+        changed->Broadcast(lock);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	The current thread is about to write "sector" through the cache.
+//	Return TRUE if the caller must pin it: it is in an operation,
+//	and the sector is new to the running transaction.
+//
+//	A transaction that is full (one operation wrote more than it has
+//	room for) takes no more sectors; the rest of that operation is
+//	written in place, without the journal's protection.
+//
+//	A sector written in place -- like that, or outside any operation,
+//	as file data -- may have an older copy saved from an earlier
+//	transaction (it was metadata, and has been freed, or it is being
+//	rewritten).  The checkpoint must not put that back over it.
+//----------------------------------------------------------------------
+
+bool Journal::Log(int sector)
+{
+    if (!enabled)
+        return FALSE;
+    lock->Acquire();
+    if (Holder() < 0)
+    {
+        Forget(sector);
+        lock->Release();
+        return FALSE;
+    }
+    for (int i = 0; i < numRunning; i++)
+        if (running[i] == sector)
+        { // already pinned
+            lock->Release();
+            return FALSE;
+        }
+    if (numRunning == maxRunning)
+    {
+        DEBUG('f', "Journal full, sector %d written in place\n", sector);
+        Forget(sector);
+        lock->Release();
+        return FALSE;
+    }
+    running[numRunning++] = sector;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit the running transaction, however small, as soon as no
+//	operation is under way.  Called by Sync; the caller must not be
+//	in an operation itself.
+//----------------------------------------------------------------------
+
+void Journal::Commit()
+{
+    if (!enabled)
+        return;
+    lock->Acquire();
+    ASSERT(Holder() < 0);
+    commitWanted = TRUE;
+    for (;;)
+    {
+        while (numHolders > 0) // the last one to end commits it
+            changed->Wait(lock);
+        if (!commitWanted)
+            break;
+        DoCommit(); // leaves it wanted if it had to give way
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write every committed sector home, and empty the log.
+//----------------------------------------------------------------------
+
+void Journal::Checkpoint()
+{
+    if (!enabled)
+        return;
+    lock->Acquire();
+    AcquireLog();
+    DoCheckpoint();
+    ReleaseLog();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::CheckpointLoop
+// 	The checkpoint thread: each time the log gets half full, write it
+//	home, so that committers seldom have to do it themselves.  Quits
+//	when the journal is deleted.
+//----------------------------------------------------------------------
+
+void Journal::CheckpointLoop()
+{
+    for (;;)
+    {
+        checkpointWanted->P();
+        if (stopping)
+            break;
+        Checkpoint();
+    }
+    checkpointDone->V();
+}
+
+//----------------------------------------------------------------------
+// Journal::Holder
+// 	Return the slot of the current thread among the threads in an
+//	operation, or -1 if it isn't in one.
+//----------------------------------------------------------------------
+
+int Journal::Holder()
+{
+    for (int i = 0; i < numHolders; i++)
+        if (holders[i] == currentThread)
+            return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::Forget
+// 	Drop the saved copy of "sector", if there is one: the sector is
+//	being written in place, so that copy is out of date.  Called with
+//	the lock held.
+//----------------------------------------------------------------------
+
+void Journal::Forget(int sector)
+{
+    for (int i = 0; i < numSaved; i++)
+        if (savedSector[i] == sector)
+        {
+            numSaved--;
+            savedSector[i] = savedSector[numSaved];
+            bcopy(&savedData[numSaved * SectorSize],
+                  &savedData[i * SectorSize], SectorSize);
+            return;
+        }
+}
+
+//----------------------------------------------------------------------
+// Journal::AcquireLog, Journal::ReleaseLog
+// 	Only one thread at a time writes to the log (to commit) or moves
+//	its tail (to checkpoint).  Called with the lock held; AcquireLog
+//	gives it up while waiting.
+//----------------------------------------------------------------------
+
+void Journal::AcquireLog()
+{
+    while (logBusy)
+        changed->Wait(lock);
+    logBusy = TRUE;
+}
+
+void Journal::ReleaseLog()
+{
+    logBusy = FALSE;
+    changed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCommit
+// 	Commit the running transaction.  Called with the lock held, and
+//	no operation under way.
+//
+//	The sectors are copied out of the cache while the lock is held,
+//	so that no new operation can change them meanwhile.  Then the
+//	descriptor and the copies are written to the log with one request
+//	(two, if the log wraps around), and only after that the commit
+//	sector: a crash in between leaves a transaction that replay
+//	ignores.  Once committed, the sectors are unpinned, and their
+//	copies kept for the checkpoint.
+//----------------------------------------------------------------------
+
+void Journal::DoCommit()
+{
+    char *data, commitData[SectorSize];
+    int *desc, *commit = (int *)commitData;
+    int n, pos, seq, i, j;
+
+    if (numRunning == 0)
+    {
+        commitWanted = FALSE;
+        return;
+    }
+    AcquireLog();
+    if (numRunning == 0)
+    { // someone else committed it while we waited
+        commitWanted = FALSE;
+        ReleaseLog();
+        return;
+    }
+    if (numHolders > 0)
+    { // an operation began while we waited; it commits when it ends
+        commitWanted = TRUE;
+        ReleaseLog();
+        return;
+    }
+
+    n = numRunning;
+    data = new char[(n + 1) * SectorSize];
+    desc = (int *)data;
+    bzero(data, SectorSize);
+    for (i = 0; i < n; i++)
+    {
+        desc[3 + i] = running[i];
+        disk->ReadSector(running[i], &data[(i + 1) * SectorSize]);
+    }
+    numRunning = 0;
+    commitWanted = FALSE;
+    if (LogFree() < n + 2)
+        DoCheckpoint(); // no room: make some
+    pos = head;
+    seq = headSeq;
+    desc[0] = DescriptorMagic;
+    desc[1] = seq;
+    desc[2] = n;
+    bzero(commitData, SectorSize);
+    commit[0] = CommitMagic;
+    commit[1] = seq;
+    lock->Release(); // the log is ours; let operations go on
+
+    DEBUG('f', "Journal commits transaction %d, %d sectors\n", seq, n);
+    WriteLog(pos, data, n + 1);
+    WriteLog((pos + n + 1) % LogSize, commitData, 1);
+
+    lock->Acquire();
+    head = (pos + n + 2) % LogSize;
+    headSeq = seq + 1;
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; (j < numSaved) && (savedSector[j] != desc[3 + i]); j++)
+            ;
+        if (j == numSaved)
+            savedSector[numSaved++] = desc[3 + i];
+        bcopy(&data[(i + 1) * SectorSize], &savedData[j * SectorSize],
+              SectorSize);
+        disk->Unpin(desc[3 + i]);
+    }
+    stats->numJournalCommits++;
+    stats->numJournalSectors += n;
+    if (LogFree() < LogSize / 2)
+    { // time to checkpoint, in the background
+        if (checkpointer == NULL)
+        {
+            checkpointer = new Thread("checkpoint");
+            checkpointer->Fork(CheckpointThread, (_int)this);
+        }
+        checkpointWanted->V();
+    }
+    ReleaseLog();
+    delete[] data;
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCheckpoint
+// 	Write the saved copies of committed sectors home, in sector order
+//	and a run of consecutive sectors at a time, then move the tail of
+//	the log up to the head.  Called with the lock and the log held.
+//----------------------------------------------------------------------
+
+void Journal::DoCheckpoint()
+{
+    char tmp[SectorSize];
+    int i, j, run, sector;
+
+    if ((head == tail) && (numSaved == 0))
+        return;
+    for (i = 1; i < numSaved; i++)
+    { // insertion sort, by sector
+        sector = savedSector[i];
+        bcopy(&savedData[i * SectorSize], tmp, SectorSize);
+        for (j = i; (j > 0) && (savedSector[j - 1] > sector); j--)
+        {
+            savedSector[j] = savedSector[j - 1];
+            bcopy(&savedData[(j - 1) * SectorSize],
+                  &savedData[j * SectorSize], SectorSize);
+        }
+        savedSector[j] = sector;
+        bcopy(tmp, &savedData[j * SectorSize], SectorSize);
+    }
+    for (i = 0; i < numSaved; i += run)
+    {
+        for (run = 1; (i + run < numSaved) &&
+                      (savedSector[i + run] == savedSector[i] + run);
+             run++)
+            ;
+        disk->WriteRaw(savedSector[i], &savedData[i * SectorSize], run);
+    }
+    DEBUG('f', "Journal checkpoints %d sectors\n", numSaved);
+    numSaved = 0;
+    tail = head;
+    tailSeq = headSeq;
+    WriteHeader();
+    stats->numCheckpoints++;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Record where the log now starts.
+//----------------------------------------------------------------------
+
+void Journal::WriteHeader()
+{
+    char data[SectorSize];
+    JournalHeader *header = (JournalHeader *)data;
+
+    bzero(data, SectorSize);
+    header->magic = JournalMagic;
+    header->tail = tail;
+    header->tailSeq = tailSeq;
+    disk->WriteRaw(JournalStart, data, 1);
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteLog
+// 	Write "numSectors" sectors to the log, starting at position "pos";
+//	two requests if the log wraps around.
+//----------------------------------------------------------------------
+
+void Journal::WriteLog(int pos, char *data, int numSectors)
+{
+    int first = min(numSectors, LogSize - pos);
+
+    disk->WriteRaw(JournalStart + 1 + pos, data, first);
+    if (numSectors > first)
+        disk->WriteRaw(JournalStart + 1, &data[first * SectorSize],
+                       numSectors - first);
+}
@@ -0,0 +1,138 @@
+// journal.h
+//	Data structures for the write-ahead metadata journal.
+//
+//	A file system operation changes several metadata sectors (file
+//	headers, directory buckets, the free map) in different places on
+//	disk.  Written in place, a crash half way through leaves the file
+//	system inconsistent.  Instead, the operation is a transaction:
+//	every sector it writes stays pinned in the buffer cache, and is
+//	then appended to a circular log (the journal), followed by a
+//	commit record.  Only then may the sectors go to their home
+//	locations.  After a crash, committed transactions are replayed
+//	from the log when the disk is mounted. 元数据预写日志：一次操作写的元数据扇区先顺序追加到环形日志并提交，之后才写回原位置；崩溃后挂载时重放已提交的事务。
+//
+//	Operations of any number of threads are gathered into one
+//	transaction, which is committed once none of them is still under
+//	way and it has grown big enough (or on Sync): group commit.  A
+//	kernel thread writes committed sectors home in the background
+//	(checkpointing), so that the log space can be reused.
+//
+//	On-disk layout: the last track of the disk.  The first sector is
+//	the journal header; the rest is the log.  A transaction in the log
+//	is a descriptor sector listing the home sectors it changes, then a
+//	copy of each of them, then a commit sector.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+
+class SynchDisk;
+class BitMap;
+
+#define JournalSectors SectorsPerTrack // size of the journal region
+#define JournalStart (NumSectors - JournalSectors)
+#define LogSize (JournalSectors - 1) // log sectors, after the header
+
+#define JournalMagic 0x4a726e6c    // "Jrnl", marks the journal header
+#define DescriptorMagic 0x44657363 // "Desc"
+#define CommitMagic 0x436d6974     // "Cmit"
+
+#define SectorsPerDescriptor ((SectorSize / (int)sizeof(int)) - 3)
+// A transaction must fit in the log with its descriptor and commit
+// sectors, and leave a slot to spare.
+#define MaxTransaction min(LogSize - 3, SectorsPerDescriptor)
+#define GroupCommitSectors 12 // commit once this many are waiting
+#define MinJournalCache 16    // cache sectors needed to journal: a
+                              // transaction may pin a quarter of them
+#define MaxJournalThreads 16  // threads in a transaction at once
+
+// The first sector of the journal region.
+class JournalHeader
+{
+public:
+  int magic;    // JournalMagic, if the disk has a journal
+  int tail;     // log position of the oldest transaction that
+                // may not be home yet
+  int tailSeq;  // its sequence number
+};
+
+class Journal
+{
+public:
+  Journal(SynchDisk *disk); // Initialize a journal for "disk"; it
+                            // is off until Format or Replay
+  ~Journal();
+
+  void Format(BitMap *freeMap); // Reserve the journal region, and
+                                // start an empty log
+  void Replay();                // On mount: redo committed transactions,
+                                // then start an empty log
+  bool Enabled() { return enabled; }
+
+  void Begin(); // The current thread starts an operation
+                // (operations may nest)
+  void End();   // ...and is done with it
+  bool Log(int sector); // The current thread is writing "sector":
+                        // TRUE if it is in a transaction, and this
+                        // is the first time the transaction writes
+                        // it (the caller pins it)
+  bool Active() { return enabled && (Holder() >= 0); }
+  // Is the current thread in an operation?
+
+  void Commit();     // Commit what has been logged, once no
+                     // operation is under way
+  void Checkpoint(); // Write committed sectors home, and free
+                     // their log space
+
+  void CheckpointLoop(); // The checkpoint thread's body
+
+private:
+  SynchDisk *disk;
+  bool enabled;         // does the disk have a journal?
+  Lock *lock;           // protects everything below
+  Condition *changed;   // signalled when an operation ends, or
+                        // the log stops being busy
+
+  // the running transaction, which operations join
+  Thread *holders[MaxJournalThreads]; // threads in an operation
+  int depth[MaxJournalThreads];       // ...how deeply nested
+  int numHolders;
+  int running[SectorsPerDescriptor];  // sectors written so far
+  int numRunning;
+  int maxRunning;       // how many sectors it may pin
+  bool commitWanted;    // commit as soon as no operation is
+                        // under way, however small
+
+  // the log, used by one committer or checkpointer at a time
+  bool logBusy;
+  int head, tail;       // log positions: next free, oldest in use
+  int headSeq, tailSeq; // sequence numbers there
+  int numSaved;         // committed sectors not yet checkpointed...
+  int *savedSector;     // LogSize of them
+  char *savedData;      // ...and their contents, LogSize sectors
+
+  Semaphore *checkpointWanted; // V()ed when the log is half full
+  Thread *checkpointer;        // NULL until it is first needed
+  bool stopping;               // tells the checkpoint thread to quit
+  Semaphore *checkpointDone;   // V()ed by it as it quits
+
+  int Holder();                // index of currentThread, or -1
+  void Forget(int sector);     // drop its saved copy, if any
+  void AcquireLog();           // wait until we have the log
+  void ReleaseLog();
+  void DoCommit();             // commit the running transaction
+  void DoCheckpoint();         // with the log held
+  void WriteHeader();
+  void WriteLog(int pos, char *data, int numSectors);
+  int LogFree() { return LogSize - 1 - (head - tail + LogSize) % LogSize; }
+};
+
+#endif // JOURNAL_H
@@ -13,33 +13,76 @@
 
 #include "copyright.h"
 #include "filehdr.h"
+#include "inode.h"
+#include "journal.h"
 #include "openfile.h"
 #include "system.h"
 
+#define MinReadAhead 4 // read-ahead window, in sectors, when a file
+                       // starts being read sequentially; it doubles
+#define MaxReadAhead (synchDisk->MaxPrefetch()) // with each further
+                                                // sequential read
+
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open -- or share the copy that is
+//	there already, if the file is open elsewhere (see inode.h).
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 {
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = inodeTable->Get(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
     hdrSector=sector;
+    raNext = raWindow = raLimit = 0;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::OpenFile
+// 	Open a file whose inode ("held") the caller has a reference for,
+//	which this OpenFile now owns.
+//----------------------------------------------------------------------
+
+OpenFile::OpenFile(int sector, Inode *held)
+{
+    inode = held;
+    hdr = inode->hdr;
+    seekPosition = 0;
+    hdrSector = sector;
+    raNext = raWindow = raLimit = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The header is written back if this was the last OpenFile on it,
+//	and it changed.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    inodeTable->Put(inode);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Duplicate
+// 	Return a new OpenFile on the same file, starting at our position.
+//	It shares our inode, so this works even if the file was removed
+//	while open (its sectors are kept until the last OpenFile on it
+//	is closed); the position is copied, and moves on its own after.
+//----------------------------------------------------------------------
+
+OpenFile *
+OpenFile::Duplicate()
+{
+    OpenFile *copy = new OpenFile(hdrSector, inodeTable->Dup(inode));
+
+    copy->seekPosition = seekPosition;
+    return copy;
 }
 
 //----------------------------------------------------------------------
@@ -90,16 +133,20 @@ int OpenFile::Write(char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  Thus the request is split in three:
+//
+//	   the sectors that are wholly part of the request go straight
+//	   between the disk (or the buffer cache) and the caller's buffer,
+//	   with as few disk requests as the file's layout allows (see
+//	   TransferSectors);
+//	   a partial sector at either end goes through "scratch": for
+//	   ReadAt, we read it in and copy out the part we are interested
+//	   in; for WriteAt, we must first read it in, so that we don't
+//	   overwrite the unmodified portion, then copy in the data that
+//	   will be modified, and write it back.
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	So no memory is allocated, and whole sectors are not copied
+//	through a bounce buffer. 对齐的整扇区直接在调用者缓冲区与磁盘间传输，只有首尾不完整的扇区经过暂存区。
 //
 //	"into" -- the buffer to contain the data to be read from disk
 //	"from" -- the buffer containing the data to be written to disk
@@ -111,8 +158,7 @@ int OpenFile::Write(char *into, int numBytes)
 int OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int sector, offset, done, whole;
 
     if ((numBytes <= 0) || (position >= fileLength))
         return 0; // check request
@@ -121,75 +167,173 @@ int OpenFile::ReadAt(char *into, int numBytes, int position)
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize),
-                              &buf[(i - firstSector) * SectorSize]);
+    ReadAhead(divRoundDown(position, SectorSize),
+              divRoundDown(position + numBytes - 1, SectorSize));
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete[] buf;
+    sector = divRoundDown(position, SectorSize);
+    offset = position - sector * SectorSize;
+    done = 0;
+    if ((offset != 0) || (numBytes < SectorSize))
+    { // partial first sector
+        done = min(numBytes, SectorSize - offset);
+        TransferSectors(sector, 1, scratch, FALSE);
+        bcopy(&scratch[offset], into, done);
+        sector++;
+    }
+    whole = (numBytes - done) / SectorSize;
+    if (whole > 0)
+    { // whole sectors, straight into the caller's buffer
+        TransferSectors(sector, whole, &into[done], FALSE);
+        done += whole * SectorSize;
+        sector += whole;
+    }
+    if (done < numBytes)
+    { // partial last sector
+        TransferSectors(sector, 1, scratch, FALSE);
+        bcopy(scratch, &into[done], numBytes - done);
+    }
     return numBytes;
 }
 
 int OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int sector, offset, done, whole;
 
     if ((numBytes <= 0) || (position > fileLength)) //约束 1
         return -1;
     if ((position + numBytes) > fileLength)
     { //约束 2
-        int incrementBytes = (position + numBytes) - fileLength;
-        BitMap *freeBitMap = fileSystem->getBitMap(); 
-        bool hdrRet;
-        hdrRet = hdr->Allocate(freeBitMap, fileLength, incrementBytes); 
-        if (!hdrRet)                                                    // Insuficient Disk Space, or File is Too Big
-            return -1;
-        fileSystem->setBitMap(freeBitMap); 
-        delete freeBitMap;
+        journal->Begin(); // the header and the free map change together
+        inode->lock->Acquire();
+        fileLength = hdr->FileLength(); // someone else may have grown it
+        if ((position + numBytes) > fileLength)
+        {
+            int incrementBytes = (position + numBytes) - fileLength;
+            BitMap *freeBitMap = fileSystem->getBitMap(); // resident, don't delete
+            bool hdrRet;
+            hdrRet = hdr->Allocate(freeBitMap, fileLength, incrementBytes); 
+            if (!hdrRet)                                                    // Insuficient Disk Space, or File is Too Big
+            {
+                inode->lock->Release();
+                journal->End();
+                return -1;
+            }
+            fileSystem->setBitMap(freeBitMap); 
+            if (journal->Enabled())
+                hdr->WriteBack(inode->sector); // in the same transaction
+            else
+                inode->dirty = TRUE; // written back on the last close, or Sync
+        }
+        inode->lock->Release();
+        journal->End();
     }
 
-    // if ((numBytes <= 0) || (position >= fileLength))
-    //     return 0; // check request
-    // if ((position + numBytes) > fileLength)
-    //     numBytes = fileLength - position;
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n",
           numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    sector = divRoundDown(position, SectorSize);
+    offset = position - sector * SectorSize;
+    done = 0;
+    if ((offset != 0) || (numBytes < SectorSize))
+    { // partial first sector: read, modify, write
+        done = min(numBytes, SectorSize - offset);
+        TransferSectors(sector, 1, scratch, FALSE);
+        bcopy(from, &scratch[offset], done);
+        TransferSectors(sector, 1, scratch, TRUE);
+        sector++;
+    }
+    whole = (numBytes - done) / SectorSize;
+    if (whole > 0)
+    { // whole sectors, straight from the caller's buffer
+        TransferSectors(sector, whole, &from[done], TRUE);
+        done += whole * SectorSize;
+        sector += whole;
+    }
+    if (done < numBytes)
+    { // partial last sector: read, modify, write
+        TransferSectors(sector, 1, scratch, FALSE);
+        bcopy(&from[done], scratch, numBytes - done);
+        TransferSectors(sector, 1, scratch, TRUE);
+    }
+    return numBytes;
+}
 
-    buf = new char[numSectors * SectorSize];
+//----------------------------------------------------------------------
+// OpenFile::TransferSectors
+// 	Read or write whole sectors "firstSector" .. "firstSector" +
+//	"numSectors" - 1 of the file.  Each run of them that is also
+//	consecutive on disk (usually all of them, in one extent) is one
+//	ReadSectors/WriteSectors call. 按磁盘上连续的段合并读写文件的整扇区。
+//
+//	"buf" -- holds the sectors, numSectors * SectorSize bytes
+//----------------------------------------------------------------------
 
-    firstAligned = (bool)(position == (firstSector * SectorSize));
-    lastAligned = (bool)((position + numBytes) == ((lastSector + 1) * SectorSize));
+void OpenFile::TransferSectors(int firstSector, int numSectors, char *buf,
+                               bool writing)
+{
+    int i, run, start;
 
-    // read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize],
-               SectorSize, lastSector * SectorSize);
+    for (i = 0; i < numSectors; i += run)
+    {
+        start = hdr->ByteToSector((firstSector + i) * SectorSize);
+        for (run = 1; (i + run < numSectors) &&
+                      (hdr->ByteToSector((firstSector + i + run) * SectorSize) ==
+                       start + run);
+             run++)
+            ;
+        if (writing)
+            synchDisk->WriteSectors(start, &buf[i * SectorSize], run);
+        else
+            synchDisk->ReadSectors(start, &buf[i * SectorSize], run);
+    }
+}
 
-    // copy in the bytes we want to change
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called by ReadAt before it reads file sectors "firstSector" ..
+//	"lastSector".  A read that starts where the last one stopped (or
+//	in the sector the last one ended in, for reads smaller than a
+//	sector) is sequential: the window grows, from MinReadAhead up to
+//	MaxReadAhead sectors, and the sectors after this read are handed
+//	to SynchDisk::Prefetch, so that the disk reads them while the
+//	caller is busy with this data.  Any other read closes the window.
+//
+//	New sectors are only asked for once the reader is within half a
+//	window of the end of what was read ahead, so that each prefetch
+//	is a good sized run rather than a sector at a time.
+//	顺序读时窗口从MinReadAhead倍增到MaxReadAhead，并预读其后的扇区；随机读则关闭窗口。
+//----------------------------------------------------------------------
 
-    // write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize),
-                               &buf[(i - firstSector) * SectorSize]);
-    delete[] buf;
-    return numBytes;
+void OpenFile::ReadAhead(int firstSector, int lastSector)
+{
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int start, end, i, run, sector;
+
+    if ((firstSector == raNext) || (firstSector == raNext - 1))
+        raWindow = (raWindow == 0) ? MinReadAhead
+                                   : min(2 * raWindow, MaxReadAhead);
+    else
+    { // random access: stop reading ahead
+        raWindow = 0;
+        raLimit = 0;
+    }
+    raNext = lastSector + 1;
+    if ((raWindow == 0) || (raLimit - raNext > raWindow / 2))
+        return;
+
+    start = max(raNext, raLimit);
+    end = min(raNext + raWindow, fileSectors);
+    for (i = start; i < end; i += run)
+    { // a Prefetch per run of sectors that are consecutive on disk
+        sector = hdr->ByteToSector(i * SectorSize);
+        for (run = 1; (i + run < end) &&
+                      (hdr->ByteToSector((i + run) * SectorSize) == sector + run);
+             run++)
+            ;
+        synchDisk->Prefetch(sector, run);
+    }
+    raLimit = max(raLimit, end);
 }
 
 //----------------------------------------------------------------------
@@ -202,12 +346,22 @@ int OpenFile::Length()
     return hdr->FileLength();
 }
 
+//----------------------------------------------------------------------
+// OpenFile::WriteBack
+// 	Write the file header back to disk now, if it has changed.
+//----------------------------------------------------------------------
+
 void OpenFile::WriteBack()
 {
-    hdr-> WriteBack(hdrSector);
+    inodeTable->WriteBack(inode);
 }
 
 int OpenFile::getHdrSector()
 {
     return hdrSector;
+}
+
+Inode *OpenFile::getInode()
+{
+    return inode;
 }
\ No newline at end of file
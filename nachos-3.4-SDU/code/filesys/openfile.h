@@ -72,7 +72,10 @@ private:
 };
 
 #else // FILESYS
+#include "disk.h"
+
 class FileHeader;
+class Inode;
 
 class OpenFile
 {
@@ -81,6 +84,9 @@ public:
 						  // at "sector" on the disk
 	~OpenFile();		  // Close the file
 
+	OpenFile *Duplicate(); // Open the same file again, at the same
+						   // position (for Fork)
+
 	void Seek(int position); // Set the position from which to
 							 // start reading/writing -- UNIX lseek
 
@@ -103,11 +109,28 @@ public:
 	void WriteBack();
 
 	int getHdrSector();
+	Inode *getInode(); // the in-memory header this file shares
 
 private:
-	FileHeader *hdr;  // Header for this file
+	Inode *inode;	  // Shared in-memory header for this file
+	FileHeader *hdr;  // ...the header itself
 	int seekPosition; // Current position within the file
 	int hdrSector;
+
+	OpenFile(int sector, Inode *held); // on an inode already held
+
+	void TransferSectors(int firstSector, int numSectors, char *buf,
+						 bool writing); // whole sectors of the file,
+										// a disk request per run
+	char scratch[SectorSize]; // the partly read or written sector at
+							  // either end of a request 请求首尾不完整扇区的暂存区
+
+	// sequential read-ahead 顺序预读
+	int raNext;	  // file sector a sequential read would start at
+	int raWindow; // how far ahead to read, in sectors; 0 until
+				  // the reads look sequential
+	int raLimit;  // file sectors before this have been read ahead
+	void ReadAhead(int firstSector, int lastSector);
 };
 
 #endif // FILESYS
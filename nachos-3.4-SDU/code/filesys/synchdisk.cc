@@ -6,9 +6,39 @@
 //	the request completes). 同步访问磁盘的例程。物理磁盘是一个异步设备（磁盘请求立即返回，稍后会发生中断）。这是磁盘顶部的一层，提供同步接口（请求等待请求完成）。
 //
 //	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion. 使用信号量将中断处理程序与挂起的请求同步。而且，因为物理磁盘一次只能处理一个操作，所以使用锁来强制互斥。
+//	pending requests.  The physical disk can only handle one
+//	operation at a time, so requests made while it is busy wait in
+//	a queue; each time one finishes, the interrupt handler picks the
+//	next one by the scheduling policy (FIFO, SSTF, SCAN or C-LOOK)
+//	and starts it. 物理磁盘一次只能处理一个操作，其余请求在队列中等待；
+//	每个请求完成时，中断处理程序按调度策略选出下一个请求。
+//
+//	Above the disk sits a buffer cache of recently used sectors:
+//	a hash table finds a cached sector, and a doubly linked LRU
+//	list picks the buffer to recycle on a miss.  Writes only go
+//	into the cache; a dirty sector is written back when its buffer
+//	is recycled, or when Sync() is called (on Halt, and when the last
+//	runnable user program exits). 磁盘之上是扇区缓冲区缓存：散列表查找，LRU链表选择淘汰对象，写操作只写入缓存。
+//
+//	Requests for several consecutive sectors are passed on to the
+//	disk as one request, as far as the cache allows: sectors already
+//	cached are copied, and each run of the others is one request.
+//
+//	Sectors a file is about to read can be asked for in advance with
+//	Prefetch: a kernel thread reads them into the cache while the
+//	caller goes on.  A prefetched sector counts as a read-ahead hit
+//	when it is first read, and as wasted if it is evicted before
+//	that. 预读：内核线程在后台把扇区读入缓存，统计命中与浪费的预读扇区。
+//
+//	With a journal, a sector written by a file system operation is
+//	pinned in the cache until the operation's transaction has been
+//	committed to the log; only then may it be written back.
+//	有日志时，事务写的扇区在提交前一直钉在缓存中，不会写回磁盘。
+//
+//	The cache lock is not held while waiting for the disk, so that
+//	other threads can use the cache, and queue requests of their own,
+//	meanwhile.  Instead, the buffer being read or written is marked
+//	busy, and anyone else who wants it waits until it isn't.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -16,6 +46,8 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -30,6 +62,18 @@ static void DiskRequestDone(_int arg)
     dsk->RequestDone(); // disk -> dsk
 }
 
+//----------------------------------------------------------------------
+// PrefetchThread
+// 	Body of the read-ahead thread; a C routine, for Thread::Fork.
+//----------------------------------------------------------------------
+
+static void PrefetchThread(_int arg)
+{
+    SynchDisk *dsk = (SynchDisk *)arg;
+
+    dsk->PrefetchLoop();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
@@ -37,26 +81,84 @@ static void DiskRequestDone(_int arg)
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"cacheSectors" -- how many sectors the buffer cache holds
+//	"thePolicy" -- the order to serve queued requests in
+//	"backend" -- how the disk gets at the UNIX file
+//	"tracks", "trackSize" -- the geometry, if the file is new
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char *name)
+SynchDisk::SynchDisk(char *name, int cacheSectors, DiskPolicy thePolicy,
+                     DiskBackend backend, int tracks, int trackSize)
 {
-    semaphore = new Semaphore("synch disk", 0);
+    int hashSize;
+
     lock = new Lock("synch disk lock");
-    disk = new Disk(name, DiskRequestDone, (_int)this);
+    bufferFree = new Condition("synch disk buffer");
+    disk = new Disk(name, DiskRequestDone, (_int)this, backend, tracks,
+                    trackSize);
+    policy = thePolicy;
+    queue = NULL;
+    active = NULL;
+    sweepUp = TRUE;
+    prefetchHead = prefetchWaiting = 0;
+    prefetchReady = new Semaphore("read-ahead", 0);
+    prefetcher = NULL;
+    stopping = FALSE;
+    prefetchDone = new Semaphore("read-ahead done", 0);
+    journal = NULL;
+
+    numBuffers = max(cacheSectors, 0);
+    for (hashSize = 1; hashSize < numBuffers; hashSize *= 2)
+        ;
+    hashMask = hashSize - 1;
+    hashTable = new CacheBuffer *[hashSize];
+    for (int i = 0; i < hashSize; i++)
+        hashTable[i] = NULL;
+
+    buffers = new CacheBuffer[max(numBuffers, 1)];
+    lruList.lruNext = lruList.lruPrev = &lruList;
+    for (int i = 0; i < numBuffers; i++)
+    {
+        buffers[i].valid = FALSE;
+        buffers[i].dirty = FALSE;
+        buffers[i].busy = FALSE;
+        buffers[i].prefetched = FALSE;
+        buffers[i].pins = 0;
+        buffers[i].hashNext = NULL;
+        buffers[i].lruPrev = &lruList; // put it at the front
+        buffers[i].lruNext = lruList.lruNext;
+        lruList.lruNext->lruPrev = &buffers[i];
+        lruList.lruNext = &buffers[i];
+    }
+    DEBUG('f', "Buffer cache of %d sectors, %s disk scheduling\n",
+          numBuffers, PolicyName(policy));
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  The read-ahead thread, if there is one, is told to
+//	quit, and waited for, so that it is not left asleep on a semaphore
+//	that is gone -- unless Nachos is halting because no thread can
+//	run, when it will never wake up anyway.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    if ((prefetcher != NULL) && (interrupt->getStatus() != IdleMode))
+    {
+        stopping = TRUE;
+        prefetchReady->V();
+        prefetchDone->P();
+    }
+    ASSERT((queue == NULL) && (active == NULL));
+    delete[] buffers; // dirty sectors should have been Sync()ed
+    delete[] hashTable;
     delete disk;
+    delete prefetchReady;
+    delete prefetchDone;
+    delete bufferFree;
     delete lock;
-    delete semaphore;
 }
 
 //----------------------------------------------------------------------
@@ -64,15 +166,42 @@ SynchDisk::~SynchDisk()
 // 	Read the contents of a disk sector into a buffer.  Return only
 //	after the data has been read. 将磁盘扇区的内容读入缓冲区。仅在读取数据后返回。
 //
+//	If the sector is in the buffer cache, no disk I/O is needed.
+//
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
 //----------------------------------------------------------------------
 
 void SynchDisk::ReadSector(int sectorNumber, char *data)
 {
-    lock->Acquire(); // only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P(); // wait for interrupt
+    CacheBuffer *buf;
+    bool cached;
+
+    if (numBuffers == 0)
+    {
+        Transfer(sectorNumber, data, FALSE);
+        return;
+    }
+    lock->Acquire();
+    buf = GetBuffer(sectorNumber, &cached);
+    if (cached)
+    {
+        stats->numCacheHits++;
+        if (buf->prefetched)
+        {
+            stats->numReadAheadHits++;
+            buf->prefetched = FALSE;
+        }
+    }
+    else
+    {
+        stats->numCacheMisses++;
+        lock->Release(); // the buffer is busy, no one will touch it
+        Transfer(sectorNumber, buf->data, FALSE);
+        lock->Acquire();
+    }
+    bcopy(buf->data, data, SectorSize);
+    PutBuffer(buf);
     lock->Release();
 }
 
@@ -81,25 +210,667 @@ void SynchDisk::ReadSector(int sectorNumber, char *data)
 // 	Write the contents of a buffer into a disk sector.  Return only
 //	after the data has been written.
 //
+//	With the buffer cache on, the data only goes into the cache, and
+//	reaches the disk later (see Sync).  The whole sector is replaced,
+//	so a sector that is not cached need not be read first.  If this
+//	is the first write of the sector in the running transaction, it
+//	is pinned until that is committed.
+//
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
 //----------------------------------------------------------------------
 
 void SynchDisk::WriteSector(int sectorNumber, char *data)
 {
-    lock->Acquire(); // only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P(); // wait for interrupt
+    CacheBuffer *buf;
+    bool cached, logged;
+
+    if (numBuffers == 0)
+    {
+        Transfer(sectorNumber, data, TRUE);
+        return;
+    }
+    logged = (journal != NULL) && journal->Log(sectorNumber);
+    lock->Acquire();
+    buf = GetBuffer(sectorNumber, &cached);
+    bcopy(data, buf->data, SectorSize);
+    buf->dirty = TRUE;
+    buf->prefetched = FALSE; // no longer what was read ahead
+    if (logged)
+        buf->pins++;
+    PutBuffer(buf);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read "numSectors" consecutive sectors.  Cached sectors are copied
+//	from the cache; each run of the rest is read with one disk request,
+//	straight into "data", and then cached. 连续读多个扇区：已缓存的直接复制，
+//	其余每一段连续扇区用一个磁盘请求读入。
+//
+//	"sectorNumber" -- the first disk sector to read
+//	"data" -- the buffer to hold their contents
+//	"numSectors" -- how many sectors
+//----------------------------------------------------------------------
+
+void SynchDisk::ReadSectors(int sectorNumber, char *data, int numSectors)
+{
+    CacheBuffer *buf;
+    bool cached;
+    int i, run;
+
+    if (numBuffers == 0)
+    {
+        Transfer(sectorNumber, data, FALSE, numSectors);
+        return;
+    }
+    lock->Acquire();
+    for (i = 0; i < numSectors; i += run)
+    {
+        if (Lookup(sectorNumber + i) != NULL)
+        { // cached: same as ReadSector
+            buf = GetBuffer(sectorNumber + i, &cached);
+            if (cached)
+            {
+                stats->numCacheHits++;
+                if (buf->prefetched)
+                {
+                    stats->numReadAheadHits++;
+                    buf->prefetched = FALSE;
+                }
+            }
+            else
+            { // evicted while we waited for it
+                stats->numCacheMisses++;
+                lock->Release();
+                Transfer(sectorNumber + i, buf->data, FALSE);
+                lock->Acquire();
+            }
+            bcopy(buf->data, &data[i * SectorSize], SectorSize);
+            PutBuffer(buf);
+            run = 1;
+            continue;
+        }
+        for (run = 1; (i + run < numSectors) &&
+                      (Lookup(sectorNumber + i + run) == NULL);
+             run++)
+            ;
+        stats->numCacheMisses += run;
+        lock->Release();
+        Transfer(sectorNumber + i, &data[i * SectorSize], FALSE, run);
+        lock->Acquire();
+        for (int j = i; j < i + run; j++)
+            if (Lookup(sectorNumber + j) == NULL)
+            { // keep a copy, unless someone cached it meanwhile
+                buf = GetBuffer(sectorNumber + j, &cached);
+                if (!cached)
+                    bcopy(&data[j * SectorSize], buf->data, SectorSize);
+                PutBuffer(buf);
+            }
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write "numSectors" consecutive sectors.  They go straight to the
+//	disk, in one request, rather than into the cache one by one; any
+//	of them that are cached get the new contents too, and are then
+//	clean. 连续写多个扇区：用一个请求直接写盘，已缓存的扇区同时更新（变为干净）。
+//
+//	Inside a journaled operation, though, they are metadata (say, a
+//	directory), and must not reach the disk before they are logged:
+//	they are written into the cache one at a time.
+//
+//	"sectorNumber" -- the first disk sector to write
+//	"data" -- their new contents
+//	"numSectors" -- how many sectors
+//----------------------------------------------------------------------
+
+void SynchDisk::WriteSectors(int sectorNumber, char *data, int numSectors)
+{
+    CacheBuffer *buf;
+    bool cached;
+
+    if ((numBuffers > 0) &&
+        ((numSectors == 1) || ((journal != NULL) && journal->Active())))
+    {
+        for (int i = 0; i < numSectors; i++)
+            WriteSector(sectorNumber + i, &data[i * SectorSize]);
+        return;
+    }
+    if (journal != NULL) // file data, in place: not the journal's any more
+        for (int i = 0; i < numSectors; i++)
+            journal->Log(sectorNumber + i);
+    if (numBuffers > 0)
+    {
+        lock->Acquire();
+        for (int i = 0; i < numSectors; i++)
+            if (Lookup(sectorNumber + i) != NULL)
+            {
+                buf = GetBuffer(sectorNumber + i, &cached);
+                bcopy(&data[i * SectorSize], buf->data, SectorSize);
+                buf->dirty = FALSE; // the disk is about to get it
+                buf->prefetched = FALSE;
+                PutBuffer(buf);
+            }
+        lock->Release();
+    }
+    Transfer(sectorNumber, data, TRUE, numSectors);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Sync
+// 	Write every dirty sector in the buffer cache back to disk, in
+//	sector order (to keep the seeks short).  The sectors stay cached.
+//	Each run of consecutive dirty sectors, up to a track's worth, is
+//	written with one request.  The dirty sectors are found by going
+//	through the buffers, not the disk, however big that is.  Then the
+//	disk is flushed, so that it all reaches the UNIX file even with
+//	the mapped backend.  Pinned
+//	sectors are left alone: they are written once committed.
+//----------------------------------------------------------------------
+
+void SynchDisk::Sync()
+{
+    int maxRun = disk->TrackSize();
+    CacheBuffer **run = new CacheBuffer *[maxRun];
+    char *data = new char[maxRun * SectorSize];
+    int *dirty = new int[max(numBuffers, 1)];
+    CacheBuffer *buf;
+    int numDirty, i, j, key, first, n;
+
+    lock->Acquire();
+    for (numDirty = 0, i = 0; i < numBuffers; i++)
+        if (buffers[i].valid && buffers[i].dirty)
+            dirty[numDirty++] = buffers[i].sector;
+    for (i = 1; i < numDirty; i++)
+    { // insertion sort, by sector
+        key = dirty[i];
+        for (j = i - 1; (j >= 0) && (dirty[j] > key); j--)
+            dirty[j + 1] = dirty[j];
+        dirty[j + 1] = key;
+    }
+    for (i = 0; i < numDirty; i += max(n, 1))
+    {
+        // gather the run of dirty sectors starting at "first"
+        first = dirty[i];
+        for (n = 0; (n < maxRun) && (i + n < numDirty) &&
+                    (dirty[i + n] == first + n);
+             n++)
+        {
+            while (((buf = Lookup(first + n)) != NULL) && buf->busy)
+                bufferFree->Wait(lock);
+            if ((buf == NULL) || !buf->dirty || (buf->pins > 0))
+                break;
+            buf->busy = TRUE;
+            bcopy(buf->data, &data[n * SectorSize], SectorSize);
+            run[n] = buf;
+        }
+        if (n == 0)
+            continue;
+        lock->Release();
+        Transfer(first, data, TRUE, n);
+        lock->Acquire();
+        for (j = 0; j < n; j++)
+        {
+            run[j]->dirty = FALSE;
+            run[j]->busy = FALSE;
+        }
+        bufferFree->Broadcast(lock);
+    }
+    disk->Flush();
+    lock->Release();
+    delete[] dirty;
+    delete[] data;
+    delete[] run;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Unpin
+// 	The transaction that wrote "sectorNumber" has been committed: the
+//	sector may now be written back (once no later transaction that
+//	wrote it too is still running).
+//----------------------------------------------------------------------
+
+void SynchDisk::Unpin(int sectorNumber)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    buf = Lookup(sectorNumber);
+    ASSERT((buf != NULL) && (buf->pins > 0)); // pinned ones stay cached
+    buf->pins--;
+    if (buf->pins == 0)
+        bufferFree->Broadcast(lock); // someone may want to recycle it
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadRaw, SynchDisk::WriteRaw
+// 	Read or write "numSectors" consecutive sectors with one request,
+//	bypassing the buffer cache altogether.  Used for the journal, whose
+//	sectors are never cached, and for putting logged sectors home.
+//	A cached copy of one of those may be newer: it is then dirty, and
+//	reaches the disk later.  (The journal forgets its copy of any
+//	sector that is written in place, so that it cannot be older than
+//	what the disk has.)
+//----------------------------------------------------------------------
+
+void SynchDisk::ReadRaw(int sectorNumber, char *data, int numSectors)
+{
+    Transfer(sectorNumber, data, FALSE, numSectors);
+}
+
+void SynchDisk::WriteRaw(int sectorNumber, char *data, int numSectors)
+{
+    Transfer(sectorNumber, data, TRUE, numSectors);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Prefetch
+// 	Ask for "numSectors" consecutive sectors, starting at
+//	"sectorNumber", to be read into the buffer cache in the background.
+//	Returns at once.  This is only a hint: it is dropped if the cache
+//	is off, or too many requests are already waiting.  At most a
+//	quarter of the cache is used for one request, so that read-ahead
+//	does not push out everything else. 后台预读，仅为提示：缓存关闭或队列满时丢弃。
+//
+//	The read-ahead thread is started the first time this is called.
+//----------------------------------------------------------------------
+
+void SynchDisk::Prefetch(int sectorNumber, int numSectors)
+{
+    int slot;
+
+    numSectors = min(numSectors, MaxPrefetch());
+    if ((numSectors <= 0) || (sectorNumber < 0) ||
+        (sectorNumber + numSectors > disk->Sectors()))
+        return;
+    lock->Acquire();
+    if (prefetchWaiting == PrefetchQueueSize)
+    { // the thread is falling behind
+        lock->Release();
+        return;
+    }
+    slot = (prefetchHead + prefetchWaiting++) % PrefetchQueueSize;
+    prefetchSector[slot] = sectorNumber;
+    prefetchCount[slot] = numSectors;
+    if (prefetcher == NULL)
+    {
+        prefetcher = new Thread("read-ahead");
+        prefetcher->Fork(PrefetchThread, (_int)this);
+    }
     lock->Release();
+    prefetchReady->V();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PrefetchLoop
+// 	The read-ahead thread: take each request off the ring, and read
+//	the sectors that aren't cached yet into the cache, with one disk
+//	request.  Quits when the disk is deleted.
+//
+//	It never waits for a buffer: it only takes buffers that are idle
+//	and clean, and stops at the first sector that is already cached
+//	or that it has no buffer for.  The buffers stay busy while the
+//	disk reads them, so a thread that wants one of those sectors
+//	meanwhile waits for it, rather than reading it again.
+//	预读线程只使用空闲且干净的缓冲区，从不等待；读盘期间缓冲区保持忙状态。
+//----------------------------------------------------------------------
+
+void SynchDisk::PrefetchLoop()
+{
+    CacheBuffer **run = new CacheBuffer *[disk->TrackSize()];
+    char *data = new char[disk->TrackSize() * SectorSize];
+    CacheBuffer *buf;
+    int sectorNumber, numSectors, n;
+
+    for (;;)
+    {
+        prefetchReady->P();
+        if (stopping)
+            break;
+        lock->Acquire();
+        sectorNumber = prefetchSector[prefetchHead];
+        numSectors = prefetchCount[prefetchHead];
+        prefetchHead = (prefetchHead + 1) % PrefetchQueueSize;
+        prefetchWaiting--;
+
+        while ((numSectors > 0) && (Lookup(sectorNumber) != NULL))
+        { // skip what is already cached
+            sectorNumber++;
+            numSectors--;
+        }
+        for (n = 0; (n < numSectors) && (Lookup(sectorNumber + n) == NULL); n++)
+        {
+            for (buf = lruList.lruPrev;
+                 (buf != &lruList) && (buf->busy || buf->dirty);
+                 buf = buf->lruPrev)
+                ;
+            if (buf == &lruList)
+                break; // nothing we can take without waiting
+            Reuse(buf, sectorNumber + n);
+            run[n] = buf;
+        }
+        if (n == 0)
+        {
+            lock->Release();
+            continue;
+        }
+        DEBUG('f', "Reading ahead %d sectors at %d\n", n, sectorNumber);
+        lock->Release();
+        Transfer(sectorNumber, data, FALSE, n);
+        lock->Acquire();
+        for (int i = 0; i < n; i++)
+        {
+            bcopy(&data[i * SectorSize], run[i]->data, SectorSize);
+            run[i]->prefetched = TRUE;
+            PutBuffer(run[i]);
+        }
+        stats->numReadAhead += n;
+        lock->Release();
+    }
+    delete[] data;
+    delete[] run;
+    prefetchDone->V();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Start the next queued request, if there
+//	is one, and wake up the thread waiting for the one that finished.
 //----------------------------------------------------------------------
 
 void SynchDisk::RequestDone()
 {
-    semaphore->V();
+    DiskRequest *finished = active;
+
+    ASSERT(finished != NULL);
+    active = NULL;
+    StartNext();
+    finished->done->V(); // "finished" may be gone after this
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PolicyByName, SynchDisk::PolicyName
+// 	Convert between scheduling policies and their names.
+//----------------------------------------------------------------------
+
+static const char *policyNames[NumDiskPolicies] = {"fifo", "sstf", "scan",
+                                                   "clook"};
+
+int SynchDisk::PolicyByName(char *name)
+{
+    for (int p = 0; p < NumDiskPolicies; p++)
+        if (!strcmp(name, policyNames[p]))
+            return p;
+    return -1;
+}
+
+const char *
+SynchDisk::PolicyName(int p)
+{
+    ASSERT((p >= 0) && (p < NumDiskPolicies));
+    return policyNames[p];
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Transfer
+// 	Do one disk request, and wait for it to finish.  If the disk is
+//	busy, the request waits in the queue.  The caller must not hold
+//	the cache lock (other threads may need it meanwhile).
+//
+//	"sectorNumber" -- the (first) disk sector to read or write
+//	"data" -- the sectors' new contents, or where to put them
+//	"writing" -- write, rather than read?
+//	"numSectors" -- how many consecutive sectors
+//----------------------------------------------------------------------
+
+void SynchDisk::Transfer(int sectorNumber, char *data, bool writing,
+                         int numSectors)
+{
+    Semaphore done("disk request", 0);
+    DiskRequest request, **tail;
+    IntStatus oldLevel;
+
+    request.sector = sectorNumber;
+    request.numSectors = numSectors;
+    request.data = data;
+    request.writing = writing;
+    request.done = &done;
+    request.next = NULL;
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    for (tail = &queue; *tail != NULL; tail = &(*tail)->next)
+        ;
+    *tail = &request; // in order of arrival
+    if (active == NULL)
+        StartNext();
+    (void)interrupt->SetLevel(oldLevel);
+
+    done.P(); // wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	If there are queued requests, send the one the policy picks to
+//	the disk.  Called with interrupts off, while the disk is idle.
+//----------------------------------------------------------------------
+
+void SynchDisk::StartNext()
+{
+    ASSERT(active == NULL);
+    if (queue == NULL)
+        return;
+    active = Choose();
+    DEBUG('d', "Scheduling %d sectors at %d (head at %d)\n",
+          active->numSectors, active->sector, disk->HeadSector());
+    if (active->writing)
+        disk->WriteRequest(active->sector, active->data, active->numSectors);
+    else
+        disk->ReadRequest(active->sector, active->data, active->numSectors);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Choose
+// 	Take the request to serve next off the queue.
+//
+//	FIFO takes the oldest.  SSTF takes the one the disk can get to
+//	soonest, counting rotation as well as seeking (ComputeLatency).
+//	SCAN takes the nearest one in the direction the head is moving,
+//	and turns around when there are none left that way.  C-LOOK
+//	takes the nearest one at or past the head, and when there are
+//	none, goes back to the lowest numbered one.  Ties go to the
+//	older request. FIFO取最早的；SSTF取定位时间最短的；SCAN沿当前方向取最近的，
+//	到头后反向；C-LOOK只向上扫描，到头后跳回最小扇区号。
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::Choose()
+{
+    int head = disk->HeadSector();
+    DiskRequest **link, **best = &queue;
+    DiskRequest *chosen;
+    int cost, bestCost = 0;
+    bool found = FALSE;
+
+    if (policy == DiskSSTF)
+    {
+        for (link = &queue; *link != NULL; link = &(*link)->next)
+        {
+            cost = disk->ComputeLatency((*link)->sector, (*link)->writing);
+            if (!found || (cost < bestCost))
+            {
+                best = link;
+                bestCost = cost;
+                found = TRUE;
+            }
+        }
+    }
+    else if ((policy == DiskSCAN) || (policy == DiskCLOOK))
+    {
+        for (int pass = 0; !found && (pass < 2); pass++)
+        {
+            for (link = &queue; *link != NULL; link = &(*link)->next)
+            {
+                int sector = (*link)->sector;
+
+                if (sweepUp ? (sector < head) : (sector > head))
+                    continue; // behind the head
+                cost = sweepUp ? (sector - head) : (head - sector);
+                if (!found || (cost < bestCost))
+                {
+                    best = link;
+                    bestCost = cost;
+                    found = TRUE;
+                }
+            }
+            if (!found)
+            { // nothing ahead: turn around, or start over from the bottom
+                if (policy == DiskSCAN)
+                    sweepUp = !sweepUp;
+                else
+                    head = 0;
+            }
+        }
+    }
+    chosen = *best;
+    *best = chosen->next;
+    return chosen;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Lookup
+// 	Return the buffer holding "sectorNumber", or NULL if it is not
+//	in the cache.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+SynchDisk::Lookup(int sectorNumber)
+{
+    CacheBuffer *buf;
+
+    for (buf = hashTable[sectorNumber & hashMask]; buf != NULL; buf = buf->hashNext)
+        if (buf->sector == sectorNumber)
+            return buf;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GetBuffer
+// 	Return the buffer for "sectorNumber", marked busy, waiting first if
+//	another thread has it busy.  If the sector isn't cached, recycle
+//	the least recently used buffer that isn't busy or pinned (writing
+//	it back first, if it is dirty); "*cached" is then FALSE, and the caller
+//	must fill the buffer in. 返回扇区对应的缓冲区（标记为忙）；未命中时回收最久未用的空闲缓冲区，若为脏则先写回。
+//
+//	Called, and returns, with the lock held, but gives it up while
+//	waiting.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+SynchDisk::GetBuffer(int sectorNumber, bool *cached)
+{
+    CacheBuffer *buf;
+
+    for (;;)
+    {
+        if ((buf = Lookup(sectorNumber)) != NULL)
+        {
+            if (buf->busy)
+            { // being read in, or used; try again later
+                bufferFree->Wait(lock);
+                continue;
+            }
+            buf->busy = TRUE;
+            *cached = TRUE;
+            return buf;
+        }
+
+        for (buf = lruList.lruPrev;
+             (buf != &lruList) && (buf->busy || (buf->pins > 0));
+             buf = buf->lruPrev)
+            ;
+        if (buf == &lruList)
+        { // every buffer is busy, or pinned
+            bufferFree->Wait(lock);
+            continue;
+        }
+        if (buf->valid && buf->dirty)
+        { // write it back, then look again: things may have changed
+            DEBUG('f', "Buffer cache writes back sector %d\n", buf->sector);
+            buf->busy = TRUE;
+            lock->Release();
+            Transfer(buf->sector, buf->data, TRUE);
+            lock->Acquire();
+            buf->dirty = FALSE;
+            buf->busy = FALSE;
+            bufferFree->Broadcast(lock);
+            continue;
+        }
+
+        Reuse(buf, sectorNumber);
+        *cached = FALSE;
+        return buf;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Reuse
+// 	Recycle a clean buffer that isn't busy for "sectorNumber": move it
+//	to that sector's hash chain and mark it busy.  The caller fills
+//	it in.  A read-ahead sector that nobody read is counted as wasted.
+//----------------------------------------------------------------------
+
+void SynchDisk::Reuse(CacheBuffer *buf, int sectorNumber)
+{
+    CacheBuffer **link;
+
+    ASSERT(!buf->busy && !buf->dirty);
+    if (buf->valid)
+    {
+        for (link = &hashTable[buf->sector & hashMask]; *link != buf;
+             link = &(*link)->hashNext)
+            ;
+        *link = buf->hashNext; // off the old chain
+    }
+    if (buf->prefetched)
+        stats->numReadAheadWasted++;
+    buf->sector = sectorNumber;
+    buf->valid = TRUE;
+    buf->dirty = FALSE;
+    buf->busy = TRUE;
+    buf->prefetched = FALSE;
+    buf->hashNext = hashTable[sectorNumber & hashMask];
+    hashTable[sectorNumber & hashMask] = buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PutBuffer
+// 	The caller is done with a buffer: make it the most recently used,
+//	and wake up anyone waiting for it.
+//----------------------------------------------------------------------
+
+void SynchDisk::PutBuffer(CacheBuffer *buf)
+{
+    buf->busy = FALSE;
+    Touch(buf);
+    bufferFree->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Touch
+// 	Move a buffer to the front of the LRU list.
+//----------------------------------------------------------------------
+
+void SynchDisk::Touch(CacheBuffer *buf)
+{
+    buf->lruPrev->lruNext = buf->lruNext; // unlink
+    buf->lruNext->lruPrev = buf->lruPrev;
+    buf->lruPrev = &lruList; // and put it at the front
+    buf->lruNext = lruList.lruNext;
+    lruList.lruNext->lruPrev = buf;
+    lruList.lruNext = buf;
 }
@@ -14,6 +14,60 @@
 #include "disk.h"
 #include "synch.h"
 
+class Journal;
+
+#define DefaultCacheSectors 64 // sectors kept in the buffer cache,
+                               // unless overridden with "-bc"
+
+// The order in which queued disk requests are sent to the disk. 磁盘请求调度策略。
+enum DiskPolicy
+{
+  DiskFIFO,  // first come, first served
+  DiskSSTF,  // shortest positioning time first
+  DiskSCAN,  // elevator: sweep up, then down, then up...
+  DiskCLOOK, // sweep up only, then jump back to the lowest request
+  NumDiskPolicies
+};
+
+#define DefaultDiskPolicy DiskCLOOK // unless overridden with "-dp"
+
+#define PrefetchQueueSize 8 // read-ahead requests that may be waiting;
+                            // more than that are dropped
+
+// A request waiting for, or being served by, the disk.  It lives on
+// the stack of the thread that made it, which sleeps on "done" until
+// the disk interrupt says it is finished. 一个等待或正在执行的磁盘请求。
+class DiskRequest
+{
+public:
+  int sector;         // the (first) sector to read or write
+  int numSectors;     // how many consecutive sectors
+  char *data;         // where the data goes, or comes from
+  bool writing;       // write, rather than read?
+  Semaphore *done;    // V()ed when the request has completed
+  DiskRequest *next;  // next on the queue, in order of arrival
+};
+
+// One sector held in the buffer cache.  A buffer is on a hash chain
+// (found by sector number) while it holds a valid sector, and always on
+// the LRU list, most recently used first. 缓冲区缓存中的一个扇区：按扇区号散列查找，并按LRU顺序链接。
+class CacheBuffer
+{
+public:
+  int sector;             // which sector this buffer holds
+  bool valid;             // does it hold one at all?
+  bool dirty;             // modified since it was read or written back?
+  bool busy;              // in use by a thread (maybe waiting for
+                          // the disk); everyone else waits
+  bool prefetched;        // read ahead, and not yet asked for
+  int pins;               // transactions that wrote it and are not
+                          // committed yet; it may not go to disk
+  CacheBuffer *hashNext;  // next buffer on the same hash chain
+  CacheBuffer *lruPrev;   // neighbours on the LRU list
+  CacheBuffer *lruNext;
+  char data[SectorSize];  // the contents of the sector
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -24,11 +78,28 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.这个类提供了一个抽象，对于发出请求的任何单个线程，它都会一直等到操作完成后再返回。
+//
+// Any number of threads can have a request outstanding at once.  The
+// requests are queued, and whenever the disk is free the queue is
+// served in the order "policy" chooses, using where the disk head is.
+// 多个线程可以同时提交请求，磁盘空闲时按调度策略从队列中选出下一个请求。
+//
+// Recently used sectors are kept in a write-back buffer cache, so
+// that a request for one of them needs no disk I/O at all.  Modified
+// sectors only go to disk when they are evicted, or on Sync(). 最近使用的扇区保存在写回式缓冲区缓存中，脏扇区在被淘汰或Sync()时才写回磁盘。
 class SynchDisk
 {
 public:
-  SynchDisk(char *name); // Initialize a synchronous disk,
-                         // by initializing the raw Disk.通过初始化原始磁盘来初始化同步磁盘。
+  SynchDisk(char *name, int cacheSectors = DefaultCacheSectors,
+            DiskPolicy policy = DefaultDiskPolicy,
+            DiskBackend backend = DefaultDiskBackend,
+            int tracks = DefaultNumTracks,
+            int trackSize = DefaultSectorsPerTrack);
+  // Initialize a synchronous disk,
+  // by initializing the raw Disk.通过初始化原始磁盘来初始化同步磁盘。
+  // "cacheSectors" is the size of the
+  // buffer cache; 0 turns it off.  The
+  // geometry is for a new DISK file
   ~SynchDisk();          // De-allocate the synch disk data
 
   void ReadSector(int sectorNumber, char *data);
@@ -39,16 +110,98 @@ public:
   // then wait until the request is done.读/写磁盘扇区，仅在实际读或写数据时返回。这些调用Disk：：ReadRequest/WriteRequest，然后等待请求完成。
   void WriteSector(int sectorNumber, char *data);
 
+  void ReadSectors(int sectorNumber, char *data, int numSectors);
+  void WriteSectors(int sectorNumber, char *data, int numSectors);
+  // The same, for "numSectors" consecutive
+  // sectors; runs of them that have to go
+  // to the disk go in one request 连续多扇区读写，需访问磁盘的部分合并为一个请求
+
+  void Sync(); // Write every dirty cached sector
+               // back to disk, and flush the disk
+               // 把所有脏扇区写回磁盘
+
+  void SetJournal(Journal *j) { journal = j; }
+  // Sectors written in a transaction of
+  // "j" stay in the cache until it is
+  // committed
+  void Unpin(int sectorNumber); // ...as it now is
+  void ReadRaw(int sectorNumber, char *data, int numSectors);
+  void WriteRaw(int sectorNumber, char *data, int numSectors);
+  // Straight to or from the disk, never
+  // through the cache: for the journal
+  int CacheSectors() { return numBuffers; }
+
+  int Tracks() { return disk->Tracks(); } // the disk's geometry
+  int TrackSize() { return disk->TrackSize(); }
+  int Sectors() { return disk->Sectors(); }
+
+  int MaxPrefetch() { return min(disk->TrackSize(), numBuffers / 4); }
+  // Most sectors read ahead at once: a
+  // track, or a quarter of the cache
+  void Prefetch(int sectorNumber, int numSectors);
+  // Read consecutive sectors into the
+  // cache in the background, without
+  // waiting; only a hint 后台预读扇区到缓存，不等待
+
+  void PrefetchLoop(); // The read-ahead thread's body
+
   void RequestDone(); // Called by the disk device interrupt
                       // handler, to signal that the
                       // current disk operation is complete.由磁盘设备中断处理程序调用，以表示当前磁盘操作已完成。
 
+  void SetPolicy(DiskPolicy p) { policy = p; }
+  static int PolicyByName(char *name); // "fifo", "sstf", "scan" or
+                                       // "clook"; -1 if none of those
+  static const char *PolicyName(int p);
+
 private:
   Disk *disk;           // Raw disk device
-  Semaphore *semaphore; // To synchronize requesting thread
-                        // with the interrupt handler 将请求线程与中断句柄同步
-  Lock *lock;           // Only one read/write request
-                        // can be sent to the disk at a time 一次只能向磁盘发送一个读/写请求
+
+  // the request queue, shared with the interrupt handler, so it is
+  // only touched with interrupts off
+  DiskPolicy policy;    // how to pick the next request
+  DiskRequest *queue;   // requests not yet sent to the disk
+  DiskRequest *active;  // the one the disk is working on
+  bool sweepUp;         // SCAN: is the head moving outwards?
+
+  void Transfer(int sectorNumber, char *data, bool writing,
+                int numSectors = 1);
+  // queue a request and wait for it
+  void StartNext();         // send the next request to the disk
+  DiskRequest *Choose();    // take the next request off the queue
+
+  Lock *lock;           // Protects the buffer cache; not held
+                        // while waiting for the disk 保护缓冲区缓存，等待磁盘时不持有
+  Condition *bufferFree; // Signalled when a buffer stops being busy
+
+  // the buffer cache, protected by "lock"
+  CacheBuffer *buffers;    // all the buffers
+  int numBuffers;          // how many there are
+  CacheBuffer **hashTable; // chains of buffers, by sector number
+  int hashMask;            // hash table size - 1 (a power of two)
+  CacheBuffer lruList;     // dummy head of the LRU list: lruNext is
+                           // the most, lruPrev the least recently used
+  Journal *journal;        // NULL unless metadata is journaled
+
+  CacheBuffer *Lookup(int sectorNumber); // find a cached sector
+  CacheBuffer *GetBuffer(int sectorNumber, bool *cached);
+  // the busy buffer for a sector,
+  // recycling the LRU one if need be
+  void PutBuffer(CacheBuffer *buf);      // no longer busy
+  void Touch(CacheBuffer *buf);          // make it most recently used
+  void Reuse(CacheBuffer *buf, int sectorNumber);
+  // give a clean buffer a new sector
+
+  // read-ahead requests, a ring protected by "lock", taken off by
+  // a kernel thread that is started on the first one
+  int prefetchSector[PrefetchQueueSize];
+  int prefetchCount[PrefetchQueueSize];
+  int prefetchHead;             // oldest waiting request
+  int prefetchWaiting;          // how many are waiting
+  Semaphore *prefetchReady;     // V()ed for each request queued
+  Thread *prefetcher;           // NULL until the first request
+  bool stopping;                // tells the read-ahead thread to quit
+  Semaphore *prefetchDone;      // V()ed by it as it quits
 };
 
 #endif // SYNCHDISK_H
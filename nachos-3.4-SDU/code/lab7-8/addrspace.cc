@@ -18,8 +18,9 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
 #include "machine.h"
+#include "pagetrace.h"
+#include "pagecache.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -51,19 +52,29 @@ SwapHeader(NoffHeader *noffH)
 //
 //	Assumes that the object code file is in NOFF format. 假设目标代码文件为NOFF格式。
 //
-//	First, set up the translation from program memory to physical
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table 首先，设置从程序内存到物理内存的转换。现在，这真的很简单（1:1），因为我们只是一个单一的编程，而且我们有一个未分段的页表
+//	Nothing is loaded yet: every page starts out invalid, and is given
+//	a frame and filled in by PageIn when the program first touches it
+//	(demand paging).  So the space keeps "executable" open, to read
+//	code and initialized data from later on.  A page may be taken out
+//	of memory again (PageOut), and is then faulted back in from swap,
+//	or read again from the file. 按需调页：所有页初始无效，首次访问时由PageIn分配物理页并装入。
 //
-//	"executable" is the file containing the object code to load into memory  “executable”是包含要加载到内存中的目标代码的文件
+//	Pages holding code or initialized data are shared, read-only,
+//	with the other processes running the same executable, until we
+//	write them (see pagecache.h).
+//
+//	"executableFile" is the file containing the object code to load into memory  “executableFile”是包含要加载到内存中的目标代码的文件
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executableFile)
 {
-    char *tempMainMemory;
-    NoffHeader noffH;
     unsigned int size;
 
+    executable = executableFile;
+    numFaults = numFileFaults = numZeroFaults = numSwapFaults = 0;
+    numSharedFaults = numCowFaults = 0;
+    numEvictions = numSwapOuts = 0;
+
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) &&
         (WordToHost(noffH.noffMagic) == NOFFMAGIC))
@@ -76,96 +87,500 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    ASSERT(numPages <= NumPhysPages); // check we're not trying
-                                      // to run anything too big --
-                                      // at least until we have
-                                      // virtual memory 检查一下，我们不会试图运行太大的东西——至少在我们有虚拟内存之前
-
     DEBUG('a', "Initializing address space, num pages %d, size %d\n",
           numPages, size);
-    // first, set up the translation  首先，设置翻译
 
-    if (numPages > bitmap->NumClear())
-    {
-        printf("Not enough pages.\n");
-        ASSERT(FALSE);
-        return;
-    }
-
-    bool hasAvailabePid = false;
-    for (int i = 100; i < MAX_USERPROCESSES; i++)
-    {
-        if (!ThreadMap[i])
-        {
-            ThreadMap[i] = true;
-            spaceId = i; //may be should reserved 0-99 for kernel Process,
-                         //even though there is no any process at present
-            addrspaces[i] = this;
-            hasAvailabePid = true; //ther is available Pid for new process
-            break;
-        }
-    }                    //for
-    if (!hasAvailabePid) //no available Pid for new process
+    if (!NewSpaceId()) //no available Pid for new process
     {
         printf("Too many processes in Nachos !\n");
         return;
     }
-    ASSERT(hasAvailabePid);
 
+    // set up the translation: no page is in memory yet 设置页表：所有页都还不在内存中
     pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    shared = new SharedPage *[numPages];
     for (int i = 0; i < numPages; i++)
     {
-        pageTable[i].virtualPage = i; // for now, virtual page # = phys page #
-        pageTable[i].physicalPage = bitmap->Find();
-        ;
-        pageTable[i].valid = TRUE;
+        swapSlot[i] = -1;
+        shared[i] = NULL;
+        pageTable[i].virtualPage = i;
+        pageTable[i].physicalPage = -1;
+        pageTable[i].valid = FALSE; // faulted in by PageIn
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
-        pageTable[i].readOnly = FALSE; // if the code segment was entirely on
-                                       // a separate page, we could set its
-                                       // pages to be read-only 如果代码段完全位于单独的页面上，我们可以将其页面设置为只读
+        pageTable[i].readOnly = FALSE; // set by PageIn, for shared pages
     }
+    if (machine->pageTrace != NULL)
+        machine->pageTrace->Event(TraceCreate, spaceId);
+}
 
-    // zero out the entire address space, to zero the unitialized data segment
-    // and the stack segment 将整个地址空间归零，将单元化数据段和堆栈段归零
-    // bzero(machine->mainMemory, size);
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create a copy of the address space "parent", for Fork, without
+//	copying a single page: every page the parent has in memory or in
+//	swap is shared, read-only, by both (an anonymous shared page, if
+//	it was the parent's own), and copied only when one of them writes
+//	it (see CopyOnWrite).  Pages the parent never touched stay
+//	untouched: each faults them in from the executable. Fork时不复制
+//	任何页：父进程已在内存或交换区的页改为父子只读共享，写时再复制。
+//
+//	The parent must be the current space: its mappings are changed,
+//	so its cached translations are flushed.  The caller must have made
+//	sure that there is a space id left (SpaceIdFree).
+//----------------------------------------------------------------------
 
-    tempMainMemory = new char[MemorySize];
+AddrSpace::AddrSpace(AddrSpace *parent)
+{
+    TranslationEntry *entry;
+    SharedPage *page;
 
-    // then, copy in the code and data segments into memory
-    if (noffH.code.size > 0)
-    {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
-              noffH.code.virtualAddr, noffH.code.size);
-        executable->ReadAt(&(tempMainMemory[noffH.code.virtualAddr]),
-                           noffH.code.size, noffH.code.inFileAddr);
-    }
-    if (noffH.initData.size > 0)
-    {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
-              noffH.initData.virtualAddr, noffH.initData.size);
-        executable->ReadAt(&(tempMainMemory[noffH.initData.virtualAddr]),
-                           noffH.initData.size, noffH.initData.inFileAddr);
+    executable = parent->executable->Duplicate(); // the same inode
+    noffH = parent->noffH;
+    numPages = parent->numPages;
+    numFaults = numFileFaults = numZeroFaults = numSwapFaults = 0;
+    numSharedFaults = numCowFaults = 0;
+    numEvictions = numSwapOuts = 0;
+    if (!NewSpaceId())
+    { // the caller checked SpaceIdFree
+        printf("Too many processes in Nachos !\n");
+        ASSERT(FALSE);
     }
+    DEBUG('a', "Forking address space %d from %d, num pages %d\n",
+          spaceId, parent->spaceId, numPages);
 
+    pageTable = new TranslationEntry[numPages];
+    swapSlot = new int[numPages];
+    shared = new SharedPage *[numPages];
+    frameTable->Acquire(); // nothing is paged out meanwhile
     for (int i = 0; i < numPages; i++)
-        memcpy(&(machine->mainMemory[pageTable[i].physicalPage * PageSize]), &(tempMainMemory[i * PageSize]), PageSize);
-    delete[] tempMainMemory;
+    {
+        entry = &parent->pageTable[i];
+        page = parent->shared[i];
+        if ((page == NULL) && (entry->valid || (parent->swapSlot[i] >= 0)))
+        { // the parent's own page: share it from now on
+            if (entry->valid && entry->dirty && (parent->swapSlot[i] >= 0))
+            { // the copy in swap is stale
+                swapArea->Free(parent->swapSlot[i]);
+                parent->swapSlot[i] = -1;
+            }
+            page = parent->shared[i] = pageCache->Share(
+                parent, i, entry->valid ? entry->physicalPage : -1,
+                parent->swapSlot[i]);
+            parent->swapSlot[i] = -1;
+            entry->readOnly = TRUE;
+            entry->dirty = FALSE; // the shared page is never written
+        }
+        if (page != NULL)
+            pageCache->AddUser(page, this);
+        swapSlot[i] = -1;
+        shared[i] = page;
+        pageTable[i] = *entry; // mapped where the parent has it, if at all
+        pageTable[i].use = FALSE;
+    }
+    if (machine->pageTable == parent->pageTable)
+        machine->FlushHostTLB(); // the parent's pages became read-only
+    frameTable->Release();
+    if (machine->pageTrace != NULL)
+        machine->pageTrace->Event(TraceCreate, spaceId);
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space: free the frames of the pages that
+//	are in memory, and the swap slots of the pages written out, stop
+//	sharing the shared ones (the last sharer frees the frame), and
+//	close the executable.  The frame table is locked meanwhile, so
+//	that none of our pages is being paged out as we go.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
     ThreadMap[spaceId] = 0;
     addrspaces[spaceId] = NULL;
+    if (machine->pageTrace != NULL)
+        machine->pageTrace->Event(TraceExit, spaceId);
 
+    frameTable->Acquire();
     for (int i = 0; i < numPages; i++)
-        bitmap->Clear(pageTable[i].physicalPage);
+    {
+        if (shared[i] != NULL)
+            pageCache->Put(shared[i], this);
+        else if (pageTable[i].valid)
+        {
+            machine->InvalidateDecodedPage(pageTable[i].physicalPage);
+            frameTable->Free(pageTable[i].physicalPage);
+        }
+        if (swapSlot[i] >= 0)
+            swapArea->Free(swapSlot[i]);
+    }
+    frameTable->Release();
+    if (machine->pageTable == pageTable)
+    { // don't leave the machine translating through a dead table
+        machine->pageTable = NULL;
+        machine->FlushHostTLB();
+    }
     delete[] pageTable;
+    delete[] swapSlot;
+    delete[] shared;
+    delete executable;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Handle a page fault on virtual page "vpn", which is not in memory:
+//	get a frame from the frame table (which may page out someone
+//	else's page to free one), fill it -- from swap if the page was
+//	written out, else as LoadPage does -- and make the translation
+//	valid.  The faulting instruction can then be retried. 缺页处理：
+//	分配物理页（必要时换出他页），从交换区或可执行文件装入，使页表项有效。
+//
+//	A page of the executable that we have not written is shared with
+//	the other processes running it: if one of them has it in memory
+//	already, we just map that frame, read-only. 未写过的可执行文件页与
+//	运行同一程序的其他进程共享，已在内存时直接只读映射。
+//
+//	Faults are served one at a time, with the frame table locked.
+//
+// Returns:
+//	FALSE if no frame can be had: memory and swap space are full.
+//----------------------------------------------------------------------
+
+bool AddrSpace::PageIn(unsigned int vpn)
+{
+    int frame;
+    char *page;
+
+    ASSERT(vpn < numPages);
+    frameTable->Acquire();
+    if (pageTable[vpn].valid)
+    { // faulted in by someone else while we waited
+        frameTable->Release();
+        return TRUE;
+    }
+    if ((shared[vpn] == NULL) && (swapSlot[vpn] < 0) && Shareable(vpn))
+        shared[vpn] = pageCache->Get(executable, vpn, this);
+    if ((shared[vpn] != NULL) && (shared[vpn]->frame >= 0))
+    {
+        frame = shared[vpn]->frame;
+        DEBUG('a', "Page fault: virtual page %d shared in frame %d\n", vpn, frame);
+        numSharedFaults++;
+        stats->numSharedFaults++;
+    }
+    else
+    {
+        if ((frame = frameTable->Allocate(this, vpn, shared[vpn])) < 0)
+        {
+            frameTable->Release();
+            printf("Out of memory and swap space.\n");
+            return FALSE;
+        }
+        DEBUG('a', "Page fault: virtual page %d into frame %d\n", vpn, frame);
+        page = &machine->mainMemory[frame * PageSize];
+        FillPage(vpn, page);
+        machine->InvalidateDecodedPage(frame); // frame now holds our code/data
+        if (shared[vpn] != NULL)
+            shared[vpn]->frame = frame;
+    }
+
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE; // the same as its copy in swap, if any
+    pageTable[vpn].readOnly = (shared[vpn] != NULL); // written: copied
+    if (machine->pageTable == pageTable)
+        machine->FlushHostTLB(); // a mapping was added
+
+    numFaults++;
+    stats->numPageFaults++;
+    frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Take virtual page "vpn" out of memory, on behalf of the frame
+//	table, which holds its lock.  The page is made invalid first, so
+//	that we fault (and wait) if we touch it meanwhile.  If it changed
+//	since it was faulted in, it is written to its swap slot (given one
+//	the first time round); if not, the copy in swap, or in the
+//	executable, or the zeroes, are still good. 换出页：脏页写入交换区，
+//	干净页直接丢弃（交换区或可执行文件中的副本仍有效）。
+//
+// Returns:
+//	FALSE, leaving the page in memory, if it is dirty and the swap
+//	area (or the disk) is full.
+//----------------------------------------------------------------------
+
+bool AddrSpace::PageOut(unsigned int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+    bool newSlot = FALSE;
+
+    ASSERT(entry->valid);
+    entry->valid = FALSE;
+    if (machine->pageTable == pageTable)
+        machine->FlushHostTLB(); // a mapping was removed
+    if (entry->dirty)
+    {
+        if (swapSlot[vpn] < 0)
+        {
+            if ((swapSlot[vpn] = swapArea->Allocate()) < 0)
+            {
+                entry->valid = TRUE;
+                return FALSE;
+            }
+            newSlot = TRUE;
+        }
+        if (!swapArea->Write(swapSlot[vpn],
+                             &machine->mainMemory[entry->physicalPage * PageSize]))
+        {
+            if (newSlot)
+            {
+                swapArea->Free(swapSlot[vpn]);
+                swapSlot[vpn] = -1;
+            }
+            entry->valid = TRUE;
+            return FALSE;
+        }
+        numSwapOuts++;
+        stats->numSwapOuts++;
+    }
+    entry->physicalPage = -1;
+    entry->dirty = FALSE;
+    numEvictions++;
+    stats->numEvictions++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TestAndClearUse
+// 	Return whether virtual page "vpn" was used since the last time
+//	we were asked, and clear its use bit.
+//----------------------------------------------------------------------
+
+bool AddrSpace::TestAndClearUse(unsigned int vpn)
+{
+    bool used = pageTable[vpn].use;
+
+    pageTable[vpn].use = FALSE;
+    return used;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to virtual page "vpn", which we share read-only:
+//	give the page a frame of its own, and make it writable.  The
+//	faulting instruction can then be retried.  If no one else uses
+//	the shared page any more, its frame just becomes ours; otherwise
+//	it is copied (or, if it was taken out of memory meanwhile, read
+//	in again). 写时复制：若无其他使用者则直接接管物理页，否则复制一份。
+//
+// Returns:
+//	FALSE if no frame can be had: memory and swap space are full.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(unsigned int vpn)
+{
+    SharedPage *page = shared[vpn];
+    int frame;
+
+    ASSERT(vpn < numPages);
+    frameTable->Acquire();
+    if (!pageTable[vpn].valid || !pageTable[vpn].readOnly)
+    { // paged out, or copied, while we waited: retry and see
+        frameTable->Release();
+        return TRUE;
+    }
+    ASSERT((page != NULL) && (page->frame == pageTable[vpn].physicalPage));
+    if (pageCache->NumUsers(page) == 1)
+    { // the last sharer: take the frame over
+        frame = page->frame;
+        page->frame = -1;
+        frameTable->SetOwner(frame, this, vpn);
+    }
+    else
+    {
+        if ((frame = frameTable->Allocate(this, vpn)) < 0)
+        {
+            frameTable->Release();
+            printf("Out of memory and swap space.\n");
+            return FALSE;
+        }
+        if (page->frame >= 0)
+            memcpy(&machine->mainMemory[frame * PageSize],
+                   &machine->mainMemory[page->frame * PageSize], PageSize);
+        else // evicted to free the frame we got
+            FillPage(vpn, &machine->mainMemory[frame * PageSize]);
+        machine->InvalidateDecodedPage(frame);
+    }
+    DEBUG('a', "Copy on write: virtual page %d into frame %d\n", vpn, frame);
+    pageTable[vpn].dirty = (page->sector < 0); // an anonymous page is
+                                               // only in the frame now
+    pageCache->Put(page, this);
+    shared[vpn] = NULL;
+
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].readOnly = FALSE;
+    if (machine->pageTable == pageTable)
+        machine->FlushHostTLB(); // a mapping was changed
+
+    numCowFaults++;
+    stats->numCowFaults++;
+    frameTable->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	The shared page in "frame" is being taken out of memory by the
+//	frame table, which holds its lock.  If we map it at virtual page
+//	"vpn", stop: we fault it in again on the next touch.  Nothing
+//	needs writing -- a shared page is never written.
+//----------------------------------------------------------------------
+
+void AddrSpace::Unmap(unsigned int vpn, int frame)
+{
+    if (!pageTable[vpn].valid || (pageTable[vpn].physicalPage != frame))
+        return; // not faulted in by us (yet)
+    pageTable[vpn].valid = FALSE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].physicalPage = -1;
+    if (machine->pageTable == pageTable)
+        machine->FlushHostTLB(); // a mapping was removed
+    numEvictions++;
+    stats->numEvictions++;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FillPage
+// 	Fill "page" with the current contents of virtual page "vpn",
+//	which is not in memory: from the swap slot of the shared page
+//	or of our own, if it has one, else from the executable (or zero)
+//	as LoadPage does.
+//----------------------------------------------------------------------
+
+void AddrSpace::FillPage(unsigned int vpn, char *page)
+{
+    int slot = (shared[vpn] != NULL) ? shared[vpn]->swapSlot : swapSlot[vpn];
+
+    if (slot >= 0)
+    {
+        if (!swapArea->Read(slot, page))
+            ASSERT(FALSE); // the slot was written when it was given out
+        numSwapFaults++;
+    }
+    else
+        LoadPage(vpn, page);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::NewSpaceId
+// 	Give the space the first free id, and enter it in the table of
+//	spaces.  Ids below 100 are never given out.
+//
+// Returns:
+//	FALSE if every id is in use.
+//----------------------------------------------------------------------
+
+bool AddrSpace::NewSpaceId()
+{
+    for (int i = 100; i < MAX_USERPROCESSES; i++)
+    {
+        if (!ThreadMap[i])
+        {
+            ThreadMap[i] = true;
+            spaceId = i; //may be should reserved 0-99 for kernel Process,
+                         //even though there is no any process at present
+            addrspaces[i] = this;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SpaceIdFree
+// 	Return whether NewSpaceId would find an id for one more space.
+//----------------------------------------------------------------------
+
+bool AddrSpace::SpaceIdFree()
+{
+    for (int i = 100; i < MAX_USERPROCESSES; i++)
+        if (!ThreadMap[i])
+            return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Shareable
+// 	Return whether virtual page "vpn" holds some code or initialized
+//	data: then it starts out the same in every process running the
+//	executable, and can be shared until written.
+//----------------------------------------------------------------------
+
+bool AddrSpace::Shareable(unsigned int vpn)
+{
+    Segment *segments[2] = {&noffH.code, &noffH.initData};
+    int pageStart = vpn * PageSize, pageEnd = pageStart + PageSize;
+
+    for (int i = 0; i < 2; i++)
+        if ((segments[i]->size > 0) &&
+            (max(pageStart, segments[i]->virtualAddr) <
+             min(pageEnd, segments[i]->virtualAddr + segments[i]->size)))
+            return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill "page" with the initial contents of virtual page "vpn": the
+//	parts of it that lie in the code or initialized data segment are
+//	read from the executable, and the rest (uninitialized data, stack)
+//	is zero.  Only the bytes the page needs are read. 代码段和已初始化数据
+//	段部分从可执行文件读入，其余（未初始化数据、栈）清零。
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadPage(unsigned int vpn, char *page)
+{
+    Segment *segments[2] = {&noffH.code, &noffH.initData};
+    int pageStart = vpn * PageSize, pageEnd = pageStart + PageSize;
+    int start, end;
+    bool fromFile = FALSE;
+
+    memset(page, 0, PageSize);
+    for (int i = 0; i < 2; i++)
+    {
+        start = max(pageStart, segments[i]->virtualAddr);
+        end = min(pageEnd, segments[i]->virtualAddr + segments[i]->size);
+        if (start >= end)
+            continue; // the segment is not on this page
+        executable->ReadAt(&page[start - pageStart], end - start,
+                           segments[i]->inFileAddr + (start - segments[i]->virtualAddr));
+        fromFile = TRUE;
+    }
+    if (fromFile)
+        numFileFaults++;
+    else
+        numZeroFaults++;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PrintFaults
+// 	Print how many pages of this space were faulted in, and how, how
+//	many shared pages were copied, and how many pages were taken out
+//	of memory again -- with the syscall debugging ("-d x"), so that a
+//	program's own output is left alone.
+//----------------------------------------------------------------------
+
+void AddrSpace::PrintFaults()
+{
+    DEBUG('x', "space %d: %d page faults (%d read from file, %d zero-filled, "
+               "%d from swap, %d shared), %d copied on write, "
+               "%d evicted (%d written to swap), %d pages\n",
+          spaceId, numFaults, numFileFaults, numZeroFaults, numSwapFaults,
+          numSharedFaults, numCowFaults, numEvictions, numSwapOuts, numPages);
 }
 
 //----------------------------------------------------------------------
@@ -223,6 +638,9 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushHostTLB(); // cached translations were for the old table
+    if (machine->pageTrace != NULL)
+        machine->pageTrace->Event(TraceSwitch, spaceId);
 }
 
 void AddrSpace::Print()
@@ -232,7 +650,10 @@ void AddrSpace::Print()
     printf("\tVirtPage, \tPhysPage\n");
     for (int i = 0; i < numPages; i++)
     {
-        printf("\t %d, \t\t%d\n", pageTable[i].virtualPage, pageTable[i].physicalPage);
+        if (pageTable[i].valid)
+            printf("\t %d, \t\t%d\n", pageTable[i].virtualPage, pageTable[i].physicalPage);
+        else
+            printf("\t %d, \t\t-\n", pageTable[i].virtualPage); // not in memory yet
     }
     printf("============================================\n\n");
 }
@@ -240,4 +661,148 @@ void AddrSpace::Print()
 int AddrSpace::getSpaceId()
 {
     return spaceId;
-}
\ No newline at end of file
+}
+//----------------------------------------------------------------------
+// AddrSpace::UserToPhys
+// 	Translate a user virtual address through this space's page table,
+//	setting the use (and, when "writing", dirty) bit like the MMU would.
+//	A page that is not in memory yet is faulted in first, and a
+//	shared page we write is copied first, as the program's own access
+//	would. 页不在内存时先调入，写共享页时先复制。
+//
+// Returns:
+//	the physical address, or -1 if the address is outside the space,
+//	or the page cannot be faulted in or copied. 返回物理地址；地址非法、
+//	无法调入或复制时返回-1。
+//----------------------------------------------------------------------
+
+int AddrSpace::UserToPhys(int virtAddr, bool writing)
+{
+    unsigned int vpn = (unsigned)virtAddr / PageSize;
+
+    if ((virtAddr < 0) || (vpn >= numPages))
+        return -1;
+    for (;;)
+    { // either may wait, and the page may change meanwhile
+        if (!pageTable[vpn].valid)
+        {
+            if (!PageIn(vpn))
+                return -1;
+        }
+        else if (writing && pageTable[vpn].readOnly)
+        {
+            if (!CopyOnWrite(vpn))
+                return -1;
+        }
+        else
+            break;
+    }
+    pageTable[vpn].use = TRUE;
+    if (writing)
+        pageTable[vpn].dirty = TRUE;
+    return pageTable[vpn].physicalPage * PageSize + virtAddr % PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InSpace
+// 	Return whether the "size" bytes at user address "virtAddr" lie
+//	inside this address space.  A system call checks this before it
+//	allocates a kernel buffer of the size the user asked for.
+//----------------------------------------------------------------------
+
+bool AddrSpace::InSpace(int virtAddr, int size)
+{
+    return (virtAddr >= 0) && (size >= 0) &&
+           (size <= (int)(numPages * PageSize) - virtAddr);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyFromUser
+// 	Copy "size" bytes at user address "virtAddr" into the kernel
+//	buffer "into".  Each page is translated once, and the part of the
+//	range on it is copied with a single memcpy. 每页只翻译一次，整段memcpy。
+//
+// Returns:
+//	FALSE if part of the range is not mapped; "into" may then
+//	hold a partial copy.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyFromUser(int virtAddr, char *into, int size)
+{
+    int physAddr, chunk;
+
+    while (size > 0)
+    {
+        if ((physAddr = UserToPhys(virtAddr, FALSE)) < 0)
+            return FALSE;
+        chunk = min(size, PageSize - virtAddr % PageSize);
+        memcpy(into, &machine->mainMemory[physAddr], chunk);
+        virtAddr += chunk;
+        into += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyToUser
+// 	Copy "size" bytes from the kernel buffer "from" to user address
+//	"virtAddr", a page fragment at a time.  Any predecoded copy of a
+//	page we write is dropped, as WriteMem would do.
+//
+// Returns:
+//	FALSE if part of the range is not mapped or is read-only;
+//	the pages before it have then already been written.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyToUser(int virtAddr, char *from, int size)
+{
+    int physAddr, chunk;
+
+    while (size > 0)
+    {
+        if ((physAddr = UserToPhys(virtAddr, TRUE)) < 0)
+            return FALSE;
+        chunk = min(size, PageSize - virtAddr % PageSize);
+        memcpy(&machine->mainMemory[physAddr], from, chunk);
+        machine->InvalidateDecodedPage(physAddr / PageSize);
+        virtAddr += chunk;
+        from += chunk;
+        size -= chunk;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyStringFromUser
+// 	Copy the null-terminated string at user address "virtAddr" into
+//	"into", which has room for "maxSize" bytes.  The string is
+//	scanned a page fragment at a time, and never beyond "maxSize". 复制用户态以'\0'结尾的字符串，长度有上限。
+//
+// Returns:
+//	the length of the string (not counting the null), or -1 if it
+//	runs into an unmapped page or does not fit in "maxSize" bytes.
+//	"into" is always null-terminated.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyStringFromUser(int virtAddr, char *into, int maxSize)
+{
+    int physAddr, chunk, length = 0;
+    char *page;
+
+    ASSERT(maxSize > 0);
+    into[0] = '\0';
+    while (length < maxSize)
+    {
+        if ((physAddr = UserToPhys(virtAddr + length, FALSE)) < 0)
+            return -1;
+        page = &machine->mainMemory[physAddr];
+        chunk = min(maxSize - length, PageSize - (virtAddr + length) % PageSize);
+        for (int i = 0; i < chunk; i++)
+            if ((into[length + i] = page[i]) == '\0')
+                return length + i;
+        length += chunk;
+    }
+    into[maxSize - 1] = '\0'; // too long
+    return -1;
+}
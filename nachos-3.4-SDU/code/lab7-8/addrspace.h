@@ -16,6 +16,9 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "translate.h"
+#include "noff.h"
+
+class SharedPage;
 
 #define UserStackSize 1024 // increase this as necessary!
 
@@ -25,6 +28,13 @@ public:
   AddrSpace(OpenFile *executable); // Create an address space,
                                    // initializing it with the program
                                    // stored in the file "executable" 创建一个地址空间，用存储在文件“executable”中的程序初始化它
+                                   // (pages are loaded on first touch,
+                                   // so the space keeps "executable"
+                                   // open, and closes it when deleted)
+  AddrSpace(AddrSpace *parent);    // A copy of "parent", for Fork:
+                                   // every page is shared with it
+                                   // until one of them writes it
+                                   // (check SpaceIdFree first)
   ~AddrSpace();                    // De-allocate an address space 取消分配地址空间
 
   void InitRegisters(); // Initialize user-level CPU registers,
@@ -35,13 +45,77 @@ public:
 
   void Print();
   int getSpaceId();
+  static bool SpaceIdFree(); // Is an id left for one more space?
+
+  bool PageIn(unsigned int vpn); // Handle a page fault on virtual
+                                 // page "vpn": give it a frame and
+                                 // fill it; FALSE if out of memory
+                                 // and swap space 缺页处理
+  bool PageOut(unsigned int vpn); // Take page "vpn" out of memory,
+                                  // writing it to swap if dirty; FALSE
+                                  // if the swap area is full 换出
+  bool TestAndClearUse(unsigned int vpn); // Was the page used since
+                                          // the last call?  For the
+                                          // clock algorithm
+  bool CopyOnWrite(unsigned int vpn); // A write to shared page "vpn":
+                                      // give us a copy of our own;
+                                      // FALSE if out of memory 写时复制
+  void Unmap(unsigned int vpn, int frame); // The shared page in "frame"
+                                           // is leaving memory: stop
+                                           // mapping it at "vpn"
+  void PrintFaults();            // Print this space's paging counters
+                                 // (with -d x)
+
+  // Copy data between the kernel and this address space, one page
+  // fragment at a time.  All return FALSE (or -1) if some byte of the
+  // user range is not mapped (or is read-only, for writes).
+  // 按页片段在内核与用户地址空间之间复制数据，遇到非法地址时返回错误。
+  bool InSpace(int virtAddr, int size); // Could the range be mapped?
+                                        // (check before allocating
+                                        // a kernel buffer for it)
+  bool CopyFromUser(int virtAddr, char *into, int size);
+  bool CopyToUser(int virtAddr, char *from, int size);
+  int CopyStringFromUser(int virtAddr, char *into, int maxSize);
+  // Copy a null-terminated string of
+  // at most maxSize bytes (counting the
+  // null); returns its length, or -1
 
 private:
+  int UserToPhys(int virtAddr, bool writing); // physical address, or -1
+
   TranslationEntry *pageTable; // Assume linear page table translation 现在假设线性页表翻译！
                                // for now!
   unsigned int numPages;       // Number of pages in the virtual
                                // address space 虚拟地址空间中的页数
   int spaceId;
+
+  OpenFile *executable; // where code and initialized data come from
+  NoffHeader noffH;     // ...and where in it they are
+
+  int *swapSlot;     // for each page, its slot in the swap area,
+                     // or -1 if it has never been written out
+  SharedPage **shared; // for each page, the copy we share with other
+                       // runs of the program (or with our parent or
+                       // children, after Fork), or NULL if it is ours
+
+  int numFaults;     // pages faulted in so far 本进程缺页次数
+  int numFileFaults; // ...of which some part was read from the file
+  int numZeroFaults; // ...or which were just zero-filled
+                     // (uninitialized data, stack)
+  int numSwapFaults; // ...or which were read back from swap
+  int numSharedFaults; // ...or which were already in memory, shared
+  int numCowFaults;  // shared pages copied when we wrote them
+  int numEvictions;  // pages taken out of memory 被换出的页数
+  int numSwapOuts;   // ...of which were dirty, and written to swap
+
+  void LoadPage(unsigned int vpn, char *page); // fill "page" with the
+                                               // contents of "vpn"
+  bool Shareable(unsigned int vpn); // does "vpn" start out as a part
+                                    // of the executable?
+  void FillPage(unsigned int vpn, char *page); // fill "page" with the
+                                               // current contents of
+                                               // "vpn", not in memory
+  bool NewSpaceId(); // give the space an id; FALSE if none is left
 };
 
 #endif // ADDRSPACE_H
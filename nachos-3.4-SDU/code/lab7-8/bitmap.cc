@@ -22,8 +22,10 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++)
-        Clear(i);
+    dirty = new bool[numWords];
+    for (int i = 0; i < numWords; i++)
+        map[i] = 0;
+    MarkClean();
 }
 
 //----------------------------------------------------------------------
@@ -33,7 +35,8 @@ BitMap::BitMap(int nitems)
 
 BitMap::~BitMap()
 {
-    delete map;
+    delete[] map;
+    delete[] dirty;
 }
 
 //----------------------------------------------------------------------
@@ -47,6 +50,7 @@ void BitMap::Mark(int which)
 {
     ASSERT(which >= 0 && which < numBits);
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    Changed(which / BitsInWord);
 }
 
 //----------------------------------------------------------------------
@@ -60,6 +64,7 @@ void BitMap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    Changed(which / BitsInWord);
 }
 
 //----------------------------------------------------------------------
@@ -99,6 +104,63 @@ int BitMap::Find()
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find a run of clear bits, at most "wanted" long, and set them.
+//	The first run that is "wanted" long, looking from bit "from" on
+//	(and wrapping around), is taken; if there is none, the longest
+//	run there is.  Runs do not wrap around the end of the map.
+//	找一段连续的空闲位：优先取从 from 开始的第一段足够长的，否则取最长的一段。
+//
+//	"from" is where to start looking, e.g. just past the caller's
+//		last run, so that it can be extended in place
+//	"wanted" is how many bits the caller would like
+//	"length" is set to how many bits were actually found
+//
+//	Returns the first bit of the run, -1 if no bits are clear.
+//----------------------------------------------------------------------
+
+int BitMap::FindRun(int from, int wanted, int *length)
+{
+    int best = -1, bestLength = 0;
+    int i, n, start, run;
+
+    ASSERT(wanted > 0);
+    if ((from < 0) || (from >= numBits))
+        from = 0;
+    for (n = 0; n < numBits;)
+    {
+        i = (from + n) % numBits;
+        if (((i % BitsInWord) == 0) && (i + BitsInWord <= numBits) &&
+            (n + BitsInWord <= numBits) && (map[i / BitsInWord] == ~0U))
+        { // a whole word in use, skip it
+            n += BitsInWord;
+            continue;
+        }
+        if (Test(i))
+        {
+            n++;
+            continue;
+        }
+        start = i;
+        for (run = 0; (run < wanted) && (n < numBits) &&
+                      (start + run < numBits) && !Test(start + run);
+             run++)
+            n++;
+        if (run > bestLength)
+        {
+            best = start;
+            bestLength = run;
+        }
+        if (run == wanted)
+            break;
+    }
+    for (i = 0; i < bestLength; i++)
+        Mark(best + i);
+    *length = bestLength;
+    return best;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -144,6 +206,7 @@ void BitMap::Print()
 void BitMap::FetchFrom(OpenFile *file)
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    MarkClean();
 }
 
 //----------------------------------------------------------------------
@@ -156,4 +219,62 @@ void BitMap::FetchFrom(OpenFile *file)
 void BitMap::WriteBack(OpenFile *file)
 {
     file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    MarkClean();
+}
+
+//----------------------------------------------------------------------
+// BitMap::WriteBackDirty
+// 	Store only the words of the bitmap that changed since it was last
+//	fetched or written back; each run of adjacent dirty words is
+//	written with one WriteAt.  Cheaper than WriteBack when a few bits
+//	of a large map change. 只把改动过的字写回文件，相邻的脏字合并为一次写。
+//
+//	"file" is the place to write the bitmap to
+//----------------------------------------------------------------------
+
+void BitMap::WriteBackDirty(OpenFile *file)
+{
+    int first, last;
+
+    for (first = 0; (numDirty > 0) && (first < numWords); first = last)
+    {
+        if (!dirty[first])
+        {
+            last = first + 1;
+            continue;
+        }
+        for (last = first; (last < numWords) && dirty[last]; last++)
+        {
+            dirty[last] = FALSE;
+            numDirty--;
+        }
+        file->WriteAt((char *)&map[first], (last - first) * sizeof(unsigned),
+                      first * sizeof(unsigned));
+    }
+}
+
+//----------------------------------------------------------------------
+// BitMap::Changed
+// 	Remember that word "word" of the map no longer matches the file.
+//----------------------------------------------------------------------
+
+void BitMap::Changed(int word)
+{
+    if (!dirty[word])
+    {
+        dirty[word] = TRUE;
+        numDirty++;
+    }
+}
+
+//----------------------------------------------------------------------
+// BitMap::MarkClean
+// 	Forget about all changes: the map and its file agree.
+//----------------------------------------------------------------------
+
+void BitMap::MarkClean()
+{
+    for (int i = 0; i < numWords; i++)
+        dirty[i] = FALSE;
+    numDirty = 0;
 }
@@ -25,13 +25,63 @@
 #include "system.h"
 #include "syscall.h"
 
-extern void StartProcess(int spaceId);
+extern void StartProcess(int spaceId), StartForkedProcess(int spaceId);
+
+#define MaxPathLength 128 // longest file name a syscall takes, with the null
 
 void AdvancePC()
 {
     machine->WriteRegister(PCReg, machine->ReadRegister(PCReg) + 4);
     machine->WriteRegister(NextPCReg, machine->ReadRegister(NextPCReg) + 4);
 }
+
+//----------------------------------------------------------------------
+// BadUserAddress
+// 	A system call argument pointed outside the caller's address space
+//	(or a name was too long): return -1 to the caller instead of
+//	crashing the kernel. 系统调用参数指向非法用户地址时，向用户返回-1。
+//----------------------------------------------------------------------
+
+static void
+BadUserAddress(const char *call, int addr)
+{
+    DEBUG('x', "thread:%s\t%s: bad user address 0x%x\n", currentThread->getName(), call, addr);
+    machine->WriteRegister(2, -1);
+    AdvancePC();
+}
+
+//----------------------------------------------------------------------
+// ExitProcess
+// 	End the current process, with exit status "status": for the Exit
+//	system call, and for a process that has to be killed (its page
+//	fault cannot be served), so that the rest of Nachos goes on.
+//	Does not return. 结束当前进程；缺页无法处理时也用它只终止出错进程。
+//----------------------------------------------------------------------
+
+static void
+ExitProcess(int status)
+{
+    DEBUG('x', "thread:%s\tExit(%d):\n", currentThread->getName(), status);
+    currentThread->pcb->setExitStatus(status);
+    currentThread->pcb->space->PrintFaults();
+
+    List *terminatedList = scheduler->getTerminatedList();
+    if (currentThread->pcb->getExitStatus() == 99)
+    {
+        DEBUG('x', "thread:%s\tparent delete terminatedList:\n", currentThread->getName());
+        Thread *thread;
+        while ((thread = (Thread *)(terminatedList->Remove())) != NULL)
+            delete thread;
+    }
+
+#ifdef FILESYS_CACHE
+    if (scheduler->ReadyListEmpty())
+        fileSystem->Sync(); // nothing else to run: the machine may go
+                            // idle next, and then halts without syncing
+#endif
+    currentThread->Finish();
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -59,7 +109,29 @@ void ExceptionHandler(ExceptionType which)
 {
     int type = machine->ReadRegister(2);
 
-    if ((which == SyscallException) && (type == SC_Halt))
+    if (which == PageFaultException)
+    { // demand paging: bring the page in, and retry the instruction
+      // (the PC has not moved past it) 缺页：调入后重新执行该指令
+        int badVAddr = machine->ReadRegister(BadVAddrReg);
+
+        if (!currentThread->pcb->space->PageIn((unsigned)badVAddr / PageSize))
+        {
+            printf("thread:%s\tpage fault at 0x%x cannot be served\n", currentThread->getName(), badVAddr);
+            ExitProcess(-1);
+        }
+    }
+    else if (which == ReadOnlyException)
+    { // a write to a page shared with other runs of the program: copy
+      // it, and retry the instruction 写共享页：写时复制后重新执行
+        int badVAddr = machine->ReadRegister(BadVAddrReg);
+
+        if (!currentThread->pcb->space->CopyOnWrite((unsigned)badVAddr / PageSize))
+        {
+            printf("thread:%s\tcopy on write at 0x%x cannot be served\n", currentThread->getName(), badVAddr);
+            ExitProcess(-1);
+        }
+    }
+    else if ((which == SyscallException) && (type == SC_Halt))
     {
         DEBUG('x', "thread:%s\tShutdown, initiated by user program.\n", currentThread->getName());
         interrupt->Halt();
@@ -68,14 +140,15 @@ void ExceptionHandler(ExceptionType which)
     {
         // printf("Execute system call of Exec()\n");
         // DEBUG('x', "Execute system call of Exec()\n");
-        char filename[50];
+        char filename[MaxPathLength];
         int addr = machine->ReadRegister(4);
-        int i = 0;
-        do
+
+        //read filename from mainMemory
+        if (currentThread->pcb->space->CopyStringFromUser(addr, filename, MaxPathLength) < 0)
         {
-            //read filename from mainMemory
-            machine->ReadMem(addr + i, 1, (int *)&filename[i]);
-        } while (filename[i++] != '\0');
+            BadUserAddress("Exec", addr);
+            return;
+        }
         // printf("Exec(%s):\n",filename);
         DEBUG('x', "thread:%s\tExec(%s):\n", currentThread->getName(), filename);
 
@@ -107,25 +180,34 @@ void ExceptionHandler(ExceptionType which)
         AdvancePC();
 
         // currentThread->Yield();
+        // the space keeps "executable" open, to fault its pages in
+    }
+    else if ((which == SyscallException) && (type == SC_Fork))
+    { // a copy of the caller, sharing its pages copy-on-write: nothing
+      // is read from disk or copied now 复制调用进程，页写时复制
+        if (!AddrSpace::SpaceIdFree())
+        { // too many processes: the caller gets -1
+            DEBUG('x', "thread:%s\tFork: no space id left\n", currentThread->getName());
+            machine->WriteRegister(2, -1);
+            AdvancePC();
+            return;
+        }
+        AddrSpace *space = new AddrSpace(currentThread->pcb->space);
+        Thread *thread = new Thread(currentThread->getName());
 
-        delete executable;
+        DEBUG('x', "thread:%s\tFork: child space %d\n", currentThread->getName(), space->getSpaceId());
+        thread->pcb->space = space;
+        thread->pcb->copyFiles(currentThread->pcb);
+
+        machine->WriteRegister(2, space->getSpaceId());
+        AdvancePC();
+        thread->SaveUserState();           // the child goes on from here
+        thread->pcb->userRegisters[2] = 0; // ...but Fork returns 0 to it
+        thread->Fork(StartForkedProcess, space->getSpaceId());
     }
     else if ((which == SyscallException) && (type == SC_Exit))
     {
-        int ExitStatus = machine->ReadRegister(4);
-        DEBUG('x', "thread:%s\tExit(%d):\n", currentThread->getName(), ExitStatus);
-        currentThread->pcb->setExitStatus(ExitStatus);
-
-        List *terminatedList = scheduler->getTerminatedList();
-        if (currentThread->pcb->getExitStatus() == 99)
-        {
-            DEBUG('x', "thread:%s\tparent delete terminatedList:\n", currentThread->getName());
-            Thread *thread;
-            while ((thread = (Thread *)(terminatedList->Remove())) != NULL)
-                delete thread;
-        }
-
-        currentThread->Finish();
+        ExitProcess(machine->ReadRegister(4));
         AdvancePC();
     }
     else if ((which == SyscallException) && (type == SC_Yield))
@@ -147,15 +229,12 @@ void ExceptionHandler(ExceptionType which)
     else if ((which == SyscallException) && (type == SC_Create))
     {
         int base = machine->ReadRegister(4);
-        int value;
-        int count = 0;
-        char *FileName = new char[128];
-        do
+        char FileName[MaxPathLength];
+        if (currentThread->pcb->space->CopyStringFromUser(base, FileName, MaxPathLength) < 0)
         {
-            machine->ReadMem(base + count, 1, &value);
-            FileName[count] = *(char *)&value;
-            count++;
-        } while (*(char *)&value != '\0' && count < 128);
+            BadUserAddress("Create", base);
+            return;
+        }
         if (!fileSystem->CreateTest(FileName, 0))
         {
             printf("thread:%s\tcreate file:%s failed!\n", currentThread->getName(), FileName);
@@ -168,15 +247,12 @@ void ExceptionHandler(ExceptionType which)
     else if ((which == SyscallException) && (type == SC_Open))
     {
         int base = machine->ReadRegister(4);
-        int value;
-        int count = 0;
-        char *FileName = new char[128];
-        do
+        char FileName[MaxPathLength];
+        if (currentThread->pcb->space->CopyStringFromUser(base, FileName, MaxPathLength) < 0)
         {
-            machine->ReadMem(base + count, 1, &value);
-            FileName[count] = *(char *)&value;
-            count++;
-        } while (*(char *)&value != '\0' && count < 128);
+            BadUserAddress("Open", base);
+            return;
+        }
 
         OpenFile *openfile;
         openfile = fileSystem->OpenTest(FileName);
@@ -202,8 +278,6 @@ void ExceptionHandler(ExceptionType which)
         int size = machine->ReadRegister(5);
         //bytes written to file   
         int fileId = machine->ReadRegister(6); //fd   
-        int value;
-        int count = 0;
 
         if (fileId == 0)
         {
@@ -211,13 +285,18 @@ void ExceptionHandler(ExceptionType which)
             ASSERT(false);
         }
 
-        char *buffer = new char[128];
-        do
+        if (!currentThread->pcb->space->InSpace(base, size))
+        { // before "size" is used to allocate anything
+            BadUserAddress("Write", base);
+            return;
+        }
+        char *buffer = new char[size + 1];
+        if (!currentThread->pcb->space->CopyFromUser(base, buffer, size))
         {
-            machine->ReadMem(base + count, 1, &value);
-            buffer[count] = *(char *)&value;
-            count++;
-        } while (count < size);
+            delete[] buffer;
+            BadUserAddress("Write", base);
+            return;
+        }
         buffer[size] = '\0';
 
         if (fileId == 1)
@@ -231,8 +310,8 @@ void ExceptionHandler(ExceptionType which)
                 ASSERT(false);
             }
 
-            int res = openfile->Write(buffer, size);
-            openfile->WriteBack();
+            int res = openfile->Write(buffer, size); // the header goes back
+                                                     // on close, or Sync
             if (res != size)
             {
                 printf("thread:%s\tfileId:%d write failed!\n", currentThread->getName(), fileId);
@@ -241,6 +320,7 @@ void ExceptionHandler(ExceptionType which)
             else
                 DEBUG('x', "thread:%s\tfileId:%d write success\tlength:%d!\n", currentThread->getName(), fileId, size);
         }
+        delete[] buffer;
         AdvancePC();
     }
     else if ((which == SyscallException) && (type == SC_Read))
@@ -249,8 +329,6 @@ void ExceptionHandler(ExceptionType which)
         int size = machine->ReadRegister(5);
         //bytes written to file   
         int fileId = machine->ReadRegister(6); //fd   
-        int value;
-        int count = 0;
 
         if (fileId == 1)
         {
@@ -258,15 +336,17 @@ void ExceptionHandler(ExceptionType which)
             ASSERT(false);
         }
 
-        char *buffer = new char[128];
+        if (!currentThread->pcb->space->InSpace(base, size))
+        { // before "size" is used to allocate anything
+            BadUserAddress("Read", base);
+            return;
+        }
+        char *buffer = new char[size + 1];
 
         if (fileId == 0)
         {
             for (int i = 0; i < size; i++)
-            {
                 buffer[i] = getchar();
-                machine->WriteMem(base + i, 1, buffer[i]);
-            }
             buffer[size] = '\0';
             DEBUG('x', "thread:%s\tinput from stdin:%s\n", currentThread->getName(), buffer);
         }
@@ -288,10 +368,14 @@ void ExceptionHandler(ExceptionType which)
             }
             else
                 DEBUG('x', "thread:%s\tfileId:%d read success\tlength:%d!\tcontent:%s\n", currentThread->getName(), fileId, size, buffer);
-
-            for (int i = 0; i < size; i++)
-                machine->WriteMem(base + i, 1, buffer[i]);
         }
+        if (!currentThread->pcb->space->CopyToUser(base, buffer, size))
+        {
+            delete[] buffer;
+            BadUserAddress("Read", base);
+            return;
+        }
+        delete[] buffer;
         AdvancePC();
     }
     else if ((which == SyscallException) && (type == SC_Close))
@@ -0,0 +1,145 @@
+// frametable.cc
+//	Routines to manage physical page frames, and to choose the frame
+//	to take away when there is no free one.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize a table of "size" frames, all free.  Which frames are
+//	free is kept in the global "bitmap".
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(int size)
+{
+    numFrames = size;
+    frames = new Frame[numFrames];
+    for (int i = 0; i < numFrames; i++)
+    {
+        frames[i].space = NULL;
+        frames[i].vpn = 0;
+        frames[i].shared = NULL;
+    }
+    hand = 0;
+    lock = new Lock("frame table");
+}
+
+FrameTable::~FrameTable()
+{
+    delete[] frames;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Allocate
+// 	Find a frame for virtual page "vpn" of "space", or for the shared
+//	page "shared": a free one if there is any, else the frame of a
+//	page that has not been used lately, which is paged out first.  The
+//	caller fills the frame in.
+//
+// Returns:
+//	the frame, or -1 if no page could be paged out (the swap area is
+//	full).
+//----------------------------------------------------------------------
+
+int FrameTable::Allocate(AddrSpace *space, unsigned int vpn,
+                         SharedPage *shared)
+{
+    int frame;
+
+    if (((frame = bitmap->Find()) < 0) && ((frame = FindVictim()) < 0))
+        return -1;
+    frames[frame].space = (shared == NULL) ? space : NULL;
+    frames[frame].vpn = vpn;
+    frames[frame].shared = shared;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::SetOwner
+// 	The page in "frame" has changed hands: a shared page has become
+//	page "vpn" of "space" alone (its last user took it over rather
+//	than copy it), or a private page has become "shared" (by Fork).
+//----------------------------------------------------------------------
+
+void FrameTable::SetOwner(int frame, AddrSpace *space, unsigned int vpn,
+                          SharedPage *shared)
+{
+    frames[frame].space = (shared == NULL) ? space : NULL;
+    frames[frame].vpn = vpn;
+    frames[frame].shared = shared;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Free
+// 	The page in "frame" is gone (its address space is being deleted,
+//	or its last sharer is): the frame is free again.
+//----------------------------------------------------------------------
+
+void FrameTable::Free(int frame)
+{
+    frames[frame].space = NULL;
+    frames[frame].shared = NULL;
+    bitmap->Clear(frame);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindVictim
+// 	Sweep the clock hand over the frames.  A page that was used since
+//	the hand last passed it gets a second chance: its use bit is
+//	cleared, and the hand moves on.  The first page that was not is
+//	paged out, and its frame returned.  Two sweeps always find one.
+//	时钟算法：use位为1的页清零后跳过，遇到第一个use位为0的页即换出。
+//
+//	A shared page counts as used if any of its sharers used it, and
+//	is taken from all of them at once.
+//
+//	The use bits of the running program's pages are cleared too, so
+//	the machine's cached translations, which skip setting them, are
+//	flushed.
+//
+// Returns:
+//	the frame, or -1 if the chosen page could not be paged out.
+//----------------------------------------------------------------------
+
+int FrameTable::FindVictim()
+{
+    Frame *victim;
+    int frame;
+
+    machine->FlushHostTLB();
+    for (int i = 0; i < 2 * numFrames; i++)
+    {
+        frame = hand;
+        hand = (hand + 1) % numFrames;
+        victim = &frames[frame];
+        if (victim->shared != NULL)
+        {
+            if (pageCache->TestAndClearUse(victim->shared))
+                continue; // second chance
+            DEBUG('a', "Evicting shared page %d from frame %d\n",
+                  victim->vpn, frame);
+            if (!pageCache->Evict(victim->shared))
+                return -1;
+            victim->shared = NULL;
+            return frame;
+        }
+        if (victim->space == NULL)
+            continue; // being filled, by the fault we are serving
+        if (victim->space->TestAndClearUse(victim->vpn))
+            continue; // second chance
+        DEBUG('a', "Evicting virtual page %d of space %d from frame %d\n",
+              victim->vpn, victim->space->getSpaceId(), frame);
+        if (!victim->space->PageOut(victim->vpn))
+            return -1;
+        victim->space = NULL;
+        return frame;
+    }
+    return -1;
+}
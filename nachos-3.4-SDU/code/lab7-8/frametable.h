@@ -0,0 +1,72 @@
+// frametable.h
+//	Data structures for managing physical page frames.
+//
+//	The frame table is an inverted page table: for every frame, the
+//	address space and virtual page it holds.  So when memory is full,
+//	a victim is found by sweeping the frames themselves, with the
+//	clock (second chance) algorithm on the use bits Machine::Translate
+//	sets, and its owner's page table entry is found at once.  The
+//	victim is written to swap if it is dirty, and its frame handed to
+//	the faulting page. 倒排页表：记录每个物理页属于哪个地址空间的哪个虚页；
+//	内存满时用时钟（二次机会）算法选出牺牲页，脏页写回交换区。
+//
+//	A frame may also hold a page shared by several processes (see
+//	pagecache.h); it then belongs to the shared page, and is freed
+//	when the last of them stops using it.
+//
+//	Paging is done one fault at a time: the table's lock is held from
+//	the time a frame is looked for until the faulting page is in it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "synch.h"
+
+class AddrSpace;
+class SharedPage;
+
+// What one physical frame holds.
+class Frame
+{
+public:
+  AddrSpace *space;   // whose page, or NULL if the frame is free
+  unsigned int vpn;   // ...and which one
+  SharedPage *shared; // or, the shared page in it
+};
+
+class FrameTable
+{
+public:
+  FrameTable(int size);      // Initialize a table of free frames
+  ~FrameTable();
+
+  void Acquire() { lock->Acquire(); } // Serialize paging
+  void Release() { lock->Release(); }
+
+  int Allocate(AddrSpace *space, unsigned int vpn,
+               SharedPage *shared = NULL);
+  // A frame for page "vpn" of "space" (or for "shared", if not NULL):
+  // a free one, or one taken from another page; -1 if none can be
+  // freed.  With the lock held.
+  void SetOwner(int frame, AddrSpace *space, unsigned int vpn,
+                SharedPage *shared = NULL);
+  // The page in "frame" is now page "vpn" of "space" (or "shared"):
+  // it went from shared to private, or back.  With the lock held.
+  void Free(int frame); // The frame's page is gone.  With the lock held.
+
+private:
+  Frame *frames;
+  int numFrames;
+  int hand;   // the clock hand: the next frame to look at
+  Lock *lock; // held while a fault is being served
+
+  int FindVictim(); // sweep the clock until a frame's page has not
+                    // been used since the last sweep
+};
+
+#endif // FRAMETABLE_H
@@ -9,30 +9,45 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-s -bb -pt <trace file> -x <nachos file> -c <consoleIn> <consoleOut>
+//		-f -bc <cache sectors> -dp <disk policy> -dio <rw|mmap|async>
+//		-dg <tracks> <sectors per track>
+//		-cp <unix file> <nachos file>
+//		-p <nachos file> -r <nachos file> -l -D -t -db <n> -ds -dgt
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -eq
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
+//    -eq times the pending-interrupt queue against the old sorted list
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs with the basic-block (threaded code) engine
+//    -pt records the page references of user programs in a host file,
+//       to replay with bin/pagesim (it turns -bb off, so that every
+//       instruction fetch is seen)
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -bc sets the number of sectors in the disk buffer cache (0 = none)
+//    -dp sets the disk scheduling policy: fifo, sstf, scan or clook
+//    -dio sets how the DISK file is accessed: rw (system calls), mmap,
+//         or async (system calls made by a host thread)
+//    -dg sets the number of tracks, and of sectors on each, of a new DISK
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
 //    -t tests the performance of the Nachos file system
+//    -db times creating, looking up and removing n files in a directory
+//    -ds runs many threads' disk requests at once under each disk policy
+//    -dgt times seeks, reads and formatting on disks of growing size
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -61,10 +76,13 @@ extern void NAppend(char *nachosFileFrom, char *nachosFileTo);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
+extern void EventQueueBenchmark(void);
 
 extern void CopyTest(char *unixFile, char *nachosFile);
 extern void AppendTest(char *unixFile, char *nachosFile, int half);
 extern void NAppendTest(char *nachosFileFrom, char *nachosFileTo);
+extern void DirectoryBenchmark(int n), DiskStressTest(void);
+extern void DiskGeometryTest(void);
 
 //----------------------------------------------------------------------
 // main
@@ -97,6 +115,8 @@ int main(int argc, char **argv)
 		argCount = 1;
 		if (!strcmp(*argv, "-z")) // print copyright
 			printf(copyright);
+		if (!strcmp(*argv, "-eq")) // time the interrupt queue
+			EventQueueBenchmark();
 #ifdef USER_PROGRAM
 		if (!strcmp(*argv, "-x"))
 		{ // run a user program
@@ -169,6 +189,20 @@ int main(int argc, char **argv)
 		{ // performance test
 			PerformanceTest();
 		}
+		else if (!strcmp(*argv, "-db"))
+		{ // directory benchmark
+			ASSERT(argc > 1);
+			DirectoryBenchmark(atoi(*(argv + 1)));
+			argCount = 2;
+		}
+		else if (!strcmp(*argv, "-ds"))
+		{ // disk scheduler stress test
+			DiskStressTest();
+		}
+		else if (!strcmp(*argv, "-dgt"))
+		{ // disk geometry scaling test
+			DiskGeometryTest();
+		}
 		else if (!strcmp(*argv, "-mkdir"))
 		{ // copy from UNIX to Nachos
 			ASSERT(argc > 1);
@@ -251,6 +285,9 @@ int main(int argc, char **argv)
 		}
 #endif // NETWORK
 	}
+#ifdef FILESYS_CACHE
+	fileSystem->Sync(); // the machine may go idle before anyone else syncs
+#endif
 
 	currentThread->Finish(); // NOTE: if the procedure "main"
 							 // returns, then the program "nachos"
@@ -0,0 +1,190 @@
+// pagecache.cc
+//	Routines to share the pages of an executable between the processes
+//	running it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagecache.h"
+
+//----------------------------------------------------------------------
+// PageCache::PageCache
+// 	Initialize an empty cache.
+//----------------------------------------------------------------------
+
+PageCache::PageCache()
+{
+    for (int i = 0; i < PageCacheHashSize; i++)
+        hashTable[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageCache::~PageCache
+// 	De-allocate the cache.  Every page should be gone with its last
+//	user; any left over (a process still running at halt) is dropped.
+//----------------------------------------------------------------------
+
+PageCache::~PageCache()
+{
+    SharedPage *page;
+
+    for (int i = 0; i < PageCacheHashSize; i++)
+        while ((page = hashTable[i]) != NULL)
+        {
+            hashTable[i] = page->hashNext;
+            delete page->users;
+            delete page;
+        }
+}
+
+//----------------------------------------------------------------------
+// PageCache::Get
+// 	Return the shared copy of page "vpn" of "executable", with "space"
+//	added to its users.  A page no one is using yet is made here, not
+//	in memory: the caller reads it in.
+//----------------------------------------------------------------------
+
+SharedPage *
+PageCache::Get(OpenFile *executable, unsigned int vpn, AddrSpace *space)
+{
+    int sector = executable->getHdrSector();
+    Inode *inode = executable->getInode();
+    SharedPage *page;
+
+    for (page = hashTable[Hash(sector, vpn)]; page != NULL; page = page->hashNext)
+        if ((page->sector == sector) && (page->inode == inode) &&
+            (page->vpn == vpn))
+            break;
+    if (page == NULL)
+    {
+        page = new SharedPage;
+        page->sector = sector;
+        page->inode = inode;
+        page->vpn = vpn;
+        page->frame = -1;
+        page->swapSlot = -1;
+        page->users = new List;
+        page->hashNext = hashTable[Hash(sector, vpn)];
+        hashTable[Hash(sector, vpn)] = page;
+    }
+    page->users->Append((void *)space);
+    return page;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Share
+// 	Make private page "vpn" of "space" into an anonymous shared page,
+//	for Fork.  Its contents are in "frame", or in "swapSlot", or both
+//	(-1 if not); both now belong to the shared page.  It is chained
+//	like the others, so that it is dropped at halt, but never matches
+//	a lookup.
+//----------------------------------------------------------------------
+
+SharedPage *
+PageCache::Share(AddrSpace *space, unsigned int vpn, int frame, int swapSlot)
+{
+    SharedPage *page = new SharedPage;
+
+    page->sector = -1;
+    page->inode = NULL;
+    page->vpn = vpn;
+    page->frame = frame;
+    page->swapSlot = swapSlot;
+    page->users = new List;
+    page->users->Append((void *)space);
+    page->hashNext = hashTable[Hash(-1, vpn)];
+    hashTable[Hash(-1, vpn)] = page;
+    if (frame >= 0)
+        frameTable->SetOwner(frame, NULL, vpn, page);
+    return page;
+}
+
+//----------------------------------------------------------------------
+// PageCache::AddUser
+// 	"space" uses "page" too: it was forked from one of its users.
+//----------------------------------------------------------------------
+
+void PageCache::AddUser(SharedPage *page, AddrSpace *space)
+{
+    page->users->Append((void *)space);
+}
+
+//----------------------------------------------------------------------
+// PageCache::Put
+// 	"space" no longer uses "page" (it exited, or has its own copy
+//	now).  When the last user goes, the frame (and swap slot) are
+//	free again, and the page leaves the cache: the inode may not
+//	outlive it.
+//----------------------------------------------------------------------
+
+void PageCache::Put(SharedPage *page, AddrSpace *space)
+{
+    SharedPage **link;
+
+    page->users->RemoveByItem((void *)space);
+    if (!page->users->IsEmpty())
+        return;
+    if (page->frame >= 0)
+        frameTable->Free(page->frame);
+    if (page->swapSlot >= 0)
+        swapArea->Free(page->swapSlot);
+    for (link = &hashTable[Hash(page->sector, page->vpn)]; *link != page;
+         link = &(*link)->hashNext)
+        ;
+    *link = page->hashNext;
+    delete page->users;
+    delete page;
+}
+
+//----------------------------------------------------------------------
+// PageCache::TestAndClearUse
+// 	Return whether any user of "page" touched it since the clock hand
+//	last passed, clearing the use bits of all of them.
+//----------------------------------------------------------------------
+
+bool PageCache::TestAndClearUse(SharedPage *page)
+{
+    bool used = FALSE;
+
+    for (int i = 0; i < page->users->ListLength(); i++)
+        if (((AddrSpace *)page->users->getItem(i))->TestAndClearUse(page->vpn))
+            used = TRUE;
+    return used;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Evict
+// 	Take "page" out of memory, for the frame table.  It is never dirty
+//	-- writers get a copy of their own -- so the users that have it
+//	mapped just fault it in again: from the file, or, for an anonymous
+//	page, from its swap slot.  That is written the first time round
+//	only; the page cannot change after.
+//
+// Returns:
+//	FALSE, leaving the page in memory, if it needs a swap slot and
+//	none can be had (or written).
+//----------------------------------------------------------------------
+
+bool PageCache::Evict(SharedPage *page)
+{
+    if ((page->sector < 0) && (page->swapSlot < 0))
+    {
+        if ((page->swapSlot = swapArea->Allocate()) < 0)
+            return FALSE;
+        if (!swapArea->Write(page->swapSlot,
+                             &machine->mainMemory[page->frame * PageSize]))
+        {
+            swapArea->Free(page->swapSlot);
+            page->swapSlot = -1;
+            return FALSE;
+        }
+        stats->numSwapOuts++;
+    }
+    for (int i = 0; i < page->users->ListLength(); i++)
+        ((AddrSpace *)page->users->getItem(i))->Unmap(page->vpn, page->frame);
+    page->frame = -1;
+    return TRUE;
+}
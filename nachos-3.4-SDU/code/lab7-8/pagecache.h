@@ -0,0 +1,92 @@
+// pagecache.h
+//	Data structures for sharing the pages of an executable between the
+//	processes running it.
+//
+//	A page of a program that holds code or initialized data starts
+//	out the same in every process running the program.  So rather
+//	than each of them reading its own copy, the first to touch it
+//	reads it into a frame, and the others map that frame too, all
+//	read-only.  A process that writes the page gets a copy of its own
+//	(copy-on-write).  The frame is freed when the last process stops
+//	using the page. 同一程序的多个进程共享代码和已初始化数据页：只读映射，
+//	写时复制；最后一个使用者退出时释放物理页。
+//
+//	Pages are found by the header sector of the executable, and the
+//	page number.  The inode is checked as well: a file removed while
+//	running may see its header sector given to a new program.
+//
+//	After a Fork, parent and child share the rest of their pages the
+//	same way.  Such a page is anonymous: it is not found by lookup,
+//	and its contents, if taken out of memory, go to a swap slot of
+//	its own rather than back to the file. Fork后父子进程以同样方式共享
+//	其余页（匿名共享页，换出时写入自己的交换槽）。
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include "copyright.h"
+#include "list.h"
+
+class AddrSpace;
+class OpenFile;
+class Inode;
+
+#define PageCacheHashSize 256 // chains in the cache; a power of two
+
+// One shared page of an executable.
+class SharedPage
+{
+public:
+  int sector;           // the executable's header sector, or -1
+                        // if the page is anonymous
+  Inode *inode;         // ...and its inode
+  unsigned int vpn;     // which page of it
+  int frame;            // where it is in memory, or -1 if it is not
+  int swapSlot;         // where it is in swap (anonymous pages), or
+                        // -1 if it has not been written there
+  List *users;          // the spaces that share it (mapped in or not)
+  SharedPage *hashNext; // next page on the same hash chain
+};
+
+class PageCache
+{
+public:
+  PageCache();  // Initialize an empty cache
+  ~PageCache();
+
+  // All of these with the frame table locked.
+  SharedPage *Get(OpenFile *executable, unsigned int vpn, AddrSpace *space);
+  // The shared copy of page "vpn" of "executable", which "space" is
+  // now a user of; made (not in memory yet) if there is none
+  SharedPage *Share(AddrSpace *space, unsigned int vpn, int frame,
+                    int swapSlot);
+  // An anonymous page, made from private page "vpn" of "space" (in
+  // "frame" and/or "swapSlot"), which is its first user
+  void AddUser(SharedPage *page, AddrSpace *space); // Another one
+  void Put(SharedPage *page, AddrSpace *space);
+  // "space" stops using "page"; after the last user, its frame is
+  // freed and it is forgotten
+  int NumUsers(SharedPage *page) { return page->users->ListLength(); }
+
+  bool TestAndClearUse(SharedPage *page); // Was the page used by
+                                          // anyone lately?  For the
+                                          // clock algorithm
+  bool Evict(SharedPage *page); // Unmap it from every user, and give
+                                // up its frame; it is read in again
+                                // on the next fault.  FALSE if it is
+                                // anonymous and swap is full
+
+private:
+  SharedPage *hashTable[PageCacheHashSize];
+
+  int Hash(int sector, unsigned int vpn)
+  {
+    return (sector * 31 + vpn) & (PageCacheHashSize - 1);
+  }
+};
+
+#endif // PAGECACHE_H
@@ -2,6 +2,7 @@
 
 Pcb::Pcb()
 {
+    space = NULL; // a kernel thread, until given a user program
     for (int i = 0; i < MaxFileId; i++)
         fileIdUse[i] = false;
 }
@@ -62,6 +63,18 @@ OpenFile *Pcb::getFile(int fileId)
         return NULL;
 }
 
+// Give this (new) process the files "parent" has open, under the same
+// ids and at the same positions.  Each gets an OpenFile of its own, so
+// the positions move independently from then on.
+void Pcb::copyFiles(Pcb *parent)
+{
+    for (int i = 0; i < MaxFileId; i++)
+    {
+        fileIdUse[i] = parent->fileIdUse[i];
+        files[i] = fileIdUse[i] ? parent->files[i]->Duplicate() : NULL;
+    }
+}
+
 void Pcb::releaseFile(int fileId)
 {
     if (fileIdUse[fileId])
@@ -31,6 +31,8 @@ public:
 
     void releaseFile(int fileId);
 
+    void copyFiles(Pcb *parent); // open what "parent" has open, for Fork
+
 private:
     int exitStatus;
 
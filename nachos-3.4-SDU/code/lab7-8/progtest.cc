@@ -32,9 +32,8 @@ void StartProcess(char *filename)
     }
     space = new AddrSpace(executable);
     currentThread->pcb->space = space;
-    space->Print();
-
-    delete executable; // close file
+    space->Print(); // the space keeps "executable" open, and
+                    // closes it when the program exits
 
     space->InitRegisters(); // set the initial register values
     space->RestoreState();  // load page table register
@@ -61,6 +60,23 @@ void StartProcess(int spaceId)
                     // the address space exits
                     // by doing the syscall "exit"s
 }
+//----------------------------------------------------------------------
+// StartForkedProcess
+// 	Run the child of a Fork system call.  Its address space and user
+//	registers were copied from the parent; just load them, and go on
+//	from where the parent called Fork.
+//----------------------------------------------------------------------
+
+void StartForkedProcess(int spaceId)
+{
+    ASSERT(currentThread->pcb->space == addrspaces[spaceId]);
+    currentThread->RestoreUserState(); // as the parent left them
+    currentThread->pcb->space->RestoreState(); // load page table register
+
+    machine->Run(); // back to user mode, returning 0 from Fork
+    ASSERT(FALSE);
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
@@ -28,6 +28,8 @@ public:
                                    // list, if any, and return thread.
   void Run(Thread *nextThread);    // Cause nextThread to start running
   void Print();                    // Print contents of ready list
+  bool ReadyListEmpty() { return readyList->IsEmpty(); }
+  // Is no other thread ready to run?
 
 private:
   List *readyList; // queue of threads that are ready to run,
@@ -0,0 +1,95 @@
+// swap.cc
+//	Routines to manage the swap area.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swap.h"
+
+//----------------------------------------------------------------------
+// SwapArea::SwapArea
+// 	Initialize an empty swap area.  The file is not touched until a
+//	page is first written out, so a run that never pages out leaves
+//	the disk alone.
+//----------------------------------------------------------------------
+
+SwapArea::SwapArea()
+{
+    file = NULL;
+    slots = new BitMap(NumSwapPages);
+}
+
+//----------------------------------------------------------------------
+// SwapArea::~SwapArea
+// 	Close the swap file.  It stays on disk, and is started afresh by
+//	the next run that pages out.
+//----------------------------------------------------------------------
+
+SwapArea::~SwapArea()
+{
+    if (file != NULL)
+        delete file;
+    delete slots;
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Allocate
+// 	Return a free slot, or -1 if the swap area is full.  The lowest
+//	free slot is taken, so the file only grows when every slot in it
+//	is in use.
+//----------------------------------------------------------------------
+
+int SwapArea::Allocate()
+{
+    return slots->Find();
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Free
+// 	The page in "slot" is no longer needed.
+//----------------------------------------------------------------------
+
+void SwapArea::Free(int slot)
+{
+    slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Read
+// 	Read the page saved in "slot" into "page".
+//----------------------------------------------------------------------
+
+bool SwapArea::Read(int slot, char *page)
+{
+    ASSERT((file != NULL) && slots->Test(slot));
+    return file->ReadAt(page, PageSize, slot * PageSize) == PageSize;
+}
+
+//----------------------------------------------------------------------
+// SwapArea::Write
+// 	Save "page" in "slot", creating the swap file the first time
+//	round (any SWAP left by an earlier run is thrown away).
+//
+// Returns:
+//	FALSE if the file could not be created, or grown to hold the
+//	slot: the disk is full.
+//----------------------------------------------------------------------
+
+bool SwapArea::Write(int slot, char *page)
+{
+    static char name[] = SwapFileName;
+
+    ASSERT(slots->Test(slot));
+    if (file == NULL)
+    {
+        fileSystem->Remove(name);
+        if (!fileSystem->Create(name, 0) ||
+            ((file = fileSystem->Open(name)) == NULL))
+            return FALSE;
+        DEBUG('a', "Swap file %s created\n", name);
+    }
+    return file->WriteAt(page, PageSize, slot * PageSize) == PageSize;
+}
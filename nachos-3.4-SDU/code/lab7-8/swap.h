@@ -0,0 +1,44 @@
+// swap.h
+//	Data structures for the swap area, where pages of user programs
+//	are kept while their frames are lent to someone else.
+//
+//	The swap area is a Nachos file, SWAP, in the root directory,
+//	divided into page-sized slots.  A page is given a slot the first
+//	time it is written out dirty, and keeps it until its address space
+//	is deleted.  The file is created (afresh) the first time a page is
+//	written out, and grows a slot at a time as they are first used. 交换区：
+//	根目录下的Nachos文件SWAP，按页划分为槽；首次换出脏页时创建，按需增长。
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAP_H
+#define SWAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "filesys.h"
+
+#define SwapFileName "SWAP"
+#define NumSwapPages 1024 // slots; the disk usually runs out first
+
+class SwapArea
+{
+public:
+  SwapArea();  // Initialize an empty swap area
+  ~SwapArea(); // Close the swap file
+
+  int Allocate();        // A free slot, or -1 if there is none
+  void Free(int slot);   // The slot's page is not needed any more
+
+  bool Read(int slot, char *page);  // Read the page in "slot"
+  bool Write(int slot, char *page); // Write "page" to "slot"; FALSE
+                                    // if the disk is full
+
+private:
+  OpenFile *file; // the swap file; NULL until first written
+  BitMap *slots;  // which slots are in use
+};
+
+#endif // SWAP_H
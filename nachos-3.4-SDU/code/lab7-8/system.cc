@@ -25,11 +25,16 @@ FileSystem *fileSystem;
 
 #ifdef FILESYS
 SynchDisk *synchDisk;
+InodeTable *inodeTable;
+Journal *journal;
 #endif
 
 #ifdef USER_PROGRAM // requires either FILESYS or FILESYS_STUB
 Machine *machine;   // user program memory and registers
 BitMap *bitmap;
+FrameTable *frameTable;
+SwapArea *swapArea;
+PageCache *pageCache;
 bool ThreadMap[MAX_USERPROCESSES];
 AddrSpace *addrspaces[MAX_USERPROCESSES];
 
@@ -84,10 +89,19 @@ void Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE; // single step user program
+    bool blockEngine = FALSE;   // run user code a basic block at a time
+    char *pageTraceFile = NULL; // record page references here
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE; // format disk
 #endif
+#ifdef FILESYS
+    int cacheSectors = DefaultCacheSectors; // size of the buffer cache
+    int diskPolicy = DefaultDiskPolicy;     // disk request scheduling
+    int diskBackend = DefaultDiskBackend;   // how the DISK file is accessed
+    int diskTracks = DefaultNumTracks;      // geometry of a new DISK
+    int diskTrackSize = DefaultSectorsPerTrack;
+#endif
 #ifdef NETWORK
     double rely = 1;  // network reliability
     double order = 1; // network orderability
@@ -118,11 +132,48 @@ void Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = TRUE;
+        else if (!strcmp(*argv, "-bb"))
+            blockEngine = TRUE;
+        else if (!strcmp(*argv, "-pt"))
+        {
+            ASSERT(argc > 1);
+            pageTraceFile = *(argv + 1);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = TRUE;
 #endif
+#ifdef FILESYS
+        if (!strcmp(*argv, "-bc"))
+        {
+            ASSERT(argc > 1);
+            cacheSectors = atoi(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dp"))
+        {
+            ASSERT(argc > 1);
+            diskPolicy = SynchDisk::PolicyByName(*(argv + 1));
+            ASSERT(diskPolicy != -1); // fifo, sstf, scan or clook
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dio"))
+        {
+            ASSERT(argc > 1);
+            diskBackend = Disk::BackendByName(*(argv + 1));
+            ASSERT(diskBackend != -1); // rw, mmap or async
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dg"))
+        {
+            ASSERT(argc > 2);
+            diskTracks = atoi(*(argv + 1));
+            diskTrackSize = atoi(*(argv + 2));
+            argCount = 3;
+        }
+#endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-n"))
         {
@@ -164,12 +215,22 @@ void Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup); // if user hits ctl-C
 
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg); // this must come first
+    machine = new Machine(debugUserProg, blockEngine, pageTraceFile); // this must come first
     bitmap = new BitMap(NumPhysPages);
+    frameTable = new FrameTable(NumPhysPages);
+    swapArea = new SwapArea(); // the swap file is made on first use
+    pageCache = new PageCache();
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", cacheSectors, (DiskPolicy)diskPolicy,
+                              (DiskBackend)diskBackend, diskTracks,
+                              diskTrackSize);
+    diskNumTracks = synchDisk->Tracks(); // an existing DISK keeps its own
+    diskSectorsPerTrack = synchDisk->TrackSize();
+    journal = new Journal(synchDisk); // on once the disk is mounted
+    synchDisk->SetJournal(journal);
+    inodeTable = new InodeTable();
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -209,6 +270,9 @@ void Cleanup()
 #ifdef USER_PROGRAM
     delete machine;
     delete bitmap;
+    delete pageCache;
+    delete frameTable;
+    delete swapArea; // before the file system goes
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -216,6 +280,9 @@ void Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete inodeTable;
+    synchDisk->SetJournal(NULL);
+    delete journal;
     delete synchDisk;
 #endif
 
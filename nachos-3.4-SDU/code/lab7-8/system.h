@@ -17,6 +17,9 @@
 #include "timer.h"
 #include "bitmap.h"
 #include "pcb.h"
+#include "frametable.h"
+#include "swap.h"
+#include "pagecache.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -35,7 +38,10 @@ extern Timer *timer;				// the hardware alarm clock
 #include "machine.h"
 #define MAX_USERPROCESSES 128
 extern Machine* machine;	// user program memory and registers
-extern BitMap* bitmap;
+extern BitMap* bitmap;			// free physical frames
+extern FrameTable *frameTable;		// who is in each frame
+extern SwapArea *swapArea;		// where evicted pages go
+extern PageCache *pageCache;		// executable pages shared by processes
 extern bool ThreadMap[128];
 extern AddrSpace *addrspaces[128];
 
@@ -48,7 +54,11 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "inode.h"
+#include "journal.h"
 extern SynchDisk   *synchDisk;
+extern InodeTable  *inodeTable;		// headers of the open files
+extern Journal     *journal;		// metadata write-ahead log
 #endif
 
 #ifdef NETWORK
@@ -153,6 +153,13 @@ void Thread::Finish()
     ASSERT(this == currentThread);
 
 #ifdef USER_PROGRAM
+    if (pcb->space == NULL)
+    { // a kernel thread (e.g. read-ahead): nobody joins it
+        DEBUG('t', "Finishing thread \"%s\"\n", getName());
+        threadToBeDestroyed = currentThread;
+        Sleep(); // not reached
+    }
+
     //joinee finised, wakeup the join user program
     List *waitingList = scheduler->getWaitingList();
     Thread *waitingThread;
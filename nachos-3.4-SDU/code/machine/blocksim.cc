@@ -0,0 +1,462 @@
+// blocksim.cc -- basic-block ("threaded code") engine for the MIPS simulator
+//
+//   An alternative to the fetch/decode/switch loop of OneInstruction.
+//   Straight-line runs of user code (up to and including a branch and
+//   its delay slot) are translated once into a TranslatedBlock: an array
+//   of (handler address, decoded instruction) pairs.  A block is then
+//   run with direct-threaded dispatch -- each handler jumps straight to
+//   the handler of the next instruction through a computed goto --
+//   and we only go back to Run() when the block is done, or when the
+//   next interrupt is due. 基本块引擎：把直线代码翻译成处理程序指针链，用computed goto直接派发。
+//
+//   Blocks never cross a physical page, and are cached by the physical
+//   address of their first instruction.  They are thrown away together
+//   with the predecoded copy of their page (see InvalidateDecodedPage).
+//
+//   Selected with the "-bb" flag; the classic interpreter is still used
+//   when single-stepping or tracing instructions (-s, -d m).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "system.h"
+
+// One translated instruction: where to jump to execute it, and its
+// decoded form. 一条已翻译的指令：处理程序地址和解码后的指令。
+struct BlockOp
+{
+	void *handler;
+	Instruction instr;
+};
+
+// A straight-line run of instructions within one physical page.
+class TranslatedBlock
+{
+public:
+	int frame;				   // physical page holding the block
+	int length;				   // number of instructions in ops[]
+	TranslatedBlock *next;	   // link on the retired list
+	BlockOp ops[NumInstrPerPage];
+};
+
+// Handler address for each opcode, filled in by RunBlock(NULL) -- the
+// labels are only visible inside RunBlock.
+static void *dispatchTable[MaxOpcode + 1];
+static bool dispatchReady = FALSE;
+
+//----------------------------------------------------------------------
+// IsBranch
+// 	Does "opCode" transfer control (and so have a delay slot)?
+//----------------------------------------------------------------------
+
+static bool
+IsBranch(int opCode)
+{
+	switch (opCode)
+	{
+	case OP_BEQ:
+	case OP_BNE:
+	case OP_BGEZ:
+	case OP_BGEZAL:
+	case OP_BGTZ:
+	case OP_BLEZ:
+	case OP_BLTZ:
+	case OP_BLTZAL:
+	case OP_J:
+	case OP_JAL:
+	case OP_JALR:
+	case OP_JR:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::OneBlock
+// 	Execute the basic block starting at the current PC, translating
+//	it first if we have not seen it before, but no more than "budget"
+//	of its instructions (Run() stops at the next interrupt deadline).
+//	The block engine's counterpart of OneInstruction.
+//
+//	Returns the number of instructions executed, including one that
+//	trapped into the kernel.
+//
+//	If we are sitting in a branch delay slot (NextPC is not PC + 4),
+//	the straight-line assumption does not hold, so fall back to a single
+//	OneInstruction step. 若处于分支延迟槽中，退回到单条指令执行。
+//----------------------------------------------------------------------
+
+int Machine::OneBlock(Instruction *instr, int budget)
+{
+	ExceptionType exception;
+	int physAddr;
+	TranslatedBlock *block;
+
+	DeleteRetiredBlocks();
+	if (registers[NextPCReg] != registers[PCReg] + 4)
+	{
+		OneInstruction(instr);
+		return 1;
+	}
+	exception = CachedTranslate(registers[PCReg], &physAddr, 4, FALSE);
+	if (exception != NoException)
+	{
+		RaiseException(exception, registers[PCReg]);
+		return 1;
+	}
+	block = blockMap[physAddr / 4];
+	if (block == NULL)
+		block = TranslateBlock(physAddr);
+	return RunBlock(block, budget);
+}
+
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Build the block starting at physical address "physAddr".  The block
+//	ends after the delay slot of the first branch, at a syscall or
+//	reserved instruction (they always trap), or at the end of the page.
+//	A branch in the last word of a page ends its block without its
+//	delay slot; OneBlock then steps through the slot on its own.
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+Machine::TranslateBlock(int physAddr)
+{
+	int frame = physAddr / PageSize;
+	int first = physAddr / 4;
+	int last = (frame + 1) * NumInstrPerPage; // one past the page's end
+	TranslatedBlock *block = new TranslatedBlock;
+	Instruction *instr;
+
+	if (!dispatchReady)
+		RunBlock(NULL, 0);
+	if (!decodedValid[frame])
+		DecodePage(frame);
+
+	block->frame = frame;
+	block->length = 0;
+	block->next = NULL;
+	for (int i = first; i < last; i++)
+	{
+		instr = &decodedPages[i];
+		ASSERT(instr->opCode <= MaxOpcode);
+		block->ops[block->length].handler = dispatchTable[(int)instr->opCode];
+		block->ops[block->length].instr = *instr;
+		block->length++;
+		if ((instr->opCode == OP_SYSCALL) || (instr->opCode == OP_RES) ||
+			(instr->opCode == OP_UNIMP))
+			break;
+		if (IsBranch(instr->opCode))
+		{
+			if (i + 1 < last)
+			{ // take the delay slot along
+				instr = &decodedPages[i + 1];
+				block->ops[block->length].handler =
+					dispatchTable[(int)instr->opCode];
+				block->ops[block->length].instr = *instr;
+				block->length++;
+			}
+			break;
+		}
+	}
+	DEBUG('a', "Translated block at phys 0x%x, %d instructions\n",
+		  physAddr, block->length);
+	blockMap[first] = block;
+	return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeBlocks
+// 	Forget every block translated from physical page "frame".  The
+//	blocks are not deleted right away -- one of them may be the block
+//	that is running right now (a store into its own page) -- but put
+//	on a retired list, emptied by OneBlock before the next block starts.
+//----------------------------------------------------------------------
+
+void Machine::FreeBlocks(int frame)
+{
+	for (int i = frame * NumInstrPerPage; i < (frame + 1) * NumInstrPerPage; i++)
+		if (blockMap[i] != NULL)
+		{
+			blockMap[i]->next = retiredBlocks;
+			retiredBlocks = blockMap[i];
+			blockMap[i] = NULL;
+		}
+}
+
+//----------------------------------------------------------------------
+// Machine::DeleteRetiredBlocks
+// 	De-allocate the blocks put aside by FreeBlocks.
+//----------------------------------------------------------------------
+
+void Machine::DeleteRetiredBlocks()
+{
+	TranslatedBlock *block;
+
+	while (retiredBlocks != NULL)
+	{
+		block = retiredBlocks;
+		retiredBlocks = block->next;
+		delete block;
+	}
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute "block", or its first "budget" instructions if it is
+//	longer, with direct-threaded dispatch.  Hot, simple
+//	instructions have their own handler here; everything else goes
+//	through ExecuteInstruction, so the two engines compute exactly the
+//	same results.
+//
+//	Time: every instruction but the last one run is charged one
+//	UserTick as it completes.  The last one -- the end of the block,
+//	or the instruction that trapped into the kernel -- is left for
+//	Run() to charge, just as for OneInstruction.  So the kernel always
+//	sees the same totalTicks at a trap as with the classic interpreter,
+//	and with Run()'s budget interrupts fire at the same times too. 除最后一条外每条指令完成时计一个UserTick，最后一条由Run()计时。
+//
+//	We return as soon as anything traps into the kernel, without
+//	touching "block" again: the kernel may have switched threads and
+//	retired the block in the meantime.
+//
+//	Returns the number of instructions executed.  Called with "block"
+//	== NULL just to fill in dispatchTable.
+//----------------------------------------------------------------------
+
+// Finish the current instruction: do the delayed load, advance the PCs.
+#define RETIRE(loadReg, loadValue, after)          \
+	do                                             \
+	{                                              \
+		int pcAfter = (after);                     \
+		DelayedLoad(loadReg, loadValue);           \
+		registers[PrevPCReg] = registers[PCReg];   \
+		registers[PCReg] = registers[NextPCReg];   \
+		registers[NextPCReg] = pcAfter;            \
+	} while (0)
+
+// Stop, reporting how many instructions ran (the current one included).
+#define DONE() return (op - start) + 1
+
+// Go on to the next instruction of the block, if there is one.
+#define NEXT()                                     \
+	do                                             \
+	{                                              \
+		if (++op == end)                           \
+			return op - start;                     \
+		stats->totalTicks += UserTick;             \
+		stats->userTicks += UserTick;              \
+		instr = &op->instr;                        \
+		goto *op->handler;                         \
+	} while (0)
+
+int Machine::RunBlock(TranslatedBlock *block, int budget)
+{
+	BlockOp *start, *op, *end;
+	Instruction *instr;
+	int tmp, value;
+	unsigned int rs, rt;
+
+	if (block == NULL)
+	{
+		for (int i = 0; i <= MaxOpcode; i++)
+			dispatchTable[i] = &&op_generic;
+		dispatchTable[OP_ADDIU] = &&op_addiu;
+		dispatchTable[OP_ADDU] = &&op_addu;
+		dispatchTable[OP_SUBU] = &&op_subu;
+		dispatchTable[OP_AND] = &&op_and;
+		dispatchTable[OP_ANDI] = &&op_andi;
+		dispatchTable[OP_ORI] = &&op_ori;
+		dispatchTable[OP_XOR] = &&op_xor;
+		dispatchTable[OP_XORI] = &&op_xori;
+		dispatchTable[OP_NOR] = &&op_nor;
+		dispatchTable[OP_LUI] = &&op_lui;
+		dispatchTable[OP_SLL] = &&op_sll;
+		dispatchTable[OP_SRA] = &&op_sra;
+		dispatchTable[OP_SRL] = &&op_sra; // SRL is simulated as SRA,
+										  // see mipssim.cc
+		dispatchTable[OP_SLT] = &&op_slt;
+		dispatchTable[OP_SLTI] = &&op_slti;
+		dispatchTable[OP_SLTU] = &&op_sltu;
+		dispatchTable[OP_SLTIU] = &&op_sltiu;
+		dispatchTable[OP_MFHI] = &&op_mfhi;
+		dispatchTable[OP_MFLO] = &&op_mflo;
+		dispatchTable[OP_LW] = &&op_lw;
+		dispatchTable[OP_SW] = &&op_sw;
+		dispatchTable[OP_BEQ] = &&op_beq;
+		dispatchTable[OP_BNE] = &&op_bne;
+		dispatchTable[OP_BLEZ] = &&op_blez;
+		dispatchTable[OP_BGTZ] = &&op_bgtz;
+		dispatchTable[OP_J] = &&op_j;
+		dispatchTable[OP_JAL] = &&op_jal;
+		dispatchTable[OP_JR] = &&op_jr;
+		dispatchReady = TRUE;
+		return 0;
+	}
+
+	start = op = block->ops;
+	end = start + min(block->length, budget);
+	instr = &op->instr;
+	goto *op->handler;
+
+op_generic:
+	if (!ExecuteInstruction(instr))
+		DONE(); // trapped
+	if (!decodedValid[block->frame])
+		DONE(); // a store changed this very page
+	NEXT();
+
+op_addiu:
+	registers[(int)instr->rt] = registers[(int)instr->rs] + instr->extra;
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_addu:
+	registers[(int)instr->rd] = registers[(int)instr->rs] + registers[(int)instr->rt];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_subu:
+	registers[(int)instr->rd] = registers[(int)instr->rs] - registers[(int)instr->rt];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_and:
+	registers[(int)instr->rd] = registers[(int)instr->rs] & registers[(int)instr->rt];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_andi:
+	registers[(int)instr->rt] = registers[(int)instr->rs] & (instr->extra & 0xffff);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_ori:
+	registers[(int)instr->rt] = registers[(int)instr->rs] | (instr->extra & 0xffff);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_xor:
+	registers[(int)instr->rd] = registers[(int)instr->rs] ^ registers[(int)instr->rt];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_xori:
+	registers[(int)instr->rt] = registers[(int)instr->rs] ^ (instr->extra & 0xffff);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_nor:
+	registers[(int)instr->rd] = ~(registers[(int)instr->rs] | registers[(int)instr->rt]);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_lui:
+	registers[(int)instr->rt] = instr->extra << 16;
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_sll:
+	registers[(int)instr->rd] = registers[(int)instr->rt] << instr->extra;
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_sra:
+	registers[(int)instr->rd] = registers[(int)instr->rt] >> instr->extra;
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_slt:
+	registers[(int)instr->rd] = (registers[(int)instr->rs] < registers[(int)instr->rt]);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_slti:
+	registers[(int)instr->rt] = (registers[(int)instr->rs] < instr->extra);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_sltu:
+	rs = registers[(int)instr->rs];
+	rt = registers[(int)instr->rt];
+	registers[(int)instr->rd] = (rs < rt);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_sltiu:
+	rs = registers[(int)instr->rs];
+	rt = instr->extra;
+	registers[(int)instr->rt] = (rs < rt);
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_mfhi:
+	registers[(int)instr->rd] = registers[HiReg];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_mflo:
+	registers[(int)instr->rd] = registers[LoReg];
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_lw:
+	tmp = registers[(int)instr->rs] + instr->extra;
+	if (!ReadMem(tmp, 4, &value))
+		DONE(); // trapped (ReadMem also catches misalignment)
+	RETIRE(instr->rt, value, registers[NextPCReg] + 4);
+	NEXT();
+
+op_sw:
+	if (!WriteMem((unsigned)(registers[(int)instr->rs] + instr->extra), 4,
+				  registers[(int)instr->rt]))
+		DONE();
+	RETIRE(0, 0, registers[NextPCReg] + 4);
+	if (!decodedValid[block->frame])
+		DONE();
+	NEXT();
+
+op_beq:
+	if (registers[(int)instr->rs] == registers[(int)instr->rt])
+		RETIRE(0, 0, registers[NextPCReg] + IndexToAddr(instr->extra));
+	else
+		RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_bne:
+	if (registers[(int)instr->rs] != registers[(int)instr->rt])
+		RETIRE(0, 0, registers[NextPCReg] + IndexToAddr(instr->extra));
+	else
+		RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_blez:
+	if (registers[(int)instr->rs] <= 0)
+		RETIRE(0, 0, registers[NextPCReg] + IndexToAddr(instr->extra));
+	else
+		RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_bgtz:
+	if (registers[(int)instr->rs] > 0)
+		RETIRE(0, 0, registers[NextPCReg] + IndexToAddr(instr->extra));
+	else
+		RETIRE(0, 0, registers[NextPCReg] + 4);
+	NEXT();
+
+op_jal:
+	registers[R31] = registers[NextPCReg] + 4;
+op_j:
+	RETIRE(0, 0, ((registers[NextPCReg] + 4) & 0xf0000000) | IndexToAddr(instr->extra));
+	NEXT();
+
+op_jr:
+	RETIRE(0, 0, registers[(int)instr->rs]);
+	NEXT();
+}
@@ -7,6 +7,23 @@
 //	Disk operations are asynchronous, so we have to invoke an interrupt
 //	handler when the simulated operation completes.磁盘操作是异步的，因此我们必须在模拟操作完成时调用中断处理程序。
 //
+//	The UNIX file is either read and written with system calls, or
+//	mapped into memory as a whole, in which case a request is just a
+//	memory copy, and the changes reach the file when the disk is
+//	flushed or deleted.  Only the cost on the host differs.
+//
+//	Or the system calls are made by a host thread, so that they
+//	overlap with the simulation: a request is handed over through one
+//	HostRing, and comes back through another, where the interrupt
+//	handler picks it up.  The interrupt still happens at the simulated
+//	time computed when the request was made (waiting for the host
+//	thread if need be), so runs stay deterministic. 宿主机I/O线程异步执行读写，
+//	中断仍在原定的模拟时间发生，结果保持确定。
+//
+//	A disk of the default geometry has just the magic number in front
+//	of its sectors, as it always had; any other has a different magic
+//	number, followed by its number of tracks and sectors per track.
+//
 //  DO NOT CHANGE -- part of the machine emulation 不更改--机器仿真的一部分
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -20,13 +37,18 @@
 // We put this at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file
 // as a disk (which would probably trash the file's contents).我们将这个放在表示磁盘的UNIX文件的前面，这样就不太可能意外地将有用的文件当作磁盘（这可能会破坏文件的内容）。
-#define MagicNumber 0x456789ab
+#define MagicNumber 0x456789ab   // a disk of the default geometry
+#define GeometryMagic 0x456789ac // any other
 #define MagicSize sizeof(int)
+#define GeometrySize (3 * sizeof(int)) // GeometryMagic, tracks, sectors
+                                       // per track
 
-#define DiskSize (MagicSize + (NumSectors * SectorSize))
+int diskSectorsPerTrack = DefaultSectorsPerTrack;
+int diskNumTracks = DefaultNumTracks;
 
 // dummy procedure because we can't take a pointer of a member function伪过程，因为我们不能获取成员函数的指针
 static void DiskDone(_int arg) { ((Disk *)arg)->HandleInterrupt(); }
+static void DiskHostIO(_int arg) { ((Disk *)arg)->HostIOLoop(); }
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -38,11 +60,16 @@ static void DiskDone(_int arg) { ((Disk *)arg)->HandleInterrupt(); }
 //	"callWhenDone" -- interrupt handler to be called when disk read/write
 //	   request completes “callWhenDone”--磁盘读写请求完成时要调用的中断处理程序
 //	"callArg" -- argument to pass the interrupt handler传递中断处理程序的参数
+//	"backend" -- whether to map the file into memory, or leave the
+//	   I/O to a host thread
+//	"tracks" -- how many tracks a new disk has
+//	"trackSize" -- and how many sectors on each
 //----------------------------------------------------------------------
 
-Disk::Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg)
+Disk::Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg,
+           DiskBackend backend, int tracks, int trackSize)
 {
-    int magicNum;
+    int header[GeometrySize / sizeof(int)];
     int tmp = 0;
 
     DEBUG('d', "Initializing the disk, 0x%x 0x%x\n", callWhenDone, callArg);
@@ -53,20 +80,69 @@ Disk::Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg)
 
     fileno = OpenForReadWrite(name, FALSE);
     if (fileno >= 0)
-    { // file exists, check magic number
-        Read(fileno, (char *)&magicNum, MagicSize);
-        ASSERT(magicNum == MagicNumber);
+    { // file exists, check magic number, and find out how big it is
+        Read(fileno, (char *)header, MagicSize);
+        if (header[0] == GeometryMagic)
+        {
+            Read(fileno, (char *)&header[1], GeometrySize - MagicSize);
+            numTracks = header[1];
+            sectorsPerTrack = header[2];
+            headerSize = GeometrySize;
+        }
+        else
+        {
+            ASSERT(header[0] == MagicNumber);
+            numTracks = DefaultNumTracks;
+            sectorsPerTrack = DefaultSectorsPerTrack;
+            headerSize = MagicSize;
+        }
+        ASSERT((numTracks > 0) && (sectorsPerTrack > 0) &&
+               (numTracks <= MaxDiskSectors / sectorsPerTrack));
     }
     else
     { // file doesn't exist, create it
+        numTracks = tracks;
+        sectorsPerTrack = trackSize;
+        ASSERT((numTracks > 0) && (sectorsPerTrack > 0) &&
+               (numTracks <= MaxDiskSectors / sectorsPerTrack));
         fileno = OpenForWrite(name);
-        magicNum = MagicNumber;
-        WriteFile(fileno, (char *)&magicNum, MagicSize); // write magic number
+        header[1] = numTracks;
+        header[2] = sectorsPerTrack;
+        if ((numTracks == DefaultNumTracks) &&
+            (sectorsPerTrack == DefaultSectorsPerTrack))
+        {
+            header[0] = MagicNumber;
+            headerSize = MagicSize;
+        }
+        else
+        {
+            header[0] = GeometryMagic;
+            headerSize = GeometrySize;
+        }
+        WriteFile(fileno, (char *)header, headerSize); // write magic number
 
         // need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);
+        Lseek(fileno, FileSize() - sizeof(int), 0);
         WriteFile(fileno, (char *)&tmp, sizeof(int));
     }
+    if (sectorsPerTrack <= DefaultSectorsPerTrack)
+        sectorTime = RotationTime;
+    else // more sectors go by in the same revolution
+        sectorTime = max(1, (RotationTime * DefaultSectorsPerTrack) /
+                                sectorsPerTrack);
+    DEBUG('d', "Disk of %d tracks, %d sectors each\n", numTracks,
+          sectorsPerTrack);
+
+    image = NULL;
+    if (backend == DiskMapped)
+        image = MapFile(fileno, FileSize()); // magic number and all
+    hostThread = hostWork = NULL;
+    if (backend == DiskAsync)
+    {
+        hostWork = NewHostSemaphore(0);
+        hostThread = StartHostThread(DiskHostIO, (_int)this);
+    }
+    DEBUG('d', "Disk backend: %s\n", BackendName(backend));
     active = FALSE;
 }
 
@@ -78,9 +154,61 @@ Disk::Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg)
 
 Disk::~Disk()
 {
+    HostIORequest stop;
+
+    if (hostThread != NULL)
+    { // anything still queued is done first
+        stop.nBytes = 0;
+        while (!toHost.Put(&stop))
+            HostYield();
+        HostSemaphoreV(hostWork);
+        JoinHostThread(hostThread);
+        DeleteHostSemaphore(hostWork);
+    }
+    if (image != NULL)
+    {
+        SyncMappedFile(image, FileSize());
+        UnmapFile(image, FileSize());
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Flush()
+// 	Make sure everything written to the disk so far is in the UNIX
+//	file.  Only the mapped backend has anything to do: with the
+//	others, each request's system call was made by the time its
+//	interrupt came.
+//----------------------------------------------------------------------
+
+void Disk::Flush()
+{
+    if (image != NULL)
+        SyncMappedFile(image, FileSize());
+}
+
+//----------------------------------------------------------------------
+// Disk::BackendByName, Disk::BackendName
+// 	Convert between backends and their names.
+//----------------------------------------------------------------------
+
+static const char *backendNames[NumDiskBackends] = {"rw", "mmap", "async"};
+
+int Disk::BackendByName(char *name)
+{
+    for (int b = 0; b < NumDiskBackends; b++)
+        if (!strcmp(name, backendNames[b]))
+            return b;
+    return -1;
+}
+
+const char *
+Disk::BackendName(int b)
+{
+    ASSERT((b >= 0) && (b < NumDiskBackends));
+    return backendNames[b];
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging. 将数据转储到磁盘读/写请求中，以便进行调试。
@@ -108,47 +236,73 @@ PrintSector(bool writing, int sector, char *data)
 //	      that will notify the caller when the simulator says
 //	      the operation has completed. 模拟一个读/写单个磁盘扇区的请求立即对UNIX文件进行读/写设置一个中断处理程序，稍后调用，当模拟器说操作已完成时，该处理程序将通知调用方。
 //
+//	A request may also cover several consecutive sectors; they are
+//	transferred as the head passes over them, so the request costs
+//	one seek and rotational delay, rather than one per sector, and
+//	raises one interrupt. 一个请求也可以覆盖多个连续扇区，只需一次寻道和旋转等待、一次中断。
+//
 //	Note that a disk only allows an entire sector to be read/written,
 //	not part of a sector.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	"sectorNumber" -- the (first) disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes 要写入的字节，保存传入字节的缓冲区
+//	"numSectors" -- how many sectors
 //----------------------------------------------------------------------
 
-void Disk::ReadRequest(int sectorNumber, char *data)
+void Disk::ReadRequest(int sectorNumber, char *data, int numSectors)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    int ticks = ComputeLatency(sectorNumber, FALSE, numSectors);
 
     ASSERT(!active); // only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
-        PrintSector(FALSE, sectorNumber, data);
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) &&
+           (sectorNumber + numSectors <= Sectors()));
+
+    DEBUG('d', "Reading %d sectors from sector %d\n", numSectors, sectorNumber);
+    if (image != NULL)
+        bcopy(&image[SectorSize * sectorNumber + headerSize], data,
+              SectorSize * numSectors);
+    else if (hostThread != NULL)
+        StartHostIO(sectorNumber, data, numSectors, FALSE);
+    else
+    {
+        Lseek(fileno, SectorSize * sectorNumber + headerSize, 0);
+        Read(fileno, data, SectorSize * numSectors);
+    }
+    if (DebugIsEnabled('d') && (hostThread == NULL)) // else when done
+        for (int i = 0; i < numSectors; i++)
+            PrintSector(FALSE, sectorNumber + i, &data[i * SectorSize]);
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     stats->numDiskReads++;
     interrupt->Schedule(DiskDone, (_int)this, ticks, DiskInt);
 }
 
-void Disk::WriteRequest(int sectorNumber, char *data)
+void Disk::WriteRequest(int sectorNumber, char *data, int numSectors)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, TRUE, numSectors);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    ASSERT((sectorNumber >= 0) && (numSectors > 0) &&
+           (sectorNumber + numSectors <= Sectors()));
+
+    DEBUG('d', "Writing %d sectors to sector %d\n", numSectors, sectorNumber);
+    if (image != NULL)
+        bcopy(data, &image[SectorSize * sectorNumber + headerSize],
+              SectorSize * numSectors);
+    else if (hostThread != NULL)
+        StartHostIO(sectorNumber, data, numSectors, TRUE);
+    else
+    {
+        Lseek(fileno, SectorSize * sectorNumber + headerSize, 0);
+        WriteFile(fileno, data, SectorSize * numSectors);
+    }
     if (DebugIsEnabled('d'))
-        PrintSector(TRUE, sectorNumber, data);
+        for (int i = 0; i < numSectors; i++)
+            PrintSector(TRUE, sectorNumber + i, &data[i * SectorSize]);
 
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     stats->numDiskWrites++;
     interrupt->Schedule(DiskDone, (_int)this, ticks, DiskInt);
 }
@@ -161,10 +315,81 @@ void Disk::WriteRequest(int sectorNumber, char *data)
 
 void Disk::HandleInterrupt()
 {
+    if (hostThread != NULL)
+        FinishHostIO();
     active = FALSE;
     (*handler)(handlerArg);
 }
 
+//----------------------------------------------------------------------
+// Disk::StartHostIO()
+// 	Hand a request over to the host I/O thread.  The caller's buffer
+//	must be left alone until the request's interrupt.
+//----------------------------------------------------------------------
+
+void Disk::StartHostIO(int sectorNumber, char *data, int numSectors,
+                       bool writing)
+{
+    HostIORequest req;
+
+    req.data = data;
+    req.offset = SectorSize * sectorNumber + headerSize;
+    req.nBytes = SectorSize * numSectors;
+    req.writing = writing;
+    while (!toHost.Put(&req)) // only if the host thread is far behind
+        HostYield();
+    HostSemaphoreV(hostWork);
+}
+
+//----------------------------------------------------------------------
+// Disk::FinishHostIO()
+// 	Collect the outstanding request from the host I/O thread, waiting
+//	for it if it is not done yet.  There is only ever one, since the
+//	disk takes one request at a time.
+//----------------------------------------------------------------------
+
+void Disk::FinishHostIO()
+{
+    HostIORequest req;
+    int sector;
+
+    while (!fromHost.Get(&req))
+        HostYield();
+    if (DebugIsEnabled('d'))
+    {
+        sector = (req.offset - headerSize) / SectorSize;
+        for (int i = 0; i < req.nBytes / SectorSize; i++)
+            PrintSector(req.writing, sector + i, &req.data[i * SectorSize]);
+    }
+}
+
+//----------------------------------------------------------------------
+// Disk::HostIOLoop()
+// 	The host I/O thread: do each request handed over, and hand it
+//	back, until told to stop.  Runs outside the simulation, so it
+//	touches nothing but the rings and the UNIX file.
+//----------------------------------------------------------------------
+
+void Disk::HostIOLoop()
+{
+    HostIORequest req;
+
+    for (;;)
+    {
+        HostSemaphoreP(hostWork);
+        if (!toHost.Get(&req))
+            continue;
+        if (req.nBytes == 0)
+            return; // told to stop
+        if (req.writing)
+            WriteFileAt(fileno, req.data, req.nBytes, req.offset);
+        else
+            ReadFileAt(fileno, req.data, req.nBytes, req.offset);
+        while (!fromHost.Put(&req))
+            HostYield();
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::TimeToSeek()
 //	Returns how long it will take to position the disk head over the correct
@@ -174,24 +399,42 @@ void Disk::HandleInterrupt()
 //
 //   	Disk seeks at one track per SeekTime ticks (cf. stats.h)
 //   	and rotates at one sector per RotationTime ticks磁盘在每个SeekTime ticks（参见stats.h）上寻找一个磁道，并在每个RotationTime ticks上旋转一个扇区
+//	(on a disk of the default geometry; see SeekTicks and sectorTime)
 //----------------------------------------------------------------------
 
 int Disk::TimeToSeek(int newSector, int *rotation)
 {
-    int newTrack = newSector / SectorsPerTrack;
-    int oldTrack = lastSector / SectorsPerTrack;
-    int seek = abs(newTrack - oldTrack) * SeekTime;
+    int newTrack = newSector / sectorsPerTrack;
+    int oldTrack = lastSector / sectorsPerTrack;
+    int seek = SeekTicks(abs(newTrack - oldTrack));
     // how long will seek take?
-    int over = (stats->totalTicks + seek) % RotationTime;
+    int over = (stats->totalTicks + seek) % sectorTime;
     // will we be in the middle of a sector when
     // we finish the seek? 当我们完成搜寻时，我们会在一个区域的中间吗？
 
     *rotation = 0; //旋转等待时间
     if (over > 0)  // if so, need to round up to next full sector
-        *rotation = RotationTime - over;
+        *rotation = sectorTime - over;
     return seek; //寻道时间
 }
 
+//----------------------------------------------------------------------
+// Disk::SeekTicks()
+// 	Return how long it takes to seek across "tracks" tracks.  On a disk
+//	with no more tracks than the default one, that is SeekTime per
+//	track.  On a bigger one, the tracks are closer together: a seek
+//	across all of them takes as long as across the default disk, and
+//	a short one takes at least a tick.
+//----------------------------------------------------------------------
+
+int Disk::SeekTicks(int tracks)
+{
+    if (numTracks <= DefaultNumTracks)
+        return tracks * SeekTime;
+    return (int)(((long long)tracks * SeekTime * DefaultNumTracks +
+                  numTracks - 1) / numTracks);
+}
+
 //----------------------------------------------------------------------
 // Disk::ModuloDiff()
 // 	Return number of sectors of rotational delay between target sector
@@ -200,10 +443,10 @@ int Disk::TimeToSeek(int newSector, int *rotation)
 
 int Disk::ModuloDiff(int to, int from) //转的块数
 {
-    int toOffset = to % SectorsPerTrack;
-    int fromOffset = from % SectorsPerTrack;
+    int toOffset = to % sectorsPerTrack;
+    int fromOffset = from % sectorsPerTrack;
 
-    return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
+    return ((toOffset - fromOffset) + sectorsPerTrack) % sectorsPerTrack;
 }
 
 //----------------------------------------------------------------------
@@ -225,42 +468,72 @@ int Disk::ModuloDiff(int to, int from) //转的块数
 //   	read requests to the current track to be satisfied more quickly.
 //   	The contents of the track buffer are discarded after every seek to
 //   	a new track.磁盘还有一个“磁道缓冲区”；磁盘不断地将当前磁盘磁道的内容读入缓冲区。这样可以更快地满足对当前曲目的读取请求。每次搜索到新磁道后，都会丢弃磁道缓冲区的内容。
+//
+//	For a request of several sectors, each sector after the first
+//	passes under the head right after the one before it, and takes
+//	one more transfer time -- except that moving on to the next track
+//	means a seek, and waiting for the track's first sector to come
+//	round. 多扇区请求：后续扇区每个再加一个传输时间；跨磁道时再加一次寻道和旋转等待。
 //----------------------------------------------------------------------
 
-int Disk::ComputeLatency(int newSector, bool writing)//返回寻道时间 + 旋转等待时间 + 读取时间
+int Disk::ComputeLatency(int newSector, bool writing, int numSectors)//返回寻道时间 + 旋转等待时间 + 读取时间
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
     int timeAfter = stats->totalTicks + seek + rotation;
+    int ticks, when, sector;
 
 #ifndef NOTRACKBUF // turn this on if you don't want the track buffer stuff
     // check if track buffer applies 如果您不想使用track buffer，请启用此选项检查track buffer是否适用
-    if ((writing == FALSE) && (seek == 0) && (((timeAfter - bufferInit) / RotationTime) > ModuloDiff(newSector, bufferInit / RotationTime)))
+    if ((writing == FALSE) && (seek == 0) && (((timeAfter - bufferInit) / sectorTime) > ModuloDiff(newSector, bufferInit / sectorTime)))
+        ticks = sectorTime; // time to transfer sector from the track buffer 从磁道缓冲器传送扇区的时间
+    else
+#endif
     {
-        DEBUG('d', "Request latency = %d\n", RotationTime);
-        return RotationTime; // time to transfer sector from the track buffer 从磁道缓冲器传送扇区的时间
+        rotation += ModuloDiff(newSector, timeAfter / sectorTime) * sectorTime;
+        ticks = seek + rotation + sectorTime;
     }
-#endif
 
-    rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
+    for (sector = newSector + 1; sector < newSector + numSectors; sector++)
+    {
+        if ((sector % sectorsPerTrack) == 0)
+        { // on to the next track
+            when = stats->totalTicks + ticks + SeekTicks(1);
+            rotation = (sectorTime - (when % sectorTime)) % sectorTime;
+            rotation += ModuloDiff(sector, (when + rotation) / sectorTime) * sectorTime;
+            ticks += SeekTicks(1) + rotation;
+        }
+        ticks += sectorTime;
+    }
 
-    DEBUG('d', "Request latency = %d\n", seek + rotation + RotationTime);
-    return (seek + rotation + RotationTime);
+    DEBUG('d', "Request latency = %d\n", ticks);
+    return ticks;
 }
 
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
 //	what is in the track buffer.跟踪最近请求的扇区。这样我们就可以知道磁道缓冲器里有什么。
+//
+//	A request of several sectors leaves the head on the track of its
+//	last sector; if that is a new track, the track buffer started
+//	loading when the head got there, about when the sectors on it
+//	started to be transferred.
+//
+//	"ticks" is how long the request takes
 //----------------------------------------------------------------------
 
-void Disk::UpdateLast(int newSector)
+void Disk::UpdateLast(int newSector, int numSectors, int ticks)
 {
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
+    int last = newSector + numSectors - 1;
 
     if (seek != 0)
         bufferInit = stats->totalTicks + seek + rotate;
-    lastSector = newSector;
+    if ((last / sectorsPerTrack) != (newSector / sectorsPerTrack))
+        bufferInit = stats->totalTicks + ticks -
+                     ((last % sectorsPerTrack) + 1) * sectorTime;
+    lastSector = last;
     DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
 }
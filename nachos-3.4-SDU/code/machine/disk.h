@@ -19,6 +19,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "hostring.h"
 
 // The following class defines a physical disk I/O device.  The disk
 // has a single surface, split up into "tracks", and each track split
@@ -45,39 +46,106 @@
 // disks these days now come with a track buffer.为了让生活更真实一些，每个操作的模拟时间反映了一个“磁道缓冲区”——RAM，当磁盘磁头经过时存储当前磁道的内容。其思想是磁盘总是传输到磁道缓冲区，以防以后请求数据。这样做的好处是消除了“跳过扇区”调度的需要——在磁头通过扇区开头后不久发出的读取请求可以更快地得到满足，因为它的内容在磁道缓冲区中。现在大多数磁盘都有一个磁道缓冲区
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// The number of tracks, and of sectors on each, is chosen when the
+// UNIX file is created, and kept at its front with the magic number.
+// A disk with more tracks (or sectors per track) than the default one
+// packs them closer together: a seek across the whole disk, and a
+// whole revolution, take no longer than on the default disk.
+// 磁道数和每道扇区数在创建UNIX文件时确定并保存在文件头；更大的磁盘磁道/扇区更密，全程寻道和旋转一周的时间不变。
+
+#define SectorSize 128              // number of bytes per disk sector 每个磁盘扇区的字节数
+#define DefaultSectorsPerTrack 32   // sectors per track of a new disk,
+#define DefaultNumTracks 32         // and tracks, unless "-dg" says otherwise
+#define MaxDiskSectors (1 << 23)    // 1GB: offsets into the UNIX file
+                                    // must fit in an int
 
-#define SectorSize 128     // number of bytes per disk sector 每个磁盘扇区的字节数
-#define SectorsPerTrack 32 // number of sectors per disk track 每个磁盘磁道的扇区数
-#define NumTracks 32       // number of tracks per disk 每个磁盘的磁道数
+// The geometry of the disk the file system is on (DISK), once it has
+// been opened. 文件系统所在磁盘的几何参数，打开磁盘后设置。
+extern int diskSectorsPerTrack, diskNumTracks;
+#define SectorsPerTrack diskSectorsPerTrack // number of sectors per disk track 每个磁盘磁道的扇区数
+#define NumTracks diskNumTracks             // number of tracks per disk 每个磁盘的磁道数
 #define NumSectors (SectorsPerTrack * NumTracks)
 // total # of sectors per disk
 
+// How the simulated disk gets at the UNIX file that holds its contents.
+// The simulated timing is the same either way. 模拟磁盘访问UNIX文件的方式，模拟时间不受影响。
+enum DiskBackend
+{
+  DiskReadWrite, // a lseek and a read/write call per request
+  DiskMapped,    // the whole file is mapped into memory, and
+                 // requests are memory copies
+  DiskAsync,     // a host thread does the reads and writes,
+                 // while the simulation goes on
+  NumDiskBackends
+};
+
+#define DefaultDiskBackend DiskReadWrite // unless overridden with "-dio"
+
 class Disk
 {
 public:
-  Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg);
+  Disk(char *name, VoidFunctionPtr callWhenDone, _int callArg,
+       DiskBackend backend = DefaultDiskBackend,
+       int tracks = DefaultNumTracks,
+       int trackSize = DefaultSectorsPerTrack);
   // Create a simulated disk.
   // Invoke (*callWhenDone)(callArg)
   // every time a request completes.创建一个模拟磁盘。每次请求完成时调用（*callWhenDone）（callArg）
+  // "tracks" and "trackSize" (sectors
+  // per track) only matter if the
+  // file is new
   ~Disk(); // Deallocate the disk.
 
-  void ReadRequest(int sectorNumber, char *data);
-  // Read/write an single disk sector.
+  void ReadRequest(int sectorNumber, char *data, int numSectors = 1);
+  // Read/write an single disk sector,
+  // or "numSectors" consecutive ones.
   // These routines send a request to
   // the disk and return immediately.
-  // Only one request allowed at a time!读/写单个磁盘扇区。这些例程向磁盘发送请求并立即返回。一次只允许一个请求！
-  void WriteRequest(int sectorNumber, char *data);
+  // Only one request allowed at a time!读/写单个磁盘扇区（或连续的多个扇区）。这些例程向磁盘发送请求并立即返回。一次只允许一个请求！
+  void WriteRequest(int sectorNumber, char *data, int numSectors = 1);
 
   void HandleInterrupt(); // Interrupt handler, invoked when
                           // disk request finishes.中断处理程序，在磁盘请求完成时调用。
 
-  int ComputeLatency(int newSector, bool writing);
+  int ComputeLatency(int newSector, bool writing, int numSectors = 1);
   // Return how long a request to
   // newSector will take:
   // (seek + rotational delay + transfer)返回对newSector的请求需要多长时间：（seek+旋转延迟+传输）
+  int HeadSector() { return lastSector; }
+  // Where the head is: the sector of
+  // the last request 磁头位置（上一次请求的扇区）
+
+  int Tracks() { return numTracks; }         // the disk's geometry
+  int TrackSize() { return sectorsPerTrack; } // (sectors per track)
+  int Sectors() { return numTracks * sectorsPerTrack; }
+
+  void Flush(); // Make sure what has been written is
+                // in the UNIX file 确保已写入的数据落到UNIX文件
+
+  static int BackendByName(char *name); // "rw", "mmap" or "async";
+                                        // -1 if none of those
+  static const char *BackendName(int b);
+
+  void HostIOLoop(); // Body of the host I/O thread
 
 private:
   int fileno;              // UNIX file number for simulated disk
+  int numTracks;           // geometry, from the file's header
+  int sectorsPerTrack;
+  int headerSize;          // bytes before sector 0 in the file
+  int sectorTime;          // ticks for one sector to pass the head
+  char *image;             // the file, mapped into memory; NULL
+                           // unless the backend is DiskMapped
+
+  // with the DiskAsync backend: 异步后端
+  void *hostThread;        // the host I/O thread; NULL otherwise
+  void *hostWork;          // host semaphore, V()ed per request
+  HostRing toHost;         // requests for the host thread...
+  HostRing fromHost;       // ...and back, once they are done
+  void StartHostIO(int sectorNumber, char *data, int numSectors,
+                   bool writing);
+  void FinishHostIO();     // collect the one outstanding request
   VoidFunctionPtr handler; // Interrupt handler, to be invoked
                            // when any disk request finishes 中断处理程序，在任何磁盘请求完成时调用
   _int handlerArg;         // Argument to interrupt handler
@@ -87,8 +155,10 @@ private:
                            // being loaded 当开始加载磁道缓冲区时
 
   int TimeToSeek(int newSector, int *rotate); // time to get to the new track 是时候走上新的磁道了
+  int SeekTicks(int tracks);                  // ...across so many tracks
+  int FileSize() { return headerSize + Sectors() * SectorSize; }
   int ModuloDiff(int to, int from);           // # sectors between to and from
-  void UpdateLast(int newSector);
+  void UpdateLast(int newSector, int numSectors, int ticks);
 };
 
 #endif // DISK_H
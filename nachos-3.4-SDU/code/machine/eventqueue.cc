@@ -0,0 +1,303 @@
+// eventqueue.cc
+//	Routines to manage the queue of pending hardware interrupts.
+//
+//	The queue is a binary min-heap kept in an array: the children of
+//	heap[i] are heap[2i+1] and heap[2i+2], and no interrupt is due
+//	before its parent.  Each record remembers its own position in the
+//	heap, so that an arbitrary one can be cancelled in O(log n).
+//
+//	Event ids handed out by Insert combine the record's slot number
+//	with a stamp that changes every time the record is reused, so a
+//	stale id (for an interrupt that already fired) cancels nothing. 事件id由记录槽号和复用戳组成，过期id不会误删其他事件。
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "eventqueue.h"
+
+#define SlotBits 16 // low bits of an event id: the slot number
+#define MaxSlots (1 << SlotBits)
+#define StampMask 0x7fff // keep ids positive
+
+// Is "a" due before "b"?  Equal times are served in order of insertion;
+// the subtraction keeps that right when the sequence numbers wrap.
+#define Earlier(a, b) \
+  (((a)->when < (b)->when) || \
+   (((a)->when == (b)->when) && ((int)((a)->seq - (b)->seq) < 0)))
+
+//----------------------------------------------------------------------
+// PendingInterrupt::PendingInterrupt
+// 	Initialize a hardware device interrupt that is to be scheduled
+//	to occur in the near future.
+//
+//	"func" is the procedure to call when the interrupt occurs
+//	"param" is the argument to pass to the procedure
+//	"time" is when (in simulated time) the interrupt is to occur
+//	"kind" is the hardware device that generated the interrupt
+//----------------------------------------------------------------------
+
+PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
+                                   IntType kind)
+{
+    handler = func;
+    arg = param;
+    when = time;
+    type = kind;
+    seq = 0;
+    heapIndex = -1;
+    slot = -1;
+    stamp = 0;
+    nextFree = NULL;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::EventQueue
+// 	Initialize an empty queue.  Room for a few records is made up
+//	front; more are allocated as needed, and then recycled.
+//----------------------------------------------------------------------
+
+EventQueue::EventQueue()
+{
+    maxSlots = 16;
+    heap = new PendingInterrupt *[maxSlots];
+    slots = new PendingInterrupt *[maxSlots];
+    numPending = 0;
+    numSlots = 0;
+    freeList = NULL;
+    nextSeq = 0;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::~EventQueue
+// 	De-allocate the queue, including every event record.
+//----------------------------------------------------------------------
+
+EventQueue::~EventQueue()
+{
+    for (int i = 0; i < numSlots; i++)
+        delete slots[i];
+    delete[] slots;
+    delete[] heap;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Alloc
+// 	Return an unused event record, from the free list if possible.
+//	Otherwise allocate a new one, growing the arrays if they are full.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+EventQueue::Alloc()
+{
+    PendingInterrupt *event;
+
+    if (freeList != NULL)
+    {
+        event = freeList;
+        freeList = event->nextFree;
+        event->nextFree = NULL;
+        return event;
+    }
+
+    if (numSlots == maxSlots)
+    { // double the arrays
+        PendingInterrupt **newHeap, **newSlots;
+
+        ASSERT(maxSlots < MaxSlots);
+        newHeap = new PendingInterrupt *[maxSlots * 2];
+        newSlots = new PendingInterrupt *[maxSlots * 2];
+        for (int i = 0; i < maxSlots; i++)
+        {
+            newHeap[i] = heap[i];
+            newSlots[i] = slots[i];
+        }
+        delete[] heap;
+        delete[] slots;
+        heap = newHeap;
+        slots = newSlots;
+        maxSlots *= 2;
+    }
+    event = new PendingInterrupt(NULL, 0, 0, TimerInt);
+    event->slot = numSlots;
+    slots[numSlots++] = event;
+    return event;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Insert
+// 	Put an interrupt on the queue.
+//
+//	"handler" is the procedure to call when the interrupt occurs
+//	"arg" is the argument to pass to the procedure
+//	"when" is the (absolute) simulated time it is to occur
+//	"type" is the hardware device that generated the interrupt
+//
+// Returns:
+//	an id that can be passed to Cancel
+//----------------------------------------------------------------------
+
+int EventQueue::Insert(VoidFunctionPtr handler, _int arg, int when, IntType type)
+{
+    PendingInterrupt *event = Alloc();
+
+    event->handler = handler;
+    event->arg = arg;
+    event->when = when;
+    event->type = type;
+    event->seq = nextSeq++;
+    Place(event, numPending++);
+    SiftUp(event->heapIndex);
+    return (event->stamp << SlotBits) | event->slot;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Cancel
+// 	Take the interrupt with the given id off the queue, if it has not
+//	fired (or been cancelled) yet.
+//
+// Returns:
+//	TRUE if the interrupt was still pending
+//----------------------------------------------------------------------
+
+bool EventQueue::Cancel(int id)
+{
+    int slot = id & (MaxSlots - 1);
+    PendingInterrupt *event;
+
+    if ((id < 0) || (slot >= numSlots))
+        return FALSE;
+    event = slots[slot];
+    if ((event->stamp != (id >> SlotBits)) || (event->heapIndex < 0))
+        return FALSE; // already fired, cancelled, or recycled
+    Remove(event->heapIndex);
+    Free(event);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::RemoveFirst
+// 	Take the earliest interrupt off the queue.  The caller must give
+//	the record back with Free() when it is done with it.
+//
+// Returns:
+//	the interrupt, NULL if the queue is empty
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+EventQueue::RemoveFirst()
+{
+    PendingInterrupt *event;
+
+    if (numPending == 0)
+        return NULL;
+    event = heap[0];
+    Remove(0);
+    return event;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Free
+// 	Put an event record, no longer queued, back on the free list.
+//	Its stamp changes, so that old ids for it no longer match.
+//----------------------------------------------------------------------
+
+void EventQueue::Free(PendingInterrupt *event)
+{
+    ASSERT(event->heapIndex == -1);
+    event->stamp = (event->stamp + 1) & StampMask;
+    event->nextFree = freeList;
+    freeList = event;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Mapcar
+// 	Apply a function to every interrupt on the queue (in heap order,
+//	which is not the order they are due in).
+//----------------------------------------------------------------------
+
+void EventQueue::Mapcar(VoidFunctionPtr func)
+{
+    for (int i = 0; i < numPending; i++)
+        (*func)((_int)heap[i]);
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Remove
+// 	Take heap[i] off the heap: move the last element into the hole,
+//	then restore the heap order around it.
+//----------------------------------------------------------------------
+
+void EventQueue::Remove(int i)
+{
+    PendingInterrupt *event = heap[i];
+
+    ASSERT((i >= 0) && (i < numPending));
+    event->heapIndex = -1;
+    numPending--;
+    if (i == numPending)
+        return; // it was the last one
+    Place(heap[numPending], i);
+    SiftDown(i);
+    SiftUp(heap[i]->heapIndex);
+}
+
+//----------------------------------------------------------------------
+// EventQueue::Place
+// 	Store "event" at heap[i], keeping its back pointer up to date.
+//----------------------------------------------------------------------
+
+void EventQueue::Place(PendingInterrupt *event, int i)
+{
+    heap[i] = event;
+    event->heapIndex = i;
+}
+
+//----------------------------------------------------------------------
+// EventQueue::SiftUp
+// 	Move heap[i] up towards the root while it is due before its parent.
+//----------------------------------------------------------------------
+
+void EventQueue::SiftUp(int i)
+{
+    PendingInterrupt *event = heap[i];
+    int parent;
+
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+        if (!Earlier(event, heap[parent]))
+            break;
+        Place(heap[parent], i);
+        i = parent;
+    }
+    Place(event, i);
+}
+
+//----------------------------------------------------------------------
+// EventQueue::SiftDown
+// 	Move heap[i] down while one of its children is due before it.
+//----------------------------------------------------------------------
+
+void EventQueue::SiftDown(int i)
+{
+    PendingInterrupt *event = heap[i];
+    int child;
+
+    for (;;)
+    {
+        child = 2 * i + 1;
+        if (child >= numPending)
+            break;
+        if ((child + 1 < numPending) && Earlier(heap[child + 1], heap[child]))
+            child++;
+        if (!Earlier(heap[child], event))
+            break;
+        Place(heap[child], i);
+        i = child;
+    }
+    Place(event, i);
+}
@@ -0,0 +1,110 @@
+// eventqueue.h
+//	Data structures for the queue of hardware interrupts scheduled
+//	to occur in the future.
+//
+//	The queue is a binary min-heap ordered by the time each interrupt
+//	is due (ties are broken first come, first served), so looking at
+//	the earliest interrupt is O(1), and scheduling or removing one is
+//	O(log n).  Every device reschedules itself over and over, so the
+//	event records are kept on a free list and recycled, rather than
+//	allocated and deleted each time. 待处理中断队列：按到期时间排序的二叉最小堆，事件节点在空闲链表中复用。
+//
+//	A scheduled interrupt can be cancelled, using the id returned when
+//	it was inserted.
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// IntType records which hardware device generated an interrupt.
+// In Nachos, we support a hardware timer device, a disk, a console
+// display and keyboard, and a network.
+enum IntType
+{
+  TimerInt,
+  DiskInt,
+  ConsoleWriteInt,
+  ConsoleReadInt,
+  NetworkSendInt,
+  NetworkRecvInt
+};
+
+// The following class defines an interrupt that is scheduled
+// to occur in the future.  The internal data structures are
+// left public to make it simpler to manipulate.
+
+class PendingInterrupt
+{
+public:
+  PendingInterrupt(VoidFunctionPtr func, _int param, int time, IntType kind);
+  // initialize an interrupt that will
+  // occur in the future
+
+  VoidFunctionPtr handler; // The function (in the hardware device
+                           // emulator) to call when the interrupt occurs
+  _int arg;                // The argument to the function.
+  int when;                // When the interrupt is supposed to fire
+  IntType type;            // for debugging
+
+  // bookkeeping for the EventQueue
+  unsigned int seq;        // order of insertion, to break ties
+  int heapIndex;           // position in the heap, -1 if not queued
+  int slot;                // index in EventQueue::slots, never changes
+  int stamp;               // bumped each time the record is reused
+  PendingInterrupt *nextFree; // link on the free list
+};
+
+// The following class defines the queue of pending interrupts.
+
+class EventQueue
+{
+public:
+  EventQueue();  // initialize an empty queue
+  ~EventQueue(); // de-allocate the queue and all event records
+
+  int Insert(VoidFunctionPtr handler, _int arg, int when, IntType type);
+  // Queue an interrupt due at "when";
+  // returns an id to Cancel it with
+  bool Cancel(int id); // Take a queued interrupt back off the queue.
+                       // FALSE if it already fired or was cancelled
+
+  PendingInterrupt *Peek() // the earliest interrupt, NULL if none
+  {
+    return (numPending > 0) ? heap[0] : NULL;
+  }
+  PendingInterrupt *RemoveFirst(); // Take the earliest interrupt off
+                                   // the queue; hand it back with
+                                   // Free() once it has been handled
+  void Free(PendingInterrupt *event); // Recycle an event record
+
+  bool IsEmpty() { return numPending == 0; }
+  int NumPending() { return numPending; }
+
+  void Mapcar(VoidFunctionPtr func); // Apply "func" to every queued
+                                     // interrupt, in no particular order
+
+private:
+  PendingInterrupt **heap;  // the min-heap, heap[0] is due first
+  int numPending;           // number of interrupts in the heap
+  PendingInterrupt **slots; // every event record ever allocated
+  int numSlots;             // ...and how many there are
+  int maxSlots;             // size of "heap" and "slots"
+  PendingInterrupt *freeList; // records not in use
+  unsigned int nextSeq;     // sequence number for the next Insert
+
+  PendingInterrupt *Alloc(); // take a record off the free list
+  void Remove(int i);        // take heap[i] off the heap
+  void Place(PendingInterrupt *event, int i); // store event at heap[i]
+  void SiftUp(int i);
+  void SiftDown(int i);
+};
+
+#endif // EVENTQUEUE_H
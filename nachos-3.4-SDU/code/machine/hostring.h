@@ -0,0 +1,68 @@
+// hostring.h
+//	A queue for handing disk transfers between the simulation and a
+//	host (UNIX) thread that does the actual file I/O.
+//
+//	Each queue has exactly one producer and one consumer thread, so
+//	it needs no lock: the producer only ever changes "tail", the
+//	consumer only ever changes "head", and a memory barrier makes
+//	sure a slot's contents are seen before the index that hands it
+//	over. 单生产者单消费者无锁环形队列：生产者只改tail，消费者只改head。
+//
+//  DO NOT CHANGE -- part of the machine emulation
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HOSTRING_H
+#define HOSTRING_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define HostRingSize 8 // slots in a ring; a power of two
+
+// One transfer between a buffer and the UNIX file.  A zero "nBytes"
+// tells the host thread to stop.
+class HostIORequest
+{
+public:
+  char *data;   // the buffer
+  int offset;   // where in the UNIX file
+  int nBytes;   // how much
+  bool writing; // to the file, rather than from it?
+};
+
+class HostRing
+{
+public:
+  HostRing() { head = tail = 0; }
+
+  bool Put(HostIORequest *req) // producer: queue a copy of "req";
+  {                            // FALSE if the ring is full
+    if (tail - head == HostRingSize)
+      return FALSE;
+    slots[tail & (HostRingSize - 1)] = *req;
+    __sync_synchronize(); // fill the slot before handing it over
+    tail = tail + 1;
+    return TRUE;
+  }
+
+  bool Get(HostIORequest *req) // consumer: take the oldest into
+  {                            // "req"; FALSE if the ring is empty
+    if (head == tail)
+      return FALSE;
+    __sync_synchronize(); // see the slot as it was handed over
+    *req = slots[head & (HostRingSize - 1)];
+    __sync_synchronize(); // done with the slot before giving it back
+    head = head + 1;
+    return TRUE;
+  }
+
+private:
+  HostIORequest slots[HostRingSize];
+  volatile unsigned int head; // next slot to take; consumer only
+  volatile unsigned int tail; // next slot to fill; producer only
+};
+
+#endif // HOSTRING_H
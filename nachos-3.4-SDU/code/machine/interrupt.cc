@@ -30,26 +30,6 @@ static char *intLevelNames[] = {"off", "on"};
 static char *intTypeNames[] = {"timer", "disk", "console write",
                                "console read", "network send", "network recv"};
 
-//----------------------------------------------------------------------
-// PendingInterrupt::PendingInterrupt
-// 	Initialize a hardware device interrupt that is to be scheduled
-//	to occur in the near future.
-//
-//	"func" is the procedure to call when the interrupt occurs
-//	"param" is the argument to pass to the procedure
-//	"time" is when (in simulated time) the interrupt is to occur
-//	"kind" is the hardware device that generated the interrupt
-//----------------------------------------------------------------------
-
-PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
-                                   IntType kind)
-{
-    handler = func;
-    arg = param;
-    when = time;
-    type = kind;
-}
-
 //----------------------------------------------------------------------
 // Interrupt::Interrupt
 // 	Initialize the simulation of hardware device interrupts.
@@ -60,7 +40,7 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, _int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new EventQueue();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,9 +53,7 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-        delete pending->Remove();
-    delete pending;
+    delete pending; // frees the pending interrupts too
 }
 
 //----------------------------------------------------------------------
@@ -236,9 +214,18 @@ void Interrupt::Idle()
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//
+//	The file system's cached changes are written back first.  That
+//	needs the disk interrupt, so it cannot be done when we got here
+//	because the machine went idle; whoever made the last changes must
+//	have synced already.
 //----------------------------------------------------------------------
 void Interrupt::Halt()
 {
+#ifdef FILESYS_CACHE // lab5's file system has no Sync
+    if ((fileSystem != NULL) && (status != IdleMode))
+        fileSystem->Sync();
+#endif
     printf("Machine halting!\n\n");
     stats->Print();
     Cleanup(); // Never returns.
@@ -249,7 +236,7 @@ void Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on the event queue (eventqueue.cc).
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -259,17 +246,54 @@ void Interrupt::Halt()
 //	"fromNow" is how far in the future (in simulated time) the
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
+//
+// Returns:
+//	an id that can be passed to Cancel
 //----------------------------------------------------------------------
-void Interrupt::Schedule(VoidFunctionPtr handler, _int arg, int fromNow, IntType type)
+
+int Interrupt::Schedule(VoidFunctionPtr handler, _int arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n",
           intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    return pending->Insert(handler, arg, when, type);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Unschedule an interrupt, so that its handler is never called.
+//
+// Returns:
+//	TRUE if it was still pending (had not occurred, and had not
+//	already been cancelled)
+//
+//	"id" is what Schedule returned for the interrupt
+//----------------------------------------------------------------------
+
+bool Interrupt::Cancel(int id)
+{
+    DEBUG('i', "Cancelling interrupt %d\n", id);
+    return pending->Cancel(id);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::NextDueTime
+// 	Return the simulated time at which the earliest pending interrupt
+//	is to occur, or -1 if nothing is pending.  Until then, OneTick()
+//	has nothing to fire, so the CPU simulation (Machine::Run) can
+//	advance the clock by itself up to that point. 返回最早待处理中断的时间，无则返回-1。
+//----------------------------------------------------------------------
+
+int Interrupt::NextDueTime()
+{
+    PendingInterrupt *next = pending->Peek();
+
+    if (next == NULL)
+        return -1;
+    return next->when;
 }
 
 //----------------------------------------------------------------------
@@ -294,11 +318,11 @@ bool Interrupt::CheckIfDue(bool advanceClock)
                              // to invoke an interrupt handler
     if (DebugIsEnabled('i'))
         DumpState();
-    PendingInterrupt *toOccur =
-        (PendingInterrupt *)pending->SortedRemove(&when);
+    PendingInterrupt *toOccur = pending->Peek();
 
     if (toOccur == NULL) // no pending interrupts
         return FALSE;
+    when = toOccur->when;
 
     if (advanceClock && when > stats->totalTicks)
     { // advance the clock
@@ -306,17 +330,17 @@ bool Interrupt::CheckIfDue(bool advanceClock)
         stats->totalTicks = when;
     }
     else if (when > stats->totalTicks)
-    { // not time yet, put it back
-        pending->SortedInsert(toOccur, when);
+    { // not time yet, leave it queued
         return FALSE;
     }
 
     // Check if there is nothing more to do, and if so, quit
-    if ((status == IdleMode) && (toOccur->type == TimerInt) && pending->IsEmpty())
+    if ((status == IdleMode) && (toOccur->type == TimerInt) &&
+        (pending->NumPending() == 1))
     {
-        pending->SortedInsert(toOccur, when);
         return FALSE;
     }
+    pending->RemoveFirst();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n",
           intTypeNames[toOccur->type], toOccur->when);
@@ -331,7 +355,7 @@ bool Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg); // call the interrupt handler
     status = old;                        // restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    pending->Free(toOccur);
     return TRUE;
 }
 
@@ -37,6 +37,7 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "eventqueue.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus
@@ -55,37 +56,6 @@ enum MachineStatus
   UserMode
 };
 
-// IntType records which hardware device generated an interrupt.
-// In Nachos, we support a hardware timer device, a disk, a console
-// display and keyboard, and a network.
-enum IntType
-{
-  TimerInt,
-  DiskInt,
-  ConsoleWriteInt,
-  ConsoleReadInt,
-  NetworkSendInt,
-  NetworkRecvInt
-};
-
-// The following class defines an interrupt that is scheduled
-// to occur in the future.  The internal data structures are
-// left public to make it simpler to manipulate.
-
-class PendingInterrupt
-{
-public:
-  PendingInterrupt(VoidFunctionPtr func, _int param, int time, IntType kind);
-  // initialize an interrupt that will
-  // occur in the future
-
-  VoidFunctionPtr handler; // The function (in the hardware device
-                           // emulator) to call when the interrupt occurs
-  _int arg;                // The argument to the function.
-  int when;                // When the interrupt is supposed to fire
-  IntType type;            // for debugging
-};
-
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -123,16 +93,22 @@ public:
   // but they need to be public since they are called by the
   // hardware device simulators.
 
-  void Schedule(VoidFunctionPtr handler,           // Schedule an interrupt to occur
-                _int arg, int when, IntType type); // at time ``when''.  This is called
-                                                   // by the hardware device simulators.
+  int Schedule(VoidFunctionPtr handler,           // Schedule an interrupt to occur
+               _int arg, int when, IntType type); // at time ``when''.  This is called
+                                                  // by the hardware device simulators.
+                                                  // Returns an id for Cancel.
+  bool Cancel(int id); // Unschedule an interrupt that has not
+                       // occurred yet
 
   void OneTick(); // Advance simulated time
 
+  int NextDueTime(); // When is the next interrupt scheduled
+                     // to occur?  -1 if none is pending.
+
 private:
   IntStatus level;      // are interrupts enabled or disabled?
-  List *pending;        // the list of interrupts scheduled
-                        // to occur in the future
+  EventQueue *pending;  // the interrupts scheduled to occur
+                        // in the future
   bool inHandler;       // TRUE if we are running an interrupt handler
   bool yieldOnReturn;   // TRUE if we are to context switch
                         // on return from the interrupt handler
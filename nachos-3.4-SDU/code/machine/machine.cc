@@ -10,6 +10,7 @@
 #include "copyright.h"
 #include "machine.h"
 #include "system.h"
+#include "pagetrace.h"
 
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging. 可由用户程序执行生成的用于调试的异常的文本名称。
@@ -49,9 +50,14 @@ static void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed. 如果为TRUE，则在执行每个用户指令后进入调试器。
+//	"blocks" -- if TRUE, run user code with the basic-block engine
+//		(blocksim.cc) instead of one instruction at a time.
+//	"traceFile" -- if not NULL, record every page reference of user
+//		programs in this host file.  The host-side translation
+//		cache is then bypassed, so that no reference is missed.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool blocks, char *traceFile)
 {
     int i;
 
@@ -60,6 +66,13 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
         mainMemory[i] = 0;
+    decodedPages = new Instruction[NumPhysPages * NumInstrPerPage];
+    for (i = 0; i < NumPhysPages; i++)
+        decodedValid[i] = FALSE;
+    blockMap = new TranslatedBlock *[NumPhysPages * NumInstrPerPage];
+    for (i = 0; i < NumPhysPages * NumInstrPerPage; i++)
+        blockMap[i] = NULL;
+    retiredBlocks = NULL;
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
     for (i = 0; i < TLBSize; i++)
@@ -71,6 +84,11 @@ Machine::Machine(bool debug)
 #endif
 
     singleStep = debug;
+    useBlocks = blocks;
+    kernelEntries = 0;
+    traceMemory = DebugIsEnabled('a');
+    pageTrace = (traceFile != NULL) ? new PageTrace(traceFile) : NULL;
+    FlushHostTLB();
     CheckEndian();
 }
 
@@ -82,8 +100,15 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete[] mainMemory;
+    delete[] decodedPages;
+    for (int i = 0; i < NumPhysPages; i++)
+        FreeBlocks(i);
+    DeleteRetiredBlocks();
+    delete[] blockMap;
     if (tlb != NULL)
         delete[] tlb;
+    if (pageTrace != NULL)
+        delete pageTrace; // writes out the end of the trace
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +127,7 @@ void Machine::RaiseException(ExceptionType which, int badVAddr)
 
     //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
+    kernelEntries++;   // tells Run() to end its batch
     DelayedLoad(0, 0); // finish anything in progress
     interrupt->setStatus(SystemMode);
     ExceptionHandler(which); // interrupts are enabled at this point
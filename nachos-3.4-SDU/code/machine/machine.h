@@ -26,6 +26,8 @@
 #include "translate.h"
 #include "disk.h"
 
+class PageTrace;
+
 // Definitions related to the size, and format of user memory 与用户内存大小和格式相关的定义
 
 #define PageSize SectorSize // set the page size equal to \
@@ -35,6 +37,23 @@
 #define NumPhysPages 64 //32
 #define MemorySize (NumPhysPages * PageSize)
 #define TLBSize 4 // if there is a TLB, make it small
+#define NumInstrPerPage (PageSize / 4) // instructions held by one page
+#define HostTLBSize 16				   // entries in each host-side translation
+									   // cache; must be a power of 2
+
+// One entry of the host-side translation cache: virtual page "virtualPage"
+// starts at mainMemory[physicalBase].  An entry is filled only after a full
+// Translate of the page succeeded, so the use (and, for the write cache,
+// dirty) bit of the page is already set. 主机端地址转换缓存项。
+class HostTLBEntry
+{
+public:
+	unsigned int virtualPage; // HostTLBInvalid if the entry is empty
+	int physicalBase;		  // physical address of the page
+};
+#define HostTLBInvalid ((unsigned int)-1)
+
+class TranslatedBlock; // a translated basic block, see blocksim.cc
 
 enum ExceptionType
 {
@@ -110,8 +129,12 @@ public:
 class Machine
 {
 public:
-	Machine(bool debug); // Initialize the simulation of the hardware
-						 // for running user programs
+	Machine(bool debug, bool blocks = FALSE, char *traceFile = NULL);
+	// Initialize the simulation of the hardware
+	// for running user programs; "blocks" selects
+	// the basic-block engine (blocksim.cc);
+	// "traceFile" names a host file to record
+	// page references in (pagetrace.cc)
 	~Machine();			 // De-allocate the data structures
 
 	// Routines callable by the Nachos kernel
@@ -126,9 +149,21 @@ public:
 
 	void OneInstruction(Instruction *instr);
 	// Run one instruction of a user program. 运行用户程序的一条指令。
+	bool ExecuteInstruction(Instruction *instr);
+	// Carry out an already decoded instruction;
+	// FALSE if it trapped into the kernel.
+	int OneBlock(Instruction *instr, int budget);
+	// Run the basic block at the PC, at most
+	// "budget" instructions of it (blocksim.cc);
+	// returns how many ran 运行PC处的基本块
 	void DelayedLoad(int nextReg, int nextVal);
 	// Do a pending delayed load (modifying a reg) 执行挂起的延迟加载（修改寄存器）
 
+	void InvalidateDecodedPage(int frame);
+	// Throw away the predecoded instructions
+	// of physical page "frame", because its
+	// contents changed underneath us. 物理页内容改变，丢弃其预解码指令。
+
 	bool ReadMem(int addr, int size, int *value);
 	bool WriteMem(int addr, int size, int value);
 	// Read or write 1, 2, or 4 bytes of virtual
@@ -142,6 +177,17 @@ public:
 	// and return an exception code if the
 	// translation couldn't be completed. 转换一个地址，并检查是否对齐。在转换项中适当设置use和dirty位，如果转换无法完成，则返回异常代码。
 
+	ExceptionType CachedTranslate(int virtAddr, int *physAddr, int size,
+								  bool writing);
+	// Translate, through the host-side cache
+	// when the page was translated before
+
+	void FlushHostTLB();
+	// Empty the host-side translation cache.  Must
+	// be called whenever the page table (or TLB)
+	// is switched or changed, or use/dirty bits
+	// are cleared. 页表改变时必须清空主机端转换缓存。
+
 	void RaiseException(ExceptionType which, int badVAddr);
 	// Trap to the Nachos kernel, because of a
 	// system call or other exception. 由于系统调用或其他异常，陷入到Nachos内核。
@@ -183,11 +229,38 @@ public:
 	TranslationEntry *pageTable;
 	unsigned int pageTableSize;
 
+	PageTrace *pageTrace; // if not NULL, every page reference is
+						  // recorded in it; the kernel records
+						  // which space is running 页面访问轨迹
+
 private:
 	bool singleStep;  // drop back into the debugger after each
 					  // simulated instruction 在每一条模拟指令完成后，返回到调试器中
 	int runUntilTime; // drop back into the debugger when simulated  
 					  // time reaches this value 当模拟时间达到此值时，返回到调试器    执行多少条指令后中断   到这个时间调试
+	int kernelEntries; // number of traps into the kernel so far;
+					   // Run() batches instructions between them
+
+	bool traceMemory;	 // DEBUG('a') is on: print every access, and
+						 // don't use the host-side translation cache
+	HostTLBEntry readCache[HostTLBSize];  // pages translated for reading
+	HostTLBEntry writeCache[HostTLBSize]; // ...and for writing
+
+	void DecodePage(int frame); // fill in decodedPages for "frame"
+
+	Instruction *decodedPages;		 // predecoded copy of every word in
+									 // mainMemory, NumInstrPerPage per frame 每个物理页的预解码指令
+	bool decodedValid[NumPhysPages]; // is the predecoded copy of a frame
+									 // up to date?
+
+	bool useBlocks;					 // run user code a basic block at a time?
+	TranslatedBlock **blockMap;		 // block starting at each physical word
+	TranslatedBlock *retiredBlocks;	 // blocks waiting to be de-allocated
+
+	TranslatedBlock *TranslateBlock(int physAddr);
+	int RunBlock(TranslatedBlock *block, int budget);
+	void FreeBlocks(int frame);		 // retire the blocks of a page
+	void DeleteRetiredBlocks();
 };
 
 extern void ExceptionHandler(ExceptionType which);
@@ -16,6 +16,88 @@
 #include "mipssim.h"
 #include "system.h"
 
+// The decoding and printing tables declared in mipssim.h; defined here
+// once, as blocksim.cc includes that header too.
+
+OpInfo opTable[] = {
+	{SPECIAL, RFMT}, {BCOND, IFMT}, {OP_J, JFMT}, {OP_JAL, JFMT}, {OP_BEQ, IFMT}, {OP_BNE, IFMT}, {OP_BLEZ, IFMT}, {OP_BGTZ, IFMT}, {OP_ADDI, IFMT}, {OP_ADDIU, IFMT}, {OP_SLTI, IFMT}, {OP_SLTIU, IFMT}, {OP_ANDI, IFMT}, {OP_ORI, IFMT}, {OP_XORI, IFMT}, {OP_LUI, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_LB, IFMT}, {OP_LH, IFMT}, {OP_LWL, IFMT}, {OP_LW, IFMT}, {OP_LBU, IFMT}, {OP_LHU, IFMT}, {OP_LWR, IFMT}, {OP_RES, IFMT}, {OP_SB, IFMT}, {OP_SH, IFMT}, {OP_SWL, IFMT}, {OP_SW, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_SWR, IFMT}, {OP_RES, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_UNIMP, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}, {OP_RES, IFMT}};
+
+int specialTable[] = {
+	OP_SLL, OP_RES, OP_SRL, OP_SRA, OP_SLLV, OP_RES, OP_SRLV, OP_SRAV,
+	OP_JR, OP_JALR, OP_RES, OP_RES, OP_SYSCALL, OP_UNIMP, OP_RES, OP_RES,
+	OP_MFHI, OP_MTHI, OP_MFLO, OP_MTLO, OP_RES, OP_RES, OP_RES, OP_RES,
+	OP_MULT, OP_MULTU, OP_DIV, OP_DIVU, OP_RES, OP_RES, OP_RES, OP_RES,
+	OP_ADD, OP_ADDU, OP_SUB, OP_SUBU, OP_AND, OP_OR, OP_XOR, OP_NOR,
+	OP_RES, OP_RES, OP_SLT, OP_SLTU, OP_RES, OP_RES, OP_RES, OP_RES,
+	OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES,
+	OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES, OP_RES};
+
+struct OpString opStrings[] = {
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"ADD r%d,r%d,r%d", {RD, RS, RT}},
+	{"ADDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"ADDU r%d,r%d,r%d", {RD, RS, RT}},
+	{"AND r%d,r%d,r%d", {RD, RS, RT}},
+	{"ANDI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"BEQ r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"BGEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BGEZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BGTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLEZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZ r%d,%d", {RS, EXTRA, NONE}},
+	{"BLTZAL r%d,%d", {RS, EXTRA, NONE}},
+	{"BNE r%d,r%d,%d", {RS, RT, EXTRA}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"DIV r%d,r%d", {RS, RT, NONE}},
+	{"DIVU r%d,r%d", {RS, RT, NONE}},
+	{"J %d", {EXTRA, NONE, NONE}},
+	{"JAL %d", {EXTRA, NONE, NONE}},
+	{"JALR r%d,r%d", {RD, RS, NONE}},
+	{"JR r%d,r%d", {RD, RS, NONE}},
+	{"LB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LBU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LHU r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LUI r%d,%d", {RT, EXTRA, NONE}},
+	{"LW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"LWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MFHI r%d", {RD, NONE, NONE}},
+	{"MFLO r%d", {RD, NONE, NONE}},
+	{"Shouldn't happen", {NONE, NONE, NONE}},
+	{"MTHI r%d", {RS, NONE, NONE}},
+	{"MTLO r%d", {RS, NONE, NONE}},
+	{"MULT r%d,r%d", {RS, RT, NONE}},
+	{"MULTU r%d,r%d", {RS, RT, NONE}},
+	{"NOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"OR r%d,r%d,r%d", {RD, RS, RT}},
+	{"ORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"RFE", {NONE, NONE, NONE}},
+	{"SB r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SH r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SLL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SLLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SLT r%d,r%d,r%d", {RD, RS, RT}},
+	{"SLTI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTIU r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SLTU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SRA r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRAV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SRL r%d,r%d,%d", {RD, RT, EXTRA}},
+	{"SRLV r%d,r%d,r%d", {RD, RT, RS}},
+	{"SUB r%d,r%d,r%d", {RD, RS, RT}},
+	{"SUBU r%d,r%d,r%d", {RD, RS, RT}},
+	{"SW r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWL r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"SWR r%d,%d(r%d)", {RT, EXTRA, RS}},
+	{"XOR r%d,r%d,r%d", {RD, RS, RT}},
+	{"XORI r%d,r%d,%d", {RT, RS, EXTRA}},
+	{"SYSCALL", {NONE, NONE, NONE}},
+	{"Unimplemented", {NONE, NONE, NONE}},
+	{"Reserved", {NONE, NONE, NONE}}};
+
 static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 
 //----------------------------------------------------------------------
@@ -25,11 +107,36 @@ static void Mult(int a, int b, bool signedArith, int *hiPtr, int *loPtr);
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.这个例程是可重入的，因为它可以同时调用多次——每个线程执行一个用户代码。
+//
+//	Rather than calling interrupt->OneTick() after every instruction,
+//	we run in batches.  No interrupt can fire before the earliest
+//	pending one is due, and no new one can be scheduled until the user
+//	program traps into the kernel.  So we run instructions back to back,
+//	charging their UserTicks directly, up to the instruction whose tick
+//	reaches that deadline (or the first trap), and only that one goes
+//	through OneTick().  Interrupts thus fire at exactly the same
+//	simulated times as with one OneTick() per instruction. 按批执行：直到下一个中断到期或陷入内核才调用OneTick()，模拟时间语义不变。
+//
+//	Single-stepping and interrupt tracing (-s, -d i) want to see every
+//	tick, so they fall back to one instruction per OneTick(), without
+//	the block engine.  Page traces (-pt) and memory tracing (-d a) want
+//	every instruction fetch to go through Translate, so they turn off
+//	the block engine (-bb) too.
 //----------------------------------------------------------------------
 
+#define MaxBatch 100000 // most instructions run between two OneTick()s
+
 void Machine::Run()
 {
 	Instruction *instr = new Instruction; // storage for decoded instruction
+	bool blocks = useBlocks && !singleStep && !DebugIsEnabled('m') &&
+				  !traceMemory && (pageTrace == NULL);
+	// the block engine can't stop between
+	// instructions for the debugger, and
+	// fetches within a block without
+	// Translate, which traces references
+	bool batched = !singleStep && !DebugIsEnabled('i');
+	int due, budget, entries;
 
 	if (DebugIsEnabled('m'))
 		printf("Starting thread \"%s\" at time %d\n",
@@ -37,10 +144,42 @@ void Machine::Run()
 	interrupt->setStatus(UserMode);
 	for (;;)
 	{
-		OneInstruction(instr);
+		if (!batched)
+		{ // not even a block: its instructions would share one tick
+			OneInstruction(instr);
+			interrupt->OneTick();
+			if (singleStep && (runUntilTime <= stats->totalTicks))
+				Debugger();
+			continue;
+		}
+
+		// how many instructions until the next interrupt is due?
+		due = interrupt->NextDueTime();
+		if (due < 0)
+			budget = MaxBatch;
+		else
+			budget = divRoundUp(due - stats->totalTicks, UserTick);
+		if (budget < 1)
+			budget = 1;
+		else if (budget > MaxBatch)
+			budget = MaxBatch;
+
+		entries = kernelEntries;
+		for (;;)
+		{
+			if (blocks)
+				budget -= OneBlock(instr, budget);
+			else
+			{
+				OneInstruction(instr);
+				budget--;
+			}
+			if ((budget <= 0) || (kernelEntries != entries))
+				break; // deadline, or the kernel ran
+			stats->totalTicks += UserTick;
+			stats->userTicks += UserTick;
+		}
 		interrupt->OneTick();
-		if (singleStep && (runUntilTime <= stats->totalTicks))
-			Debugger();
 	}
 }
 
@@ -92,16 +231,22 @@ TypeToReg(RegType reg, Instruction *instr)
 
 void Machine::OneInstruction(Instruction *instr)
 {
-	int raw;
-	int nextLoadReg = 0;
-	int nextLoadValue = 0; // record delayed load operation, to apply
-						   // in the future
-
-	// Fetch instruction
-	if (!machine->ReadMem(registers[PCReg], 4, &raw))
+	// Fetch instruction.  Rather than reading and decoding the word at
+	// the PC every time, translate the PC and take the instruction from
+	// the predecoded copy of its physical page, decoding the whole page
+	// on first use.  取指：使用所在物理页的预解码副本，首次使用时整页解码。
+	ExceptionType exception;
+	int physAddr;
+
+	exception = CachedTranslate(registers[PCReg], &physAddr, 4, FALSE);
+	if (exception != NoException)
+	{
+		RaiseException(exception, registers[PCReg]);
 		return; // exception occurred
-	instr->value = raw;
-	instr->Decode();
+	}
+	if (!decodedValid[physAddr / PageSize])
+		DecodePage(physAddr / PageSize);
+	*instr = decodedPages[physAddr / 4];
 
 	if (DebugIsEnabled('m'))
 	{
@@ -114,6 +259,26 @@ void Machine::OneInstruction(Instruction *instr)
 		printf("\n");
 	}
 
+	ExecuteInstruction(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Carry out the effects of one already decoded instruction "instr",
+//	located at the current PC: update the registers and memory, do any
+//	delayed load, and advance the program counters.  Shared by
+//	OneInstruction and the basic-block engine (blocksim.cc).
+//
+//	Returns FALSE if the instruction trapped into the kernel (system
+//	call or exception) instead of completing normally. 执行一条已解码的指令；若陷入内核则返回FALSE。
+//----------------------------------------------------------------------
+
+bool Machine::ExecuteInstruction(Instruction *instr)
+{
+	int nextLoadReg = 0;
+	int nextLoadValue = 0; // record delayed load operation, to apply
+						   // in the future
+
 	// Compute next pc, but don't install in case there's an error or branch.
 	int pcAfter = registers[NextPCReg] + 4;
 	int sum, diff, tmp, value;
@@ -129,7 +294,7 @@ void Machine::OneInstruction(Instruction *instr)
 			((registers[instr->rs] ^ sum) & SIGN_BIT))
 		{
 			RaiseException(OverflowException, 0);
-			return;
+			return FALSE;
 		}
 		registers[instr->rd] = sum;
 		break;
@@ -140,7 +305,7 @@ void Machine::OneInstruction(Instruction *instr)
 			((instr->extra ^ sum) & SIGN_BIT))
 		{
 			RaiseException(OverflowException, 0);
-			return;
+			return FALSE;
 		}
 		registers[instr->rt] = sum;
 		break;
@@ -241,7 +406,7 @@ void Machine::OneInstruction(Instruction *instr)
 	case OP_LBU:
 		tmp = registers[instr->rs] + instr->extra;
 		if (!machine->ReadMem(tmp, 1, &value))
-			return;
+			return FALSE;
 
 		if ((value & 0x80) && (instr->opCode == OP_LB))
 			value |= 0xffffff00;
@@ -257,10 +422,10 @@ void Machine::OneInstruction(Instruction *instr)
 		if (tmp & 0x1)
 		{
 			RaiseException(AddressErrorException, tmp);
-			return;
+			return FALSE;
 		}
 		if (!machine->ReadMem(tmp, 2, &value))
-			return;
+			return FALSE;
 
 		if ((value & 0x8000) && (instr->opCode == OP_LH))
 			value |= 0xffff0000;
@@ -280,10 +445,10 @@ void Machine::OneInstruction(Instruction *instr)
 		if (tmp & 0x3)
 		{
 			RaiseException(AddressErrorException, tmp);
-			return;
+			return FALSE;
 		}
 		if (!machine->ReadMem(tmp, 4, &value))
-			return;
+			return FALSE;
 		nextLoadReg = instr->rt;
 		nextLoadValue = value;
 		break;
@@ -297,7 +462,7 @@ void Machine::OneInstruction(Instruction *instr)
 		ASSERT((tmp & 0x3) == 0);
 
 		if (!machine->ReadMem(tmp, 4, &value))
-			return;
+			return FALSE;
 		if (registers[LoadReg] == instr->rt)
 			nextLoadValue = registers[LoadValueReg];
 		else
@@ -329,7 +494,7 @@ void Machine::OneInstruction(Instruction *instr)
 		ASSERT((tmp & 0x3) == 0);
 
 		if (!machine->ReadMem(tmp, 4, &value))
-			return;
+			return FALSE;
 		if (registers[LoadReg] == instr->rt)
 			nextLoadValue = registers[LoadValueReg];
 		else
@@ -394,12 +559,12 @@ void Machine::OneInstruction(Instruction *instr)
 
 	case OP_SB:
 		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-			return;
+			return FALSE;
 		break;
 
 	case OP_SH:
 		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-			return;
+			return FALSE;
 		break;
 
 	case OP_SLL:
@@ -469,7 +634,7 @@ void Machine::OneInstruction(Instruction *instr)
 			((registers[instr->rs] ^ diff) & SIGN_BIT))
 		{
 			RaiseException(OverflowException, 0);
-			return;
+			return FALSE;
 		}
 		registers[instr->rd] = diff;
 		break;
@@ -480,7 +645,7 @@ void Machine::OneInstruction(Instruction *instr)
 
 	case OP_SW:
 		if (!machine->WriteMem((unsigned)(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-			return;
+			return FALSE;
 		break;
 
 	case OP_SWL:
@@ -491,7 +656,7 @@ void Machine::OneInstruction(Instruction *instr)
 		ASSERT((tmp & 0x3) == 0);
 
 		if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-			return;
+			return FALSE;
 		switch (tmp & 0x3)
 		{
 		case 0:
@@ -511,7 +676,7 @@ void Machine::OneInstruction(Instruction *instr)
 			break;
 		}
 		if (!machine->WriteMem((tmp & ~0x3), 4, value))
-			return;
+			return FALSE;
 		break;
 
 	case OP_SWR:
@@ -522,7 +687,7 @@ void Machine::OneInstruction(Instruction *instr)
 		ASSERT((tmp & 0x3) == 0);
 
 		if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-			return;
+			return FALSE;
 		switch (tmp & 0x3)
 		{
 		case 0:
@@ -539,12 +704,12 @@ void Machine::OneInstruction(Instruction *instr)
 			break;
 		} // end of switch (tmp & 0x3)
 		if (!machine->WriteMem((tmp & ~0x3), 4, value))
-			return;
+			return FALSE;
 		break;
 
 	case OP_SYSCALL:
 		RaiseException(SyscallException, 0);
-		return;
+		return FALSE;
 
 	case OP_XOR:
 		registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -557,7 +722,7 @@ void Machine::OneInstruction(Instruction *instr)
 	case OP_RES:
 	case OP_UNIMP:
 		RaiseException(IllegalInstrException, 0);
-		return;
+		return FALSE;
 
 	default:
 		ASSERT(FALSE);
@@ -573,6 +738,7 @@ void Machine::OneInstruction(Instruction *instr)
 											 // are jumping into lala-land
 	registers[PCReg] = registers[NextPCReg];
 	registers[NextPCReg] = pcAfter;
+	return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -592,6 +758,43 @@ void Machine::DelayedLoad(int nextReg, int nextValue)
 	registers[0] = 0; // and always make sure R0 stays zero.
 }
 
+//----------------------------------------------------------------------
+// Machine::DecodePage
+// 	Decode every instruction word of physical page "frame" into
+//	decodedPages, so that OneInstruction only has to copy out the
+//	already decoded form.  Data words get "decoded" too; that is
+//	harmless, since they are simply never fetched. 整页解码。
+//----------------------------------------------------------------------
+
+void Machine::DecodePage(int frame)
+{
+	Instruction *instr = &decodedPages[frame * NumInstrPerPage];
+	unsigned int *word = (unsigned int *)&mainMemory[frame * PageSize];
+
+	DEBUG('a', "Decoding physical page %d\n", frame);
+	for (int i = 0; i < NumInstrPerPage; i++, instr++, word++)
+	{
+		instr->value = WordToHost(*word);
+		instr->Decode();
+	}
+	decodedValid[frame] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateDecodedPage
+// 	Mark the predecoded copy of physical page "frame" stale.  Must be
+//	called whenever the contents of the frame change: by WriteMem for
+//	user stores, and by the kernel whenever it loads a page or gives
+//	the frame to a different address space. 物理页内容改变时使其预解码副本失效。
+//----------------------------------------------------------------------
+
+void Machine::InvalidateDecodedPage(int frame)
+{
+	ASSERT((frame >= 0) && (frame < NumPhysPages));
+	decodedValid[frame] = FALSE;
+	FreeBlocks(frame); // translated blocks are built from the same copy
+}
+
 //----------------------------------------------------------------------
 // Instruction::Decode
 // 	Decode a MIPS instruction
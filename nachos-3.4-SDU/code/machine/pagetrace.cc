@@ -0,0 +1,121 @@
+// pagetrace.cc
+//	Routines to record the page reference stream of user programs.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "machine.h"
+#include "pagetrace.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// PageTrace::PageTrace
+// 	Create (or truncate) the host file "fileName", and write the trace
+//	header.
+//----------------------------------------------------------------------
+
+PageTrace::PageTrace(char *fileName)
+{
+    TraceHeader header;
+
+    file = OpenForWrite(fileName);
+    header.magic = NTRACEMAGIC;
+    header.pageSize = PageSize;
+    WriteFile(file, (char *)&header, sizeof(header));
+    numBuffered = 0;
+    havePending = FALSE;
+    running = -1;
+}
+
+//----------------------------------------------------------------------
+// PageTrace::~PageTrace
+// 	Write out the last run of references and the buffer, and close
+//	the file.
+//----------------------------------------------------------------------
+
+PageTrace::~PageTrace()
+{
+    if (havePending)
+        Put(&pending);
+    Flush();
+    Close(file);
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Reference
+// 	Record a reference to virtual page "vpn" of the running space.  A
+//	reference to the same page, the same way, as the one before only
+//	moves the tick of the run forward; otherwise the run so far is
+//	buffered and a new one started. 与上一次访问同页同方式时只更新时间。
+//----------------------------------------------------------------------
+
+void PageTrace::Reference(unsigned int vpn, bool writing)
+{
+    unsigned int word = (vpn << 1) | (writing ? TraceWriteBit : 0);
+
+    ASSERT((word & TraceEventBit) == 0);
+    if (havePending && (pending.word == word))
+    {
+        pending.tick = stats->totalTicks;
+        return;
+    }
+    if (havePending)
+        Put(&pending);
+    pending.word = word;
+    pending.tick = stats->totalTicks;
+    havePending = TRUE;
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Event
+// 	Record that space "spaceId" was created, or exited, or is now the
+//	one running.  Switching to the space that is already running (a
+//	context switch between kernel threads, say) is not recorded.
+//----------------------------------------------------------------------
+
+void PageTrace::Event(int kind, int spaceId)
+{
+    TraceRecord record;
+
+    ASSERT((spaceId & ~TraceSpaceMask) == 0);
+    if ((kind == TraceSwitch) && (spaceId == running))
+        return;
+    if (havePending)
+    { // the run belongs to the space that was running
+        Put(&pending);
+        havePending = FALSE;
+    }
+    if (kind == TraceSwitch)
+        running = spaceId;
+    else if ((kind == TraceExit) && (spaceId == running))
+        running = -1; // its number may be given out again
+    record.word = TraceEventBit | (kind << TraceKindShift) | spaceId;
+    record.tick = stats->totalTicks;
+    Put(&record);
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Put
+// 	Buffer a record, writing the buffer out when it is full.
+//----------------------------------------------------------------------
+
+void PageTrace::Put(TraceRecord *record)
+{
+    buffer[numBuffered++] = *record;
+    if (numBuffered == TraceBufferSize)
+        Flush();
+}
+
+//----------------------------------------------------------------------
+// PageTrace::Flush
+// 	Write the buffered records to the file.
+//----------------------------------------------------------------------
+
+void PageTrace::Flush()
+{
+    if (numBuffered > 0)
+        WriteFile(file, (char *)buffer, numBuffered * sizeof(TraceRecord));
+    numBuffered = 0;
+}
@@ -0,0 +1,46 @@
+// pagetrace.h
+//	Data structures for recording the page reference stream of user
+//	programs to a host file, for replaying it against page replacement
+//	policies offline (see bin/pagesim.c, and bin/ntrace.h for the file
+//	format). 记录用户程序的页面访问序列到主机文件，供离线回放评估置换算法。
+//
+//	The machine records every successful translation; the kernel
+//	records which address space is running, and when spaces come and
+//	go.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGETRACE_H
+#define PAGETRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "ntrace.h"
+
+#define TraceBufferSize 512 // records written to the file at a time
+
+class PageTrace
+{
+public:
+  PageTrace(char *fileName); // Start a trace in host file "fileName"
+  ~PageTrace();              // Write out what is buffered, and close it
+
+  void Reference(unsigned int vpn, bool writing); // A user reference
+  void Event(int kind, int spaceId); // TraceSwitch, TraceCreate or
+                                     // TraceExit, of space "spaceId"
+
+private:
+  int file;                               // the host file
+  TraceRecord buffer[TraceBufferSize];    // records not written yet
+  int numBuffered;
+  TraceRecord pending;  // the run of references being recorded
+  bool havePending;
+  int running;          // the space whose references those are
+
+  void Put(TraceRecord *record); // buffer a record
+  void Flush();                  // write the buffer out
+};
+
+#endif // PAGETRACE_H
@@ -20,8 +20,13 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numCacheHits = numCacheMisses = 0;
+    numReadAhead = numReadAheadHits = numReadAheadWasted = 0;
+    numJournalCommits = numJournalSectors = numCheckpoints = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numEvictions = numSwapOuts = 0;
+    numSharedFaults = numCowFaults = 0;
 }
 
 //----------------------------------------------------------------------
@@ -36,9 +41,25 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    if ((numCacheHits > 0) || (numCacheMisses > 0))
+        printf("Buffer cache: hits %d, misses %d\n", numCacheHits,
+               numCacheMisses);
+    if (numReadAhead > 0)
+        printf("Read-ahead: %d sectors prefetched, %d hit (%d%%), %d wasted\n",
+               numReadAhead, numReadAheadHits,
+               (100 * numReadAheadHits) / numReadAhead, numReadAheadWasted);
+    if (numJournalCommits > 0)
+        printf("Journal: %d commits, %d sectors logged, %d checkpoints\n",
+               numJournalCommits, numJournalSectors, numCheckpoints);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
+    if (numEvictions > 0)
+        printf("Swap: %d pages evicted, %d written to swap\n",
+               numEvictions, numSwapOuts);
+    if ((numSharedFaults > 0) || (numCowFaults > 0))
+        printf("Sharing: %d faults mapped a shared page, %d copied on write\n",
+               numSharedFaults, numCowFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
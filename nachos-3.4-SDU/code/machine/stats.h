@@ -30,9 +30,23 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numCacheHits;		// sector requests served by the buffer cache
+    int numCacheMisses;		// ...and those that had to go to disk
+    int numReadAhead;		// sectors prefetched by sequential read-ahead
+    int numReadAheadHits;	// ...that a read then found in the cache
+    int numReadAheadWasted;	// ...that were evicted before being read
+    int numJournalCommits;	// transactions committed to the journal
+    int numJournalSectors;	// ...the metadata sectors they logged
+    int numCheckpoints;		// times the journal was written home
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numEvictions;		// pages taken out of memory to free a frame
+    int numSwapOuts;		// ...that were dirty, and written to swap
+    int numSharedFaults;	// page faults served by mapping a frame
+				// another process had already filled
+    int numCowFaults;		// writes that gave a process its own copy
+				// of a shared page
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
@@ -37,6 +37,9 @@ extern "C"
 #include <sys/un.h>
 #include <sys/mman.h>
 #include <sys/errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -258,6 +261,64 @@ int Unlink(char *name)
     return (bool)unlink(name);
 }
 
+//----------------------------------------------------------------------
+// ReadFileAt, WriteFileAt
+// 	Read or write characters at a given offset in an open file,
+//	without moving the file's current position (so another thread
+//	may use the file too).  Abort if the read or write fails.
+//----------------------------------------------------------------------
+
+void ReadFileAt(int fd, char *buffer, int nBytes, int offset)
+{
+    int retVal = pread(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+void WriteFileAt(int fd, char *buffer, int nBytes, int offset)
+{
+    int retVal = pwrite(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "size" bytes of an open file into memory, readable
+//	and writable, and shared with the file: stores into the memory
+//	change the file.  Abort on error. 将文件映射到内存（共享映射），写内存即写文件。
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int size)
+{
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    ASSERT(addr != MAP_FAILED);
+    return (char *)addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Write a mapped file's changes back to the file, and wait until
+//	they are written.  Abort on error.
+//----------------------------------------------------------------------
+
+void SyncMappedFile(char *addr, int size)
+{
+    int retVal = msync(addr, size, MS_SYNC);
+    ASSERT(retVal >= 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Undo MapFile.  The file itself stays open.  Abort on error.
+//----------------------------------------------------------------------
+
+void UnmapFile(char *addr, int size)
+{
+    int retVal = munmap(addr, size);
+    ASSERT(retVal >= 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now,
@@ -402,6 +463,102 @@ void SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
     return;
 }
 
+//----------------------------------------------------------------------
+// StartHostThread
+// 	Start a host (UNIX) thread running (*func)(arg), alongside the
+//	simulation.  Nachos threads are not host threads: this one must
+//	not touch any Nachos data structure except through something
+//	made for it, like a HostRing.  Return a handle for JoinHostThread.
+//	启动一个宿主机线程，与模拟并行运行；它不能直接访问Nachos数据结构。
+//----------------------------------------------------------------------
+
+struct HostThreadStart
+{
+    VoidFunctionPtr func;
+    _int arg;
+};
+
+static void *
+HostThreadBody(void *start)
+{
+    HostThreadStart s = *(HostThreadStart *)start;
+
+    delete (HostThreadStart *)start;
+    (*s.func)(s.arg);
+    return NULL;
+}
+
+void *
+StartHostThread(VoidFunctionPtr func, _int arg)
+{
+    pthread_t *thread = new pthread_t;
+    HostThreadStart *start = new HostThreadStart;
+    int retVal;
+
+    start->func = func;
+    start->arg = arg;
+    retVal = pthread_create(thread, NULL, HostThreadBody, start);
+    ASSERT(retVal == 0);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// JoinHostThread
+// 	Wait for a host thread to return from its function.
+//----------------------------------------------------------------------
+
+void JoinHostThread(void *thread)
+{
+    int retVal = pthread_join(*(pthread_t *)thread, NULL);
+
+    ASSERT(retVal == 0);
+    delete (pthread_t *)thread;
+}
+
+//----------------------------------------------------------------------
+// NewHostSemaphore, HostSemaphoreP, HostSemaphoreV, DeleteHostSemaphore
+// 	A counting semaphore between host threads; P really blocks the
+//	host thread, so the simulation itself must never wait on one.
+//----------------------------------------------------------------------
+
+void *
+NewHostSemaphore(int value)
+{
+    sem_t *sem = new sem_t;
+    int retVal = sem_init(sem, 0, value);
+
+    ASSERT(retVal == 0);
+    return sem;
+}
+
+void HostSemaphoreP(void *sem)
+{
+    while (sem_wait((sem_t *)sem) < 0)
+        ASSERT(errno == EINTR); // interrupted by a signal; try again
+}
+
+void HostSemaphoreV(void *sem)
+{
+    int retVal = sem_post((sem_t *)sem);
+    ASSERT(retVal == 0);
+}
+
+void DeleteHostSemaphore(void *sem)
+{
+    sem_destroy((sem_t *)sem);
+    delete (sem_t *)sem;
+}
+
+//----------------------------------------------------------------------
+// HostYield
+// 	Let other host threads run, while we wait for one of them.
+//----------------------------------------------------------------------
+
+void HostYield()
+{
+    sched_yield();
+}
+
 //----------------------------------------------------------------------
 // CallOnUserAbort
 // 	Arrange that "func" will be called when the user aborts (e.g., by
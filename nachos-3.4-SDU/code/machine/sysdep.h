@@ -27,9 +27,17 @@ extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
 extern void Close(int fd);
+extern void ReadFileAt(int fd, char *buffer, int nBytes, int offset);
+extern void WriteFileAt(int fd, char *buffer, int nBytes, int offset);
 //extern bool Unlink(char *name);
 extern int Unlink(char *name);
 
+// Map a whole open file into memory, shared with the file, and write
+// the changes back (now, or when it is unmapped)
+extern char *MapFile(int fd, int size);
+extern void SyncMappedFile(char *addr, int size);
+extern void UnmapFile(char *addr, int size);
+
 // Interprocess communication operations, for simulating the network
 extern int OpenSocket();
 extern void CloseSocket(int sockID);
@@ -39,6 +47,16 @@ extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
 extern void SendToSocket(int sockID, char *buffer, int packetSize,char *toName);
 
+// Host threads, which run alongside the simulation, and what they
+// need to wait for each other (cf. hostring.h)
+extern void *StartHostThread(VoidFunctionPtr func, _int arg);
+extern void JoinHostThread(void *thread);
+extern void *NewHostSemaphore(int value);
+extern void HostSemaphoreP(void *sem);
+extern void HostSemaphoreV(void *sem);
+extern void DeleteHostSemaphore(void *sem);
+extern void HostYield();
+
 // Process control: abort, exit, and sleep
 extern void Abort();
 extern void Exit(int exitCode);
@@ -33,6 +33,7 @@
 #include "machine.h"
 #include "addrspace.h"
 #include "system.h"
+#include "pagetrace.h"
 
 // Routines for converting Words and Short Words to and from the
 // simulated machine's format of little endian.  These end up
@@ -91,9 +92,10 @@ bool Machine::ReadMem(int addr, int size, int *value)
 	ExceptionType exception;
 	int physicalAddress;
 
-	DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
+	if (traceMemory)
+		DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
 
-	exception = Translate(addr, &physicalAddress, size, FALSE);
+	exception = CachedTranslate(addr, &physicalAddress, size, FALSE);
 	if (exception != NoException)
 	{
 		machine->RaiseException(exception, addr);
@@ -120,7 +122,8 @@ bool Machine::ReadMem(int addr, int size, int *value)
 		ASSERT(FALSE);
 	}
 
-	DEBUG('a', "\tvalue read = %8.8x\n", *value);
+	if (traceMemory)
+		DEBUG('a', "\tvalue read = %8.8x\n", *value);
 	return (TRUE);
 }
 
@@ -142,9 +145,10 @@ bool Machine::WriteMem(int addr, int size, int value)
 	ExceptionType exception;
 	int physicalAddress;
 
-	DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+	if (traceMemory)
+		DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
 
-	exception = Translate(addr, &physicalAddress, size, TRUE);
+	exception = CachedTranslate(addr, &physicalAddress, size, TRUE);
 	if (exception != NoException)
 	{
 		machine->RaiseException(exception, addr);
@@ -168,9 +172,67 @@ bool Machine::WriteMem(int addr, int size, int value)
 		ASSERT(FALSE);
 	}
 
+	// self-modifying code, or a data word sharing a page with code:
+	// the predecoded copy of the page is now stale 页面内容已改变，预解码副本失效
+	if (decodedValid[physicalAddress / PageSize])
+		InvalidateDecodedPage(physicalAddress / PageSize);
 	return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::CachedTranslate
+// 	Same as Translate, but first look in a small direct-mapped cache of
+//	the pages translated so far (one for reads, one for writes), and
+//	skip the full translation -- page table walk or TLB search, checks
+//	and bookkeeping -- on a hit.  Only successful translations are
+//	cached, so faults always take the slow path; the separate write
+//	cache makes sure the dirty bit is still set on the first write to a
+//	page that so far was only read. 带主机端缓存的地址转换：命中时跳过完整的Translate。
+//
+//	Cached entries are only valid while the page table does not
+//	change; see FlushHostTLB.  Nothing is cached while DEBUG('a') or
+//	a page trace is on: both must see every reference.
+//----------------------------------------------------------------------
+
+ExceptionType
+Machine::CachedTranslate(int virtAddr, int *physAddr, int size, bool writing)
+{
+	unsigned int vpn = (unsigned)virtAddr / PageSize;
+	HostTLBEntry *entry = writing ? &writeCache[vpn % HostTLBSize]
+								  : &readCache[vpn % HostTLBSize];
+	ExceptionType exception;
+
+	if ((entry->virtualPage == vpn) && ((virtAddr & (size - 1)) == 0))
+	{ // hit, and aligned
+		*physAddr = entry->physicalBase + (unsigned)virtAddr % PageSize;
+		return NoException;
+	}
+	exception = Translate(virtAddr, physAddr, size, writing);
+	if ((exception == NoException) && !traceMemory && (pageTrace == NULL))
+	{
+		entry->virtualPage = vpn;
+		entry->physicalBase = *physAddr - (unsigned)virtAddr % PageSize;
+	}
+	return exception;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushHostTLB
+// 	Forget every cached translation.  Called by the kernel when it
+//	switches to another page table (AddrSpace::RestoreState), and
+//	whenever it changes the current one: a mapping added, removed or
+//	made read-only, or use/dirty bits cleared.
+//----------------------------------------------------------------------
+
+void Machine::FlushHostTLB()
+{
+	for (int i = 0; i < HostTLBSize; i++)
+	{
+		readCache[i].virtualPage = HostTLBInvalid;
+		writeCache[i].virtualPage = HostTLBInvalid;
+	}
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using
@@ -262,6 +324,8 @@ Machine::Translate(int virtAddr, int *physAddr, int size, bool writing)
 	entry->use = TRUE; // set the use, dirty bits
 	if (writing)
 		entry->dirty = TRUE;
+	if (pageTrace != NULL)
+		pageTrace->Reference(vpn, writing);
 	*physAddr = pageFrame * PageSize + offset;
 	ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
 	DEBUG('a', "phys addr = 0x%x\n", *physAddr);
@@ -0,0 +1,30 @@
+/* fork.c
+ *	Simple program to test the Fork system call.
+ *
+ *	The child gets a copy of the parent's memory: it changes its copy
+ *	of "value", and exits with it; the parent's copy must still hold
+ *	the old value when it joins the child. 子进程修改自己的value副本并以其
+ *	作为退出码，父进程的value应保持不变。
+ */
+
+#include "syscall.h"
+
+int main()
+{
+    SpaceId pid;
+    int value = 1;
+    int status;
+
+    pid = Fork();
+    if (pid == 0)
+    {
+        value = 2; /* copied on write: the parent still has 1 */
+        Exit(value);
+    }
+    status = Join(pid);
+    if ((status == 2) && (value == 1))
+        Write("fork ok", 7, ConsoleOutput);
+    else
+        Write("fork FAILED", 11, ConsoleOutput);
+    Exit(99);
+}
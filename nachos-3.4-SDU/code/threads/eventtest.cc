@@ -0,0 +1,145 @@
+// eventtest.cc
+//	Micro-benchmark for the pending-interrupt queue.
+//
+//	Simulates what Interrupt::OneTick does to its queue: a number of
+//	devices each keep one interrupt outstanding and reschedule it as
+//	soon as it fires, and on every tick the queue is checked for an
+//	interrupt that is due.  The same event sequence is run against the
+//	old representation (a sorted List, with a fresh PendingInterrupt per
+//	Schedule, and a check that removes the head and re-inserts it when
+//	nothing is due) and against the EventQueue (eventqueue.cc), and the
+//	host time of both is printed. 中断队列微基准：比较旧的有序链表与二叉堆事件队列。
+//
+//	Run with "nachos -eq".
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "eventqueue.h"
+#include <time.h>
+
+#define BenchTicks 1000000 // simulated ticks per run
+#define MaxDelay 1000      // devices reschedule 1..MaxDelay ticks ahead
+
+static unsigned int seed; // private generator, so both runs see the
+                          // same sequence of delays
+
+static int
+NextDelay()
+{
+    seed = seed * 1103515245 + 12345;
+    return 1 + (int)((seed >> 16) % MaxDelay);
+}
+
+static void
+Nothing(_int arg)
+{
+}
+
+//----------------------------------------------------------------------
+// ListBench
+// 	The old way: sorted List, peek by remove + re-insert.
+//	Returns the number of interrupts fired.
+//----------------------------------------------------------------------
+
+static int
+ListBench(int numDevices)
+{
+    List *pending = new List();
+    PendingInterrupt *event;
+    int now, when, fired = 0;
+
+    seed = 1;
+    for (int i = 0; i < numDevices; i++)
+    {
+        when = NextDelay();
+        pending->SortedInsert(new PendingInterrupt(Nothing, i, when, DiskInt), when);
+    }
+    for (now = 1; now <= BenchTicks; now++)
+        for (;;)
+        {
+            event = (PendingInterrupt *)pending->SortedRemove(&when);
+            if (when > now)
+            { // not time yet, put it back
+                pending->SortedInsert(event, when);
+                break;
+            }
+            fired++;
+            when = now + NextDelay();
+            pending->SortedInsert(new PendingInterrupt(Nothing, event->arg,
+                                                       when, DiskInt),
+                                  when);
+            delete event;
+        }
+    while (!pending->IsEmpty())
+        delete (PendingInterrupt *)pending->Remove();
+    delete pending;
+    return fired;
+}
+
+//----------------------------------------------------------------------
+// HeapBench
+// 	The new way: EventQueue, O(1) peek, pooled records.  Every tenth
+//	reschedule also schedules and cancels a spare interrupt, to
+//	exercise Cancel.  Returns the number of interrupts fired.
+//----------------------------------------------------------------------
+
+static int
+HeapBench(int numDevices)
+{
+    EventQueue *pending = new EventQueue();
+    PendingInterrupt *event;
+    int now, spare, fired = 0;
+
+    seed = 1;
+    for (int i = 0; i < numDevices; i++)
+        pending->Insert(Nothing, i, NextDelay(), DiskInt);
+    for (now = 1; now <= BenchTicks; now++)
+        while (pending->Peek()->when <= now)
+        {
+            event = pending->RemoveFirst();
+            fired++;
+            pending->Insert(Nothing, event->arg, now + NextDelay(), DiskInt);
+            if ((fired % 10) == 0)
+            {
+                spare = pending->Insert(Nothing, 0, now + MaxDelay, TimerInt);
+                ASSERT(pending->Cancel(spare));
+            }
+            pending->Free(event);
+        }
+    delete pending;
+    return fired;
+}
+
+//----------------------------------------------------------------------
+// EventQueueBenchmark
+// 	Time both queues for a few numbers of devices.
+//----------------------------------------------------------------------
+
+void EventQueueBenchmark()
+{
+    static int devices[] = {4, 16, 64, 256};
+    clock_t start;
+    double listSecs, heapSecs;
+    int listFired, heapFired;
+
+    printf("pending interrupt queue, %d ticks per run\n", BenchTicks);
+    printf("devices\tfired\tlist (s)\theap (s)\tspeedup\n");
+    for (int i = 0; i < (int)(sizeof(devices) / sizeof(devices[0])); i++)
+    {
+        start = clock();
+        listFired = ListBench(devices[i]);
+        listSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        start = clock();
+        heapFired = HeapBench(devices[i]);
+        heapSecs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        ASSERT(listFired == heapFired); // same event sequence
+        printf("%d\t%d\t%.3f\t\t%.3f\t\t%.1fx\n", devices[i], heapFired,
+               listSecs, heapSecs, (heapSecs > 0) ? listSecs / heapSecs : 0.0);
+    }
+}
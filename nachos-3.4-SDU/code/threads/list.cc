@@ -254,6 +254,25 @@ List::SortedRemove(int *keyPtr)
     return thing;
 }
 
+//----------------------------------------------------------------------
+// List::SortedPeek
+//      Like SortedRemove, but leave the first item on the list.
+//
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to its priority value.
+//----------------------------------------------------------------------
+
+void *
+List::SortedPeek(int *keyPtr)
+{
+    if (IsEmpty())
+        return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    return first->item;
+}
+
 void List::RemoveByItem(void *item)
 {
     ListElement *prev, *ptr;
@@ -9,25 +9,37 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
-//		-f -cp <unix file> <nachos file>
+//		-s -bb -pt <trace file> -x <nachos file> -c <consoleIn> <consoleOut>
+//		-f -bc <cache sectors> -dp <disk policy> -dio <rw|mmap|async>
+//		-dg <tracks> <sectors per track>
+//		-cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -e <network orderability>
 //              -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -eq
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
+//    -eq times the pending-interrupt queue against the old sorted list
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -bb runs user programs with the basic-block (threaded code) engine
+//    -pt records the page references of user programs in a host file,
+//       to replay with bin/pagesim (it turns -bb off, so that every
+//       instruction fetch is seen)
 //    -x runs a user program
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
+//    -bc sets the number of sectors in the disk buffer cache (0 = none)
+//    -dp sets the disk scheduling policy: fifo, sstf, scan or clook
+//    -dio sets how the DISK file is accessed: rw (system calls), mmap,
+//         or async (system calls made by a host thread)
+//    -dg sets the number of tracks, and of sectors on each, of a new DISK
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
@@ -61,6 +73,7 @@ extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
+extern void EventQueueBenchmark(void);
 extern void SynchTest(void);
 
 //----------------------------------------------------------------------
@@ -97,6 +110,8 @@ int main(int argc, char **argv)
 		argCount = 1;
 		if (!strcmp(*argv, "-z")) // print copyright
 			printf("\n\n%s\n\n", copyright);
+		if (!strcmp(*argv, "-eq")) // time the interrupt queue
+			EventQueueBenchmark();
 #ifdef USER_PROGRAM
 		if (!strcmp(*argv, "-x"))
 		{ // run a user program
@@ -163,6 +178,9 @@ int main(int argc, char **argv)
 		}
 #endif // NETWORK
 	}
+#ifdef FILESYS_CACHE
+	fileSystem->Sync(); // the machine may go idle before anyone else syncs
+#endif
 
 	currentThread->Finish(); // NOTE: if the procedure "main"
 		// returns, then the program "nachos"
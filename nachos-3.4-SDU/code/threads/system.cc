@@ -26,6 +26,10 @@ FileSystem *fileSystem;
 #ifdef FILESYS
 SynchDisk *synchDisk;
 #endif
+#ifdef FILESYS_CACHE
+InodeTable *inodeTable;
+Journal *journal;
+#endif
 
 #ifdef USER_PROGRAM // requires either FILESYS or FILESYS_STUB
 Machine *machine;   // user program memory and registers
@@ -80,10 +84,19 @@ void Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE; // single step user program
+    bool blockEngine = FALSE;   // run user code a basic block at a time
+    char *pageTraceFile = NULL; // record page references here
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE; // format disk
 #endif
+#ifdef FILESYS_CACHE
+    int cacheSectors = DefaultCacheSectors; // size of the buffer cache
+    int diskPolicy = DefaultDiskPolicy;     // disk request scheduling
+    int diskBackend = DefaultDiskBackend;   // how the DISK file is accessed
+    int diskTracks = DefaultNumTracks;      // geometry of a new DISK
+    int diskTrackSize = DefaultSectorsPerTrack;
+#endif
 #ifdef NETWORK
     double rely = 1;  // network reliability
     double order = 1; // network orderability
@@ -114,11 +127,48 @@ void Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
         if (!strcmp(*argv, "-s"))
             debugUserProg = TRUE;
+        else if (!strcmp(*argv, "-bb"))
+            blockEngine = TRUE;
+        else if (!strcmp(*argv, "-pt"))
+        {
+            ASSERT(argc > 1);
+            pageTraceFile = *(argv + 1);
+            argCount = 2;
+        }
 #endif
 #ifdef FILESYS_NEEDED
         if (!strcmp(*argv, "-f"))
             format = TRUE;
 #endif
+#ifdef FILESYS_CACHE
+        if (!strcmp(*argv, "-bc"))
+        {
+            ASSERT(argc > 1);
+            cacheSectors = atoi(*(argv + 1));
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dp"))
+        {
+            ASSERT(argc > 1);
+            diskPolicy = SynchDisk::PolicyByName(*(argv + 1));
+            ASSERT(diskPolicy != -1); // fifo, sstf, scan or clook
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dio"))
+        {
+            ASSERT(argc > 1);
+            diskBackend = Disk::BackendByName(*(argv + 1));
+            ASSERT(diskBackend != -1); // rw, mmap or async
+            argCount = 2;
+        }
+        else if (!strcmp(*argv, "-dg"))
+        {
+            ASSERT(argc > 2);
+            diskTracks = atoi(*(argv + 1));
+            diskTrackSize = atoi(*(argv + 2));
+            argCount = 3;
+        }
+#endif
 #ifdef NETWORK
         if (!strcmp(*argv, "-n"))
         {
@@ -160,11 +210,20 @@ void Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup); // if user hits ctl-C
 
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg); // this must come first
+    machine = new Machine(debugUserProg, blockEngine, pageTraceFile); // this must come first
 #endif
 
-#ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+#ifdef FILESYS_CACHE
+    synchDisk = new SynchDisk("DISK", cacheSectors, (DiskPolicy)diskPolicy,
+                              (DiskBackend)diskBackend, diskTracks,
+                              diskTrackSize);
+    diskNumTracks = synchDisk->Tracks(); // an existing DISK keeps its own
+    diskSectorsPerTrack = synchDisk->TrackSize();
+    journal = new Journal(synchDisk); // on once the disk is mounted
+    synchDisk->SetJournal(journal);
+    inodeTable = new InodeTable();
+#elif defined(FILESYS)
+    synchDisk = new SynchDisk("DISK"); // a file system without the cache
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -195,6 +254,11 @@ void Cleanup()
     delete fileSystem;
 #endif
 
+#ifdef FILESYS_CACHE
+    delete inodeTable;
+    synchDisk->SetJournal(NULL);
+    delete journal;
+#endif
 #ifdef FILESYS
     delete synchDisk;
 #endif
@@ -44,6 +44,13 @@ extern FileSystem  *fileSystem;
 extern SynchDisk   *synchDisk;
 #endif
 
+#ifdef FILESYS_CACHE		// not in simpler file systems, e.g. lab5's
+#include "inode.h"
+#include "journal.h"
+extern InodeTable  *inodeTable;		// headers of the open files
+extern Journal     *journal;		// metadata write-ahead log
+#endif
+
 #ifdef NETWORK
 #include "post.h"
 extern PostOffice* postOffice;
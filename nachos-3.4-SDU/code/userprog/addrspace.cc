@@ -114,6 +114,10 @@ AddrSpace::AddrSpace(OpenFile *executable)
         executable->ReadAt(&(machine->mainMemory[noffH.initData.virtualAddr]),
                            noffH.initData.size, noffH.initData.inFileAddr);
     }
+
+    // the frames now hold new code; drop any stale predecoded copies
+    for (i = 0; i < numPages; i++)
+        machine->InvalidateDecodedPage(pageTable[i].physicalPage);
 }
 
 //----------------------------------------------------------------------
@@ -181,6 +185,7 @@ void AddrSpace::RestoreState()
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushHostTLB(); // cached translations were for the old table
 }
 
 void AddrSpace::Print()
@@ -110,14 +110,15 @@ void Close(OpenFileId id);
 
 
 
-/* User-level thread operations: Fork and Yield.  To allow multiple
- * threads to run within a user program. 
- */
+/* Process and thread operations: Fork and Yield. */
 
-/* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+/* Create a copy of the calling process: the same program, memory, open
+ * files and registers.  Both go on from the return of Fork, which is
+ * the child's SpaceId in the parent, and 0 in the child.  Memory is
+ * shared until one of them writes it (copy-on-write).  Returns -1, and
+ * makes no child, if there are too many processes already.
  */
-void Fork(void (*func)());
+SpaceId Fork();
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 